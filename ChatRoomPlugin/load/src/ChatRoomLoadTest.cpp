@@ -0,0 +1,656 @@
+/**
+ * @file ChatRoomLoadTest.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the ChatRoomLoadTest program. It loads the ChatRoomPlugin in-process,
+ * connects many simulated WebSocket sessions to it, has some of them post
+ * chats at a given rate, and reports how long it took for the chats to
+ * reach every session, along with throughput and memory used per session.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Json/Json.hpp>
+#include <StringUtils/StringUtils.hpp>
+#include <WebServer/PluginEntryPoint.hpp>
+#include <WebSocket/WebSocket.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#    include <unistd.h>
+#endif /* __linux__ */
+
+#ifdef _WIN32
+#    define API __declspec(dllimport)
+#else /* POSIX */
+#    define API
+#endif /* _WIN32 / POSIX */
+extern "C" API void LoadPlugin(
+    Http::IServer* server, Json::Value configuration,
+    SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessageDelegate,
+    std::function<void()>& unloadDelegate);
+
+namespace
+{
+    /**
+     * This is the path in the server at which to place the plug-in.
+     */
+    const std::string CHAT_ROOM_PATH = "/chat";
+
+    /**
+     * This is how long to wait, in nanoseconds, for more chats to be
+     * delivered once posting stops, before giving up on the rest.
+     */
+    constexpr uint64_t DRAIN_QUIET_PERIOD = 1000000000;
+
+    /**
+     * This holds the parameters of the load test, given on the command line.
+     */
+    struct Environment
+    {
+        /**
+         * This is the number of sessions to connect to the chat rooms.
+         */
+        size_t sessions = 1000;
+
+        /**
+         * This is the number of chat rooms among which to spread the sessions.
+         */
+        size_t rooms = 1;
+
+        /**
+         * This is the number of threads posting chats.
+         */
+        size_t senders = 1;
+
+        /**
+         * This is the total number of chats to post per second.
+         */
+        double rate = 100.0;
+
+        /**
+         * This is how long to keep posting chats, in seconds.
+         */
+        double duration = 10.0;
+
+        /**
+         * This is the number of shards over which the plug-in spreads
+         * the chat rooms, or zero to leave it to the plug-in.
+         */
+        size_t shards = 0;
+    };
+
+    /**
+     * This simulates the web server hosting the chat room.
+     */
+    struct MockServer : public Http::IServer
+    {
+        // Properties
+
+        /**
+         * This is the delegate that the plug-in has registered
+         * to be called to handle resource requests.
+         */
+        ResourceDelegate registeredResourceDelegate;
+
+        // Http::IServer
+
+        virtual std::string GetConfigurationItem(const std::string& key) override { return ""; }
+
+        virtual void SetConfigurationItem(const std::string& key,
+                                          const std::string& value) override {}
+
+        virtual SystemUtils::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+            SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+            size_t minLevel = 0) override {
+            return []() {};
+        }
+
+        virtual UnregistrationDelegate RegisterResource(
+            const std::vector<std::string>& resourceSubspacePath,
+            ResourceDelegate resourceDelegate) override {
+            registeredResourceDelegate = resourceDelegate;
+            return []() {};
+        }
+    };
+
+    /**
+     * This is one end of an in-process connection between a simulated
+     * session and the chat room.
+     */
+    struct MockConnection : public Http::Connection
+    {
+        // Properties
+
+        /**
+         * This is the delegate to call whenever data is received from
+         * the remote peer.
+         */
+        DataReceivedDelegate dataReceivedDelegate;
+
+        /**
+         * This is the delegate to call to deliver data to the remote peer.
+         */
+        DataReceivedDelegate sendDataDelegate;
+
+        /**
+         * This is the delegate to call whenever the connection is broken.
+         */
+        BrokenDelegate brokenDelegate;
+
+        // Http::Connection
+
+        virtual std::string GetPeerId() override { return "load-test"; }
+
+        virtual void SetDataReceivedDelegate(
+            DataReceivedDelegate newDataReceivedDelegate) override {
+            dataReceivedDelegate = newDataReceivedDelegate;
+        }
+
+        virtual void SetConnectionBrokenDelegate(BrokenDelegate newBrokenDelegate) override {
+            brokenDelegate = newBrokenDelegate;
+        }
+
+        virtual void SendData(const std::vector<uint8_t>& data) override {
+            sendDataDelegate(data);
+        }
+
+        virtual void Break(bool clean) override {}
+    };
+
+    /**
+     * This records latencies in a histogram of logarithmically sized
+     * buckets, each split into linearly sized sub-buckets, so that
+     * percentiles can be taken to within a few percent without keeping
+     * every sample.
+     */
+    class LatencyHistogram
+    {
+        // Public methods
+    public:
+        /**
+         * This method records one latency.
+         *
+         * @param[in] nanoseconds
+         *      This is the latency to record, in nanoseconds.
+         */
+        void Record(uint64_t nanoseconds) {
+            ++counts_[GetBucket(nanoseconds)];
+            ++total_;
+        }
+
+        /**
+         * This method returns the number of latencies recorded.
+         *
+         * @return
+         *      The number of latencies recorded is returned.
+         */
+        uint64_t GetTotal() const { return total_; }
+
+        /**
+         * This method returns the latency under which
+         * the given fraction of the latencies recorded fall.
+         *
+         * @param[in] fraction
+         *      This is the fraction of latencies, between 0 and 1.
+         *
+         * @return
+         *      The latency, in nanoseconds, is returned.
+         */
+        uint64_t GetPercentile(double fraction) const {
+            const auto total = total_.load();
+            if (total == 0)
+            { return 0; }
+            const auto target = std::max((uint64_t)1, (uint64_t)(fraction * total + 0.5));
+            uint64_t seen = 0;
+            for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+            {
+                seen += counts_[bucket];
+                if (seen >= target)
+                { return GetBucketLimit(bucket); }
+            }
+            return GetBucketLimit(NUM_BUCKETS - 1);
+        }
+
+        // Private methods
+    private:
+        /**
+         * This is the number of sub-buckets each power of two is split into,
+         * as a power of two.
+         */
+        static constexpr size_t SUB_BUCKET_BITS = 4;
+
+        /**
+         * This is the number of buckets.
+         */
+        static constexpr size_t NUM_BUCKETS = 64 << SUB_BUCKET_BITS;
+
+        /**
+         * This method returns the bucket counting the given latency.
+         *
+         * @param[in] value
+         *      This is the latency.
+         *
+         * @return
+         *      The index of the bucket is returned.
+         */
+        static size_t GetBucket(uint64_t value) {
+            if (value < (1 << SUB_BUCKET_BITS))
+            { return (size_t)value; }
+            size_t magnitude = 63;
+            while ((value & ((uint64_t)1 << magnitude)) == 0)
+            { --magnitude; }
+            const auto subBucket =
+                (size_t)(value >> (magnitude - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+            return ((magnitude - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + subBucket;
+        }
+
+        /**
+         * This method returns the largest latency counted
+         * in the given bucket.
+         *
+         * @param[in] bucket
+         *      This is the index of the bucket.
+         *
+         * @return
+         *      The largest latency counted in the bucket is returned.
+         */
+        static uint64_t GetBucketLimit(size_t bucket) {
+            if (bucket < (1 << SUB_BUCKET_BITS))
+            { return (uint64_t)bucket; }
+            const auto magnitude = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+            const auto subBucket = (uint64_t)(bucket & ((1 << SUB_BUCKET_BITS) - 1));
+            const auto start = ((uint64_t)1 << magnitude) +
+                               (subBucket << (magnitude - SUB_BUCKET_BITS));
+            return start + ((uint64_t)1 << (magnitude - SUB_BUCKET_BITS)) - 1;
+        }
+
+        // Private properties
+    private:
+        /**
+         * These are the numbers of latencies counted in each bucket.
+         */
+        std::atomic<uint64_t> counts_[NUM_BUCKETS] = {};
+
+        /**
+         * This is the number of latencies recorded.
+         */
+        std::atomic<uint64_t> total_{0};
+    };
+
+    /**
+     * This is one simulated user of the chat room.
+     */
+    struct Session
+    {
+        /**
+         * This is the WebSocket connecting the session to the chat room.
+         */
+        WebSocket::WebSocket ws;
+
+        /**
+         * This is the session end of the in-process connection.
+         */
+        std::shared_ptr<MockConnection> clientConnection =
+            std::make_shared<MockConnection>();
+
+        /**
+         * This is the chat room end of the in-process connection.
+         */
+        std::shared_ptr<MockConnection> serverConnection =
+            std::make_shared<MockConnection>();
+
+        /**
+         * This is the number of sessions in the chat room of the session,
+         * each of which should get every chat the session posts.
+         */
+        size_t roomSessions = 0;
+    };
+
+    /**
+     * This returns the time elapsed on a monotonic clock.
+     *
+     * @return
+     *      The time elapsed, in nanoseconds, is returned.
+     */
+    uint64_t GetNanoseconds() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /**
+     * This returns the amount of memory the program holds in RAM.
+     *
+     * @return
+     *      The amount of memory the program holds in RAM, in bytes,
+     *      is returned, or zero if it can't be determined.
+     */
+    uint64_t GetResidentBytes() {
+#ifdef __linux__
+        const auto statm = fopen("/proc/self/statm", "r");
+        if (statm == NULL)
+        { return 0; }
+        unsigned long long size = 0;
+        unsigned long long resident = 0;
+        const auto fields = fscanf(statm, "%llu %llu", &size, &resident);
+        (void)fclose(statm);
+        if (fields != 2)
+        { return 0; }
+        return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+        return 0;
+#endif /* __linux__ */
+    }
+
+    /**
+     * This function prints to the standard error stream information
+     * about how to use this program.
+     */
+    void PrintUsageInformation() {
+        fprintf(stderr,
+                ("Usage: ChatRoomLoadTest [options]\n"
+                 "\n"
+                 "Connect simulated sessions to the chat room plug-in, post chats\n"
+                 "at a given rate, and report how fast they reach every session.\n"
+                 "\n"
+                 "Options:\n"
+                 "  --sessions N     number of sessions to connect (default: 1000)\n"
+                 "  --rooms N        number of chat rooms to spread them over (default: 1)\n"
+                 "  --senders N      number of threads posting chats (default: 1)\n"
+                 "  --rate N         total chats posted per second (default: 100)\n"
+                 "  --duration N     seconds to keep posting chats (default: 10)\n"
+                 "  --shards N       number of shards of the plug-in (default: cores)\n"));
+    }
+
+    /**
+     * This function updates the program environment to incorporate
+     * any applicable command-line arguments.
+     *
+     * @param[in] argc
+     *      This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *      This is the array of command-line arguments given to the program.
+     *
+     * @param[in, out] environment
+     *      This is the environment to update.
+     *
+     * @return
+     *      An indication of whether or not the function succeeded is returned.
+     */
+    bool ProcessCommandLineArguments(int argc, char* argv[], Environment& environment) {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg(argv[i]);
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "error: value expected after '%s'\n", arg.c_str());
+                return false;
+            }
+            const auto value = strtod(argv[++i], NULL);
+            if (value <= 0.0)
+            {
+                fprintf(stderr, "error: positive value expected after '%s'\n", arg.c_str());
+                return false;
+            }
+            if (arg == "--sessions")
+            {
+                environment.sessions = (size_t)value;
+            } else if (arg == "--rooms")
+            {
+                environment.rooms = (size_t)value;
+            } else if (arg == "--senders")
+            {
+                environment.senders = (size_t)value;
+            } else if (arg == "--rate")
+            {
+                environment.rate = value;
+            } else if (arg == "--duration")
+            {
+                environment.duration = value;
+            } else if (arg == "--shards")
+            {
+                environment.shards = (size_t)value;
+            } else
+            {
+                fprintf(stderr, "error: unrecognized option: '%s'\n", arg.c_str());
+                return false;
+            }
+        }
+        environment.senders = std::min(environment.senders, environment.sessions);
+        return true;
+    }
+
+    /**
+     * This function connects the given session to the given chat room.
+     *
+     * @param[in] server
+     *      This is the server hosting the plug-in.
+     *
+     * @param[in, out] session
+     *      This is the session to connect.
+     *
+     * @param[in] room
+     *      This is the name of the chat room to join.
+     *
+     * @param[in, out] latencies
+     *      This is where to record how long it took for
+     *      chats to reach the session.
+     *
+     * @param[in, out] deliveries
+     *      This counts the chats received by all sessions.
+     *
+     * @return
+     *      An indication of whether or not the session
+     *      was connected is returned.
+     */
+    bool ConnectSession(MockServer& server, Session& session, const std::string& room,
+                        LatencyHistogram& latencies, std::atomic<uint64_t>& deliveries) {
+        const auto clientConnection = session.clientConnection.get();
+        const auto serverConnection = session.serverConnection.get();
+        clientConnection->sendDataDelegate = [serverConnection](const std::vector<uint8_t>& data)
+        { serverConnection->dataReceivedDelegate(data); };
+        serverConnection->sendDataDelegate = [clientConnection](const std::vector<uint8_t>& data)
+        { clientConnection->dataReceivedDelegate(data); };
+        session.ws.SetTextDelegate(
+            [&latencies, &deliveries](const std::string& data)
+            {
+                // Only chats are timed; skip anything else without decoding it.
+                if (data.find("PostChatResult") == std::string::npos)
+                { return; }
+                const auto now = GetNanoseconds();
+                const auto message = Json::Value::FromEncoding(data);
+                const auto sent = strtoull(((std::string)message["Time"]).c_str(), NULL, 10);
+                latencies.Record((now > sent) ? (now - sent) : 0);
+                ++deliveries;
+            });
+        const auto request = std::make_shared<Http::Server::Request>();
+        request->method = "GET";
+        (void)request->target.ParseFromString(CHAT_ROOM_PATH + "/" + room);
+        session.ws.StartOpenAsClient(*request);
+        const auto response =
+            server.registeredResourceDelegate(request, session.serverConnection, "");
+        return session.ws.CompleteOpenAsClient(session.clientConnection, *response);
+    }
+
+    /**
+     * This function posts chats from the given sessions, in turn,
+     * at the given rate, until the given time.
+     *
+     * @param[in] sessions
+     *      These are all the sessions.
+     *
+     * @param[in] first
+     *      This is the index of the first session from which to post.
+     *
+     * @param[in] stride
+     *      This is the distance between the sessions from which to post.
+     *
+     * @param[in] rate
+     *      This is the number of chats to post per second.
+     *
+     * @param[in] end
+     *      This is the time at which to stop, in nanoseconds.
+     *
+     * @param[in, out] posts
+     *      This counts the chats posted by all threads.
+     *
+     * @param[in, out] expectedDeliveries
+     *      This counts the deliveries expected for the chats
+     *      posted by all threads.
+     */
+    void PostChats(std::vector<std::unique_ptr<Session>>& sessions, size_t first, size_t stride,
+                   double rate, uint64_t end, std::atomic<uint64_t>& posts,
+                   std::atomic<uint64_t>& expectedDeliveries) {
+        const auto interval = (uint64_t)(1e9 / rate);
+        auto next = GetNanoseconds();
+        auto sender = first;
+        while (next < end)
+        {
+            const auto now = GetNanoseconds();
+            if (now < next)
+            {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+                continue;
+            }
+            Json::Value message(Json::Value::Type::Object);
+            message.Set("Type", "PostChat");
+            message.Set("Chat", "Load test");
+            message.Set("Time", StringUtils::sprintf("%" PRIu64, GetNanoseconds()));
+            sessions[sender]->ws.SendText(message.ToEncoding());
+            ++posts;
+            expectedDeliveries += sessions[sender]->roomSessions;
+            sender += stride;
+            if (sender >= sessions.size())
+            { sender = first; }
+            next += interval;
+        }
+    }
+}  // namespace
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *      This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *      This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Environment environment;
+    if (!ProcessCommandLineArguments(argc, argv, environment))
+    {
+        PrintUsageInformation();
+        return EXIT_FAILURE;
+    }
+
+    // Load the plug-in.
+    MockServer server;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", CHAT_ROOM_PATH);
+    configuration.Set("room-limit", (int)environment.rooms);
+    if (environment.shards > 0)
+    { configuration.Set("shards", (int)environment.shards); }
+    std::function<void()> unloadDelegate;
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        {
+            if (level >= SystemUtils::DiagnosticsSender::Levels::WARNING)
+            { fprintf(stderr, "%s[%zu]: %s\n", senderName.c_str(), level, message.c_str()); }
+        },
+        unloadDelegate);
+    if (unloadDelegate == nullptr)
+    {
+        fprintf(stderr, "error: unable to load the plug-in\n");
+        return EXIT_FAILURE;
+    }
+
+    // Connect the sessions.
+    LatencyHistogram latencies;
+    std::atomic<uint64_t> deliveries{0};
+    std::atomic<uint64_t> posts{0};
+    std::atomic<uint64_t> expectedDeliveries{0};
+    std::vector<std::unique_ptr<Session>> sessions;
+    sessions.reserve(environment.sessions);
+    const auto residentBefore = GetResidentBytes();
+    const auto connectStart = GetNanoseconds();
+    for (size_t i = 0; i < environment.sessions; ++i)
+    {
+        const auto roomIndex = i % environment.rooms;
+        sessions.emplace_back(new Session());
+        sessions.back()->roomSessions =
+            (environment.sessions - roomIndex + environment.rooms - 1) / environment.rooms;
+        const auto room = StringUtils::sprintf("room%zu", roomIndex);
+        if (!ConnectSession(server, *sessions.back(), room, latencies, deliveries))
+        {
+            fprintf(stderr, "error: unable to connect session %zu\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    const auto connectTime = (double)(GetNanoseconds() - connectStart) / 1e9;
+    const auto residentAfter = GetResidentBytes();
+
+    // Post chats.
+    const auto start = GetNanoseconds();
+    const auto end = start + (uint64_t)(environment.duration * 1e9);
+    std::vector<std::thread> senders;
+    for (size_t i = 0; i < environment.senders; ++i)
+    {
+        senders.emplace_back(PostChats, std::ref(sessions), i, environment.senders,
+                             environment.rate / environment.senders, end, std::ref(posts),
+                             std::ref(expectedDeliveries));
+    }
+    for (auto& sender : senders)
+    { sender.join(); }
+    const auto postTime = (double)(GetNanoseconds() - start) / 1e9;
+
+    // Wait for the chats still being fanned out, so that they're counted,
+    // until all are delivered, or deliveries stop.
+    auto lastDeliveries = deliveries.load();
+    auto lastDeliveryTime = GetNanoseconds();
+    while (deliveries < expectedDeliveries)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto now = GetNanoseconds();
+        if (deliveries != lastDeliveries)
+        {
+            lastDeliveries = deliveries;
+            lastDeliveryTime = now;
+        } else if (now - lastDeliveryTime >= DRAIN_QUIET_PERIOD)
+        { break; }
+    }
+    const auto elapsed = (double)(GetNanoseconds() - start) / 1e9;
+
+    // Report the results.
+    printf("sessions:          %zu in %zu room(s), connected in %.2f s\n", environment.sessions,
+           environment.rooms, connectTime);
+    if ((residentBefore > 0) && (residentAfter > residentBefore))
+    {
+        printf("memory/session:    %.1f KiB\n",
+               (double)(residentAfter - residentBefore) / 1024.0 / environment.sessions);
+    } else
+    { printf("memory/session:    unknown\n"); }
+    printf("chats posted:      %" PRIu64 " (%.1f/s)\n", posts.load(), posts / postTime);
+    printf("chats delivered:   %" PRIu64 " of %" PRIu64 " (%.1f/s)\n", deliveries.load(),
+           expectedDeliveries.load(), deliveries / elapsed);
+    printf("fan-out latency:   p50 %.1f us, p99 %.1f us, p999 %.1f us\n",
+           latencies.GetPercentile(0.5) / 1e3, latencies.GetPercentile(0.99) / 1e3,
+           latencies.GetPercentile(0.999) / 1e3);
+
+    unloadDelegate();
+    return EXIT_SUCCESS;
+}
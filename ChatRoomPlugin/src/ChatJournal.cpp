@@ -0,0 +1,694 @@
+/**
+ * @file ChatJournal.cpp
+ *
+ * This module contains the implementation of the ChatJournal class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include "ChatJournal.hpp"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <StringUtils/StringUtils.hpp>
+#include <SystemUtils/File.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <Windows.h>
+#else /* POSIX */
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif /* _WIN32 / POSIX */
+
+namespace
+{
+    /**
+     * This is the extension of the names of segment files.
+     */
+    const std::string SEGMENT_EXTENSION = ".log";
+
+    /**
+     * This is the number of digits of the sequence number
+     * naming each segment file.
+     */
+    constexpr size_t SEGMENT_NAME_DIGITS = 20;
+
+    /**
+     * This is the size of the part of each record before the
+     * part covered by the checksum, in bytes.
+     */
+    constexpr size_t RECORD_HEADER_SIZE = 8;
+
+    /**
+     * This is the maximum length of the part of a record covered by the
+     * checksum. Anything longer is taken to be garbage.
+     */
+    constexpr uint32_t MAX_RECORD_LENGTH = 64 * 1024 * 1024;
+
+    /**
+     * This computes the 32-bit FNV-1a hash of the given data.
+     *
+     * @param[in] data
+     *      This is the data to hash.
+     *
+     * @param[in] size
+     *      This is the number of bytes of data to hash.
+     *
+     * @return
+     *      The hash of the data is returned.
+     */
+    uint32_t ComputeChecksum(const char* data, size_t size) {
+        uint32_t hash = 2166136261U;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= (uint8_t)data[i];
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    /**
+     * This appends a little-endian number of the given size
+     * to the given data.
+     *
+     * @param[in, out] data
+     *      This is the data to which to append the number.
+     *
+     * @param[in] value
+     *      This is the number to append.
+     *
+     * @param[in] size
+     *      This is the number of bytes of the number.
+     */
+    void WriteNumber(std::string& data, uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+        {
+            data.push_back((char)(value & 0xFF));
+            value >>= 8;
+        }
+    }
+
+    /**
+     * This reads a little-endian number of the given size
+     * from the given data.
+     *
+     * @param[in] data
+     *      This is the data from which to read the number.
+     *
+     * @param[in] size
+     *      This is the number of bytes of the number.
+     *
+     * @return
+     *      The number read is returned.
+     */
+    uint64_t ReadNumber(const char* data, size_t size) {
+        uint64_t value = 0;
+        for (size_t i = size; i > 0; --i)
+        { value = (value << 8) | (uint8_t)data[i - 1]; }
+        return value;
+    }
+
+    /**
+     * This appends a length-prefixed string to the given data.
+     *
+     * @param[in, out] data
+     *      This is the data to which to append the string.
+     *
+     * @param[in] value
+     *      This is the string to append.
+     */
+    void WriteString(std::string& data, const std::string& value) {
+        WriteNumber(data, value.length(), 4);
+        data += value;
+    }
+
+    /**
+     * This reads a length-prefixed string from the given data.
+     *
+     * @param[in, out] data
+     *      This is where the string starts. On return,
+     *      it's moved past the string.
+     *
+     * @param[in] end
+     *      This is the end of the data.
+     *
+     * @param[out] value
+     *      This is where to store the string read.
+     *
+     * @return
+     *      An indication of whether or not the string
+     *      fit within the data is returned.
+     */
+    bool ReadString(const char*& data, const char* end, std::string& value) {
+        if (end - data < 4)
+        { return false; }
+        const auto length = ReadNumber(data, 4);
+        data += 4;
+        if ((uint64_t)(end - data) < length)
+        { return false; }
+        value.assign(data, (size_t)length);
+        data += length;
+        return true;
+    }
+
+    /**
+     * This encodes the given message as a record of the log.
+     *
+     * @param[in] record
+     *      This is the message to encode.
+     *
+     * @param[in, out] data
+     *      This is where to append the encoded record.
+     */
+    void EncodeRecord(const ChatJournal::Record& record, std::string& data) {
+        std::string body;
+        WriteNumber(body, record.seq, 8);
+        WriteString(body, record.timestamp);
+        WriteString(body, record.sender);
+        WriteString(body, record.message);
+        WriteNumber(data, body.length(), 4);
+        WriteNumber(data, ComputeChecksum(body.data(), body.length()), 4);
+        data += body;
+    }
+
+    /**
+     * This reads back the records held in the given segment,
+     * stopping at the first one cut short or corrupted.
+     *
+     * @param[in] data
+     *      This is the content of the segment.
+     *
+     * @param[in] size
+     *      This is the size of the segment, in bytes.
+     *
+     * @param[in] replayDelegate
+     *      This is the function to call for each message read back.
+     */
+    void ReplaySegment(const char* data, size_t size,
+                       const ChatJournal::ReplayDelegate& replayDelegate) {
+        const auto end = data + size;
+        while ((size_t)(end - data) >= RECORD_HEADER_SIZE)
+        {
+            const auto length = (uint32_t)ReadNumber(data, 4);
+            const auto checksum = (uint32_t)ReadNumber(data + 4, 4);
+            const auto body = data + RECORD_HEADER_SIZE;
+            if ((length > MAX_RECORD_LENGTH) || ((size_t)(end - body) < length) || (length < 8) ||
+                (ComputeChecksum(body, length) != checksum))
+            { return; }
+            const auto bodyEnd = body + length;
+            ChatJournal::Record record;
+            record.seq = ReadNumber(body, 8);
+            auto field = body + 8;
+            if (!ReadString(field, bodyEnd, record.timestamp) ||
+                !ReadString(field, bodyEnd, record.sender) ||
+                !ReadString(field, bodyEnd, record.message))
+            { return; }
+            replayDelegate(std::move(record));
+            data = bodyEnd;
+        }
+    }
+
+    /**
+     * This maps the file at the given path into memory and reads back
+     * the records it holds.
+     *
+     * @param[in] path
+     *      This is the path of the segment to read back.
+     *
+     * @param[in] replayDelegate
+     *      This is the function to call for each message read back.
+     */
+    void ReplaySegmentFile(const std::string& path,
+                           const ChatJournal::ReplayDelegate& replayDelegate) {
+#ifdef _WIN32
+        const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        { return; }
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && (size.QuadPart > 0))
+        {
+            const auto mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping != NULL)
+            {
+                const auto data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (data != NULL)
+                {
+                    ReplaySegment(data, (size_t)size.QuadPart, replayDelegate);
+                    (void)UnmapViewOfFile(data);
+                }
+                (void)CloseHandle(mapping);
+            }
+        }
+        (void)CloseHandle(file);
+#else /* POSIX */
+        const auto file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        { return; }
+        struct stat status;
+        if ((fstat(file, &status) == 0) && (status.st_size > 0))
+        {
+            const auto size = (size_t)status.st_size;
+            const auto data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+            {
+                (void)madvise(data, size, MADV_SEQUENTIAL);
+                ReplaySegment((const char*)data, size, replayDelegate);
+                (void)munmap(data, size);
+            }
+        }
+        (void)close(file);
+#endif /* _WIN32 / POSIX */
+    }
+
+    /**
+     * This flushes to stable storage the entries of the given directory,
+     * so that files just created in it are still there after a crash.
+     *
+     * @param[in] directory
+     *      This is the path of the directory to flush.
+     *
+     * @return
+     *      An indication of whether or not the directory
+     *      was flushed is returned.
+     */
+    bool SyncDirectory(const std::string& directory) {
+#ifdef _WIN32
+        // Creating a file on NTFS is journaled along with its directory.
+        return true;
+#else /* POSIX */
+        const auto file = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (file < 0)
+        { return false; }
+        const auto synced = (fsync(file) == 0);
+        (void)close(file);
+        return synced;
+#endif /* _WIN32 / POSIX */
+    }
+
+    /**
+     * This is a segment file open for appending records.
+     */
+    class SegmentWriter
+    {
+        // Lifecycle Methods
+    public:
+        ~SegmentWriter() noexcept { Close(); }
+        SegmentWriter() = default;
+        SegmentWriter(const SegmentWriter&) = delete;
+        SegmentWriter(SegmentWriter&&) noexcept = delete;
+        SegmentWriter& operator=(const SegmentWriter&) = delete;
+        SegmentWriter& operator=(SegmentWriter&&) noexcept = delete;
+
+        // Public methods
+    public:
+        /**
+         * This method creates the segment at the given path,
+         * replacing any segment already there.
+         *
+         * @param[in] path
+         *      This is the path of the segment to create.
+         *
+         * @return
+         *      An indication of whether or not the segment
+         *      was created is returned.
+         */
+        bool Create(const std::string& path) {
+            Close();
+#ifdef _WIN32
+            file_ = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file_ == INVALID_HANDLE_VALUE)
+            { return false; }
+#else /* POSIX */
+            file_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+            if (file_ < 0)
+            { return false; }
+#endif /* _WIN32 / POSIX */
+            size_ = 0;
+            return true;
+        }
+
+        /**
+         * This method appends the given data to the segment and
+         * flushes it to stable storage.
+         *
+         * @param[in] data
+         *      This is the data to append.
+         *
+         * @return
+         *      An indication of whether or not the data was
+         *      written and flushed is returned.
+         */
+        bool Write(const std::string& data) {
+            if (!IsOpen())
+            { return false; }
+            size_t written = 0;
+            while (written < data.length())
+            {
+#ifdef _WIN32
+                DWORD amount = 0;
+                if (!WriteFile(file_, data.data() + written,
+                               (DWORD)std::min(data.length() - written, (size_t)(1 << 30)),
+                               &amount, NULL))
+                { return false; }
+#else /* POSIX */
+                const auto amount = write(file_, data.data() + written, data.length() - written);
+                if (amount < 0)
+                { return false; }
+#endif /* _WIN32 / POSIX */
+                written += (size_t)amount;
+            }
+            size_ += written;
+#ifdef _WIN32
+            return (FlushFileBuffers(file_) != 0);
+#elif defined(__APPLE__)
+            return (fsync(file_) == 0);
+#else /* POSIX */
+            return (fdatasync(file_) == 0);
+#endif /* _WIN32 / __APPLE__ / POSIX */
+        }
+
+        /**
+         * This method closes the segment.
+         */
+        void Close() {
+            if (!IsOpen())
+            { return; }
+#ifdef _WIN32
+            (void)CloseHandle(file_);
+            file_ = INVALID_HANDLE_VALUE;
+#else /* POSIX */
+            (void)close(file_);
+            file_ = -1;
+#endif /* _WIN32 / POSIX */
+        }
+
+        /**
+         * This method indicates whether or not the segment is open.
+         *
+         * @return
+         *      An indication of whether or not the segment
+         *      is open is returned.
+         */
+        bool IsOpen() const {
+#ifdef _WIN32
+            return (file_ != INVALID_HANDLE_VALUE);
+#else /* POSIX */
+            return (file_ >= 0);
+#endif /* _WIN32 / POSIX */
+        }
+
+        /**
+         * This method returns the number of bytes written to the segment.
+         *
+         * @return
+         *      The number of bytes written to the segment is returned.
+         */
+        size_t GetSize() const { return size_; }
+
+        // Private properties
+    private:
+        /**
+         * This is the operating system handle to the segment file.
+         */
+#ifdef _WIN32
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+#else /* POSIX */
+        int file_ = -1;
+#endif /* _WIN32 / POSIX */
+
+        /**
+         * This is the number of bytes written to the segment.
+         */
+        size_t size_ = 0;
+    };
+}  // namespace
+
+struct ChatJournal::Impl
+{
+    // Types
+
+    /**
+     * This identifies one segment of the log.
+     */
+    struct Segment
+    {
+        /**
+         * This is the sequence number of the first message of the segment.
+         */
+        uint64_t firstSeq = 0;
+
+        /**
+         * This is the path of the segment file.
+         */
+        std::string path;
+    };
+
+    // Properties
+
+    /**
+     * This is a helper object used to generate and publish
+     * diagnostic messages.
+     */
+    SystemUtils::DiagnosticsSender diagnosticsSender;
+
+    /**
+     * This is the path of the directory holding the log.
+     */
+    std::string directory;
+
+    /**
+     * This is the size, in bytes, past which a new segment is started.
+     */
+    size_t segmentSize = 0;
+
+    /**
+     * This synchronizes access to the messages queued
+     * and the state of the writer thread.
+     */
+    std::mutex mutex;
+
+    /**
+     * This is used to wake up the writer thread.
+     */
+    std::condition_variable writerWakeCondition;
+
+    /**
+     * This is the thread appending messages to the log.
+     */
+    std::thread writerThread;
+
+    /**
+     * This indicates whether or not the writer thread should stop
+     * once it's written all the messages queued.
+     */
+    bool stopWriter = false;
+
+    /**
+     * These are the encoded records waiting to be written.
+     */
+    std::string pending;
+
+    /**
+     * This is the sequence number of the first message waiting
+     * to be written.
+     */
+    uint64_t pendingFirstSeq = 0;
+
+    /**
+     * This is the sequence number of the oldest message which must
+     * be kept in the log.
+     */
+    uint64_t trimSeq = 0;
+
+    /**
+     * These are the segments of the log, oldest first. It's only used
+     * by the writer thread once started.
+     */
+    std::vector<Segment> segments;
+
+    /**
+     * This is the segment to which messages are appended.
+     */
+    SegmentWriter writer;
+
+    /**
+     * This method returns the path of the segment whose first message
+     * has the given sequence number.
+     *
+     * @param[in] firstSeq
+     *      This is the sequence number of the first message of the segment.
+     *
+     * @return
+     *      The path of the segment is returned.
+     */
+    std::string GetSegmentPath(uint64_t firstSeq) const {
+        return directory + "/" + StringUtils::sprintf("%020" PRIu64, firstSeq) + SEGMENT_EXTENSION;
+    }
+
+    // Methods
+
+    /**
+     * This is the constructor of the structure.
+     */
+    Impl() : diagnosticsSender("ChatJournal") {}
+
+    /**
+     * This method writes the given batch of records to the log, starting
+     * a new segment first if the current one is full, or if the last
+     * batch failed to be written, and deletes the segments no longer needed.
+     *
+     * @param[in] batch
+     *      These are the encoded records to write.
+     *
+     * @param[in] batchFirstSeq
+     *      This is the sequence number of the first message of the batch.
+     *
+     * @param[in] keepSeq
+     *      This is the sequence number of the oldest message
+     *      which must be kept in the log.
+     */
+    void WriteBatch(const std::string& batch, uint64_t batchFirstSeq, uint64_t keepSeq) {
+        if (!writer.IsOpen() || (writer.GetSize() >= segmentSize))
+        {
+            Segment segment;
+            segment.firstSeq = batchFirstSeq;
+            segment.path = GetSegmentPath(batchFirstSeq);
+            if (!writer.Create(segment.path))
+            {
+                diagnosticsSender.SendDiagnosticInformationFormatted(
+                    SystemUtils::DiagnosticsSender::Levels::ERROR,
+                    "unable to create '%s'; messages from %" PRIu64 " are not kept on disk",
+                    segment.path.c_str(), batchFirstSeq);
+                return;
+            }
+            if (!SyncDirectory(directory))
+            {
+                diagnosticsSender.SendDiagnosticInformationFormatted(
+                    SystemUtils::DiagnosticsSender::Levels::WARNING,
+                    "unable to flush '%s' after creating a segment in it", directory.c_str());
+            }
+            if (!segments.empty() && (segments.back().firstSeq == batchFirstSeq))
+            { segments.pop_back(); }
+            segments.push_back(std::move(segment));
+        }
+        if (!writer.Write(batch))
+        {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemUtils::DiagnosticsSender::Levels::ERROR,
+                "unable to write to '%s'; messages from %" PRIu64 " may not be kept on disk",
+                segments.back().path.c_str(), batchFirstSeq);
+            writer.Close();
+        }
+        while ((segments.size() > 1) && (segments[1].firstSeq <= keepSeq))
+        {
+            SystemUtils::File(segments.front().path).Destroy();
+            (void)segments.erase(segments.begin());
+        }
+    }
+
+    /**
+     * This is called in a separate thread to append
+     * queued messages to the log, in batches.
+     */
+    void Writer() {
+        std::unique_lock<decltype(mutex)> lock(mutex);
+        for (;;)
+        {
+            writerWakeCondition.wait(lock, [this] { return stopWriter || !pending.empty(); });
+            if (pending.empty())
+            { break; }
+            std::string batch;
+            batch.swap(pending);
+            const auto batchFirstSeq = pendingFirstSeq;
+            const auto keepSeq = trimSeq;
+            lock.unlock();
+            WriteBatch(batch, batchFirstSeq, keepSeq);
+            lock.lock();
+        }
+        writer.Close();
+    }
+};
+
+ChatJournal::~ChatJournal() noexcept {
+    Close();
+}
+
+ChatJournal::ChatJournal(const std::string& directory, size_t segmentSize) : impl_(new Impl()) {
+    impl_->directory = directory;
+    impl_->segmentSize = segmentSize;
+}
+
+SystemUtils::DiagnosticsSender::UnsubscribeDelegate ChatJournal::SubscribeToDiagnostics(
+    SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate delegate, size_t minLevel) {
+    return impl_->diagnosticsSender.SubscribeToDiagnostics(delegate, minLevel);
+}
+
+bool ChatJournal::Open(ReplayDelegate replayDelegate) {
+    Close();
+    SystemUtils::File directory(impl_->directory);
+    if (!directory.IsDirectory() && !SystemUtils::File::CreateDirectory(impl_->directory))
+    { return false; }
+    impl_->segments.clear();
+    std::vector<std::string> entries;
+    SystemUtils::File::ListDirectory(impl_->directory, entries);
+    for (const auto& entry : entries)
+    {
+        const auto name = entry.substr(entry.find_last_of("/\\") + 1);
+        if ((name.length() != SEGMENT_NAME_DIGITS + SEGMENT_EXTENSION.length()) ||
+            (name.substr(SEGMENT_NAME_DIGITS) != SEGMENT_EXTENSION) ||
+            (name.find_first_not_of("0123456789") != SEGMENT_NAME_DIGITS))
+        { continue; }
+        Impl::Segment segment;
+        segment.firstSeq = (uint64_t)strtoull(name.c_str(), NULL, 10);
+        segment.path = impl_->directory + "/" + name;
+        impl_->segments.push_back(std::move(segment));
+    }
+    std::sort(impl_->segments.begin(), impl_->segments.end(),
+              [](const Impl::Segment& a, const Impl::Segment& b)
+              { return a.firstSeq < b.firstSeq; });
+    for (const auto& segment : impl_->segments)
+    { ReplaySegmentFile(segment.path, replayDelegate); }
+    impl_->stopWriter = false;
+    impl_->writerThread = std::thread(&Impl::Writer, impl_.get());
+    return true;
+}
+
+void ChatJournal::Append(const Record& record) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (impl_->pending.empty())
+    { impl_->pendingFirstSeq = record.seq; }
+    EncodeRecord(record, impl_->pending);
+    impl_->writerWakeCondition.notify_all();
+}
+
+void ChatJournal::Trim(uint64_t firstSeq) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    impl_->trimSeq = firstSeq;
+}
+
+void ChatJournal::Close() {
+    if (!impl_->writerThread.joinable())
+    { return; }
+    {
+        std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+        impl_->stopWriter = true;
+        impl_->writerWakeCondition.notify_all();
+    }
+    impl_->writerThread.join();
+}
+
+void ChatJournal::Destroy() {
+    Close();
+    impl_->segments.clear();
+    (void)SystemUtils::File::DeleteDirectory(impl_->directory);
+}
@@ -0,0 +1,187 @@
+#ifndef CHAT_ROOM_PLUGIN_CHAT_JOURNAL_HPP
+#define CHAT_ROOM_PLUGIN_CHAT_JOURNAL_HPP
+
+/**
+ * @file ChatJournal.hpp
+ *
+ * This module declares the ChatJournal class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <SystemUtils/DiagnosticsSender.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * This class keeps the messages posted to a chat room in an append-only
+ * log on disk, so that the history of the chat room outlives the process,
+ * and the plug-in being replaced.
+ *
+ * The log is split into segment files held in one directory, each named
+ * after the sequence number of its first message, so that the oldest
+ * segments can be deleted once the chat room no longer retains any of
+ * their messages.
+ *
+ * Messages are appended by a background thread. Messages appended while
+ * it's writing are written together in the next batch, with a single
+ * flush to stable storage per batch rather than one per message.
+ *
+ * Each record of a segment is laid out as follows, with all numbers
+ * stored as little-endian unsigned integers:
+ *
+ * - 32-bit length of the rest of the record, after the checksum.
+ * - 32-bit FNV-1a checksum of the rest of the record.
+ * - 64-bit sequence number of the message.
+ * - 32-bit length of the time, followed by the time.
+ * - 32-bit length of the sender name, followed by the sender name.
+ * - 32-bit length of the message, followed by the message.
+ *
+ * A record cut short or failing its checksum, which is what is left if
+ * the process stops while writing, ends the replay of its segment.
+ * Should a batch fail to be written, a new segment is started for the
+ * next batch, so that the records after it aren't lost behind it.
+ */
+class ChatJournal
+{
+    // Types
+public:
+    /**
+     * This is one message held in the log.
+     */
+    struct Record
+    {
+        /**
+         * This is the sequence number of the message.
+         */
+        uint64_t seq = 0;
+
+        /**
+         * This is the time given by the user who posted the message.
+         */
+        std::string timestamp;
+
+        /**
+         * This is the user name of the user who posted the message.
+         */
+        std::string sender;
+
+        /**
+         * This is the content of the message.
+         */
+        std::string message;
+    };
+
+    /**
+     * This is the type of function called for each message
+     * read back from the log.
+     *
+     * @param[in] record
+     *      This is the message read back.
+     */
+    typedef std::function<void(Record&& record)> ReplayDelegate;
+
+    // Lifecycle Methods
+public:
+    ~ChatJournal() noexcept;
+    ChatJournal(const ChatJournal&) = delete;
+    ChatJournal(ChatJournal&&) noexcept = delete;
+    ChatJournal& operator=(const ChatJournal&) = delete;
+    ChatJournal& operator=(ChatJournal&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] directory
+     *      This is the path of the directory holding the log.
+     *
+     * @param[in] segmentSize
+     *      This is the size, in bytes, past which a new segment is started.
+     */
+    ChatJournal(const std::string& directory, size_t segmentSize);
+
+    /**
+     * This method forms a new subscription to diagnostic
+     * messages published by the log.
+     *
+     * @param[in] delegate
+     *      This is the function to call to deliver messages
+     *      to the subscriber.
+     *
+     * @param[in] minLevel
+     *      This is the minimum level of message that this subscriber
+     *      desires to receive.
+     *
+     * @return
+     *      A function is returned which may be called
+     *      to terminate the subscription.
+     */
+    SystemUtils::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate delegate, size_t minLevel = 0);
+
+    /**
+     * This method reads back the messages held in the log, mapping each
+     * segment into memory in turn, and then starts the thread appending
+     * new messages to it.
+     *
+     * @param[in] replayDelegate
+     *      This is the function to call for each message read back,
+     *      oldest first.
+     *
+     * @return
+     *      An indication of whether or not the log could be opened
+     *      is returned.
+     */
+    bool Open(ReplayDelegate replayDelegate);
+
+    /**
+     * This method queues the given message to be appended to the log.
+     *
+     * @param[in] record
+     *      This is the message to append.
+     */
+    void Append(const Record& record);
+
+    /**
+     * This method lets the log delete segments holding
+     * only messages older than the given one.
+     *
+     * @param[in] firstSeq
+     *      This is the sequence number of the oldest message
+     *      which must be kept.
+     */
+    void Trim(uint64_t firstSeq);
+
+    /**
+     * This method writes any messages still queued, flushes them to
+     * stable storage, and stops the thread appending to the log.
+     */
+    void Close();
+
+    /**
+     * This method closes the log and deletes it from disk,
+     * along with the directory holding it.
+     */
+    void Destroy();
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* CHAT_ROOM_PLUGIN_CHAT_JOURNAL_HPP */
@@ -0,0 +1,963 @@
+/**
+ * @file ChatProtocol.cpp
+ *
+ * This module contains the implementation of the functions used to
+ * encode and decode the messages exchanged with users of the chat room.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include "ChatProtocol.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <map>
+
+namespace
+{
+    /**
+     * These are the names of the fields of messages, indexed by
+     * the integer keys which stand for them in MessagePack.
+     */
+    const char* const FIELD_NAMES[] = {
+        "Type",
+        "UserName",
+        "Password",
+        "Success",
+        "Chat",
+        "Time",
+        "Seq",
+        "Sender",
+        "ChatLog",
+        "Cursor",
+        "More",
+        "UserNames",
+        "After",
+        "Before",
+        "Count",
+        "OldUserName",
+    };
+
+    /**
+     * This is the number of fields with integer keys.
+     */
+    constexpr size_t NUM_FIELDS = sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]);
+
+    /**
+     * These are the integer keys of the fields decoded or encoded
+     * without going through JSON values, matching FIELD_NAMES.
+     */
+    enum Field : size_t
+    {
+        FIELD_TYPE = 0,
+        FIELD_USER_NAME = 1,
+        FIELD_PASSWORD = 2,
+        FIELD_CHAT = 4,
+        FIELD_TIME = 5,
+        FIELD_SEQ = 6,
+        FIELD_SENDER = 7,
+        FIELD_AFTER = 12,
+        FIELD_BEFORE = 13,
+        FIELD_COUNT = 14,
+    };
+
+    /**
+     * These are the names of the kinds of messages,
+     * indexed by their integer tags.
+     */
+    const char* const MESSAGE_TYPE_NAMES[] = {
+        "",
+        "SetUserName",
+        "SetUserNameResult",
+        "GetUserNames",
+        "UserNames",
+        "PostChat",
+        "PostChatResult",
+        "JoinChatRoom",
+        "JoinChatRoomResponse",
+        "GetChatLog",
+        "ChatLog",
+        "Leave",
+        "UserNameModified",
+    };
+
+    /**
+     * This is the number of kinds of messages, including
+     * the one standing for unknown messages.
+     */
+    constexpr size_t NUM_MESSAGE_TYPES = sizeof(MESSAGE_TYPE_NAMES) / sizeof(MESSAGE_TYPE_NAMES[0]);
+
+    /**
+     * This is the deepest that arrays and maps may be nested
+     * in a message decoded from MessagePack.
+     */
+    constexpr size_t MAX_DEPTH = 16;
+
+    /**
+     * This returns the integer key standing for the field with the given
+     * name in MessagePack.
+     *
+     * @param[in] name
+     *      This is the name of the field.
+     *
+     * @return
+     *      The integer key standing for the field is returned,
+     *      or NUM_FIELDS if the field has none.
+     */
+    size_t GetFieldKey(const std::string& name) {
+        static const auto keys = []
+        {
+            std::map<std::string, size_t> keys;
+            for (size_t i = 0; i < NUM_FIELDS; ++i)
+            { keys[FIELD_NAMES[i]] = i; }
+            return keys;
+        }();
+        const auto key = keys.find(name);
+        return (key == keys.end()) ? NUM_FIELDS : key->second;
+    }
+
+    /**
+     * This tells whether or not the given bytes are a valid UTF-8
+     * encoding, which may be sent in WebSocket text frames. Overlong
+     * encodings, surrogates and code points past U+10FFFF are invalid.
+     *
+     * @param[in] bytes
+     *      These are the bytes to check.
+     *
+     * @param[in] length
+     *      This is the number of bytes to check.
+     *
+     * @return
+     *      An indication of whether or not the bytes
+     *      are valid UTF-8 is returned.
+     */
+    bool IsValidUtf8(const char* bytes, size_t length) {
+        for (size_t i = 0; i < length;)
+        {
+            const auto lead = (uint8_t)bytes[i];
+            size_t continuations = 0;
+            uint32_t codePoint = 0;
+            uint32_t minCodePoint = 0;
+            if (lead < 0x80)
+            {
+                ++i;
+                continue;
+            } else if ((lead & 0xE0) == 0xC0)
+            {
+                continuations = 1;
+                codePoint = lead & 0x1F;
+                minCodePoint = 0x80;
+            } else if ((lead & 0xF0) == 0xE0)
+            {
+                continuations = 2;
+                codePoint = lead & 0x0F;
+                minCodePoint = 0x800;
+            } else if ((lead & 0xF8) == 0xF0)
+            {
+                continuations = 3;
+                codePoint = lead & 0x07;
+                minCodePoint = 0x10000;
+            } else
+            { return false; }
+            if (length - i <= continuations)
+            { return false; }
+            for (size_t j = 1; j <= continuations; ++j)
+            {
+                const auto continuation = (uint8_t)bytes[i + j];
+                if ((continuation & 0xC0) != 0x80)
+                { return false; }
+                codePoint = (codePoint << 6) | (continuation & 0x3F);
+            }
+            if ((codePoint < minCodePoint) || (codePoint > 0x10FFFF) ||
+                ((codePoint >= 0xD800) && (codePoint <= 0xDFFF)))
+            { return false; }
+            i += continuations + 1;
+        }
+        return true;
+    }
+
+    /**
+     * This appends a big-endian number of the given size
+     * to the given encoding.
+     *
+     * @param[in, out] encoding
+     *      This is the encoding to which to append the number.
+     *
+     * @param[in] value
+     *      This is the number to append.
+     *
+     * @param[in] size
+     *      This is the number of bytes of the number.
+     */
+    void AppendNumber(std::string& encoding, uint64_t value, size_t size) {
+        for (size_t i = size; i > 0; --i)
+        { encoding.push_back((char)((value >> ((i - 1) * 8)) & 0xFF)); }
+    }
+
+    /**
+     * This appends the header of a MessagePack string, array, or map
+     * of the given length to the given encoding, picking the shortest
+     * form which fits.
+     *
+     * @param[in, out] encoding
+     *      This is the encoding to which to append the header.
+     *
+     * @param[in] length
+     *      This is the length of the string, array, or map.
+     *
+     * @param[in] fixPrefix
+     *      This is the prefix of the form holding the length
+     *      in the same byte.
+     *
+     * @param[in] fixLimit
+     *      This is the first length which doesn't fit
+     *      in the same byte.
+     *
+     * @param[in] prefix16
+     *      This is the prefix of the form holding
+     *      a 16-bit length, after the prefix.
+     */
+    void AppendHeader(std::string& encoding, size_t length, uint8_t fixPrefix, size_t fixLimit,
+                      uint8_t prefix16) {
+        if (length < fixLimit)
+        {
+            encoding.push_back((char)(fixPrefix | length));
+        } else if (length <= 0xFFFF)
+        {
+            encoding.push_back((char)prefix16);
+            AppendNumber(encoding, length, 2);
+        } else
+        {
+            encoding.push_back((char)(prefix16 + 1));
+            AppendNumber(encoding, length, 4);
+        }
+    }
+
+    /**
+     * This appends the given string encoded in MessagePack
+     * to the given encoding.
+     *
+     * @param[in, out] encoding
+     *      This is the encoding to which to append the string.
+     *
+     * @param[in] value
+     *      This is the string to append.
+     */
+    void AppendString(std::string& encoding, const std::string& value) {
+        if ((value.length() >= 32) && (value.length() <= 0xFF))
+        {
+            encoding.push_back((char)0xD9);
+            encoding.push_back((char)value.length());
+        } else
+        { AppendHeader(encoding, value.length(), 0xA0, 32, 0xDA); }
+        encoding += value;
+    }
+
+    /**
+     * This appends the given integer encoded in MessagePack
+     * to the given encoding, picking the shortest form which fits.
+     *
+     * @param[in, out] encoding
+     *      This is the encoding to which to append the integer.
+     *
+     * @param[in] value
+     *      This is the integer to append.
+     */
+    void AppendInteger(std::string& encoding, intmax_t value) {
+        if ((value >= -32) && (value < 128))
+        {
+            encoding.push_back((char)(int8_t)value);
+        } else if (value > 0)
+        {
+            if (value <= 0xFF)
+            {
+                encoding.push_back((char)0xCC);
+                AppendNumber(encoding, (uint64_t)value, 1);
+            } else if (value <= 0xFFFF)
+            {
+                encoding.push_back((char)0xCD);
+                AppendNumber(encoding, (uint64_t)value, 2);
+            } else if (value <= 0xFFFFFFFF)
+            {
+                encoding.push_back((char)0xCE);
+                AppendNumber(encoding, (uint64_t)value, 4);
+            } else
+            {
+                encoding.push_back((char)0xCF);
+                AppendNumber(encoding, (uint64_t)value, 8);
+            }
+        } else if (value >= INT16_MIN)
+        {
+            encoding.push_back((char)0xD1);
+            AppendNumber(encoding, (uint64_t)value, 2);
+        } else
+        {
+            encoding.push_back((char)0xD3);
+            AppendNumber(encoding, (uint64_t)value, 8);
+        }
+    }
+
+    /**
+     * This appends the given string, quoted and escaped as
+     * a JSON string, to the given encoding.
+     *
+     * @param[in, out] encoding
+     *      This is the encoding to which to append the string.
+     *
+     * @param[in] value
+     *      This is the string to append.
+     */
+    void AppendJsonString(std::string& encoding, const std::string& value) {
+        static const char* const HEX_DIGITS = "0123456789ABCDEF";
+        encoding.push_back('"');
+        for (const auto c : value)
+        {
+            switch (c)
+            {
+            case '"':
+            case '\\': {
+                encoding.push_back('\\');
+                encoding.push_back(c);
+            }
+            break;
+
+            case '\b': {
+                encoding += "\\b";
+            }
+            break;
+
+            case '\f': {
+                encoding += "\\f";
+            }
+            break;
+
+            case '\n': {
+                encoding += "\\n";
+            }
+            break;
+
+            case '\r': {
+                encoding += "\\r";
+            }
+            break;
+
+            case '\t': {
+                encoding += "\\t";
+            }
+            break;
+
+            default: {
+                if ((uint8_t)c < 0x20)
+                {
+                    encoding += "\\u00";
+                    encoding.push_back(HEX_DIGITS[(uint8_t)c >> 4]);
+                    encoding.push_back(HEX_DIGITS[(uint8_t)c & 0x0F]);
+                } else
+                { encoding.push_back(c); }
+            }
+            break;
+            }
+        }
+        encoding.push_back('"');
+    }
+
+    /**
+     * This appends the given value encoded in MessagePack
+     * to the given encoding.
+     *
+     * @param[in, out] encoding
+     *      This is the encoding to which to append the value.
+     *
+     * @param[in] value
+     *      This is the value to append.
+     *
+     * @param[in] isMessage
+     *      This indicates whether or not the value is a whole message,
+     *      whose field names and type are to be replaced
+     *      by their integer tags.
+     */
+    void AppendValue(std::string& encoding, const Json::Value& value, bool isMessage) {
+        switch (value.GetType())
+        {
+        case Json::Value::Type::Boolean: {
+            encoding.push_back((bool)value ? (char)0xC3 : (char)0xC2);
+        }
+        break;
+
+        case Json::Value::Type::String: {
+            AppendString(encoding, value);
+        }
+        break;
+
+        case Json::Value::Type::Integer: {
+            AppendInteger(encoding, (intmax_t)value);
+        }
+        break;
+
+        case Json::Value::Type::FloatingPoint: {
+            const auto floatingPoint = (double)value;
+            uint64_t bits;
+            (void)memcpy(&bits, &floatingPoint, sizeof(bits));
+            encoding.push_back((char)0xCB);
+            AppendNumber(encoding, bits, 8);
+        }
+        break;
+
+        case Json::Value::Type::Array: {
+            const auto size = value.GetSize();
+            AppendHeader(encoding, size, 0x90, 16, 0xDC);
+            for (size_t i = 0; i < size; ++i)
+            { AppendValue(encoding, value[i], false); }
+        }
+        break;
+
+        case Json::Value::Type::Object: {
+            const auto keys = value.GetKeys();
+            AppendHeader(encoding, keys.size(), 0x80, 16, 0xDE);
+            for (const auto& key : keys)
+            {
+                const auto fieldKey = (isMessage ? GetFieldKey(key) : NUM_FIELDS);
+                if (fieldKey == NUM_FIELDS)
+                {
+                    AppendString(encoding, key);
+                    AppendValue(encoding, value[key], false);
+                    continue;
+                }
+                AppendInteger(encoding, (intmax_t)fieldKey);
+                const auto type = ((fieldKey == 0)
+                                       ? ChatProtocol::GetMessageType(value[key])
+                                       : ChatProtocol::MessageType::Unknown);
+                if (type == ChatProtocol::MessageType::Unknown)
+                {
+                    AppendValue(encoding, value[key], false);
+                } else
+                { AppendInteger(encoding, (intmax_t)type); }
+            }
+        }
+        break;
+
+        default: {
+            encoding.push_back((char)0xC0);
+        }
+        break;
+        }
+    }
+
+    /**
+     * This reads MessagePack-encoded values from a buffer.
+     */
+    struct Reader
+    {
+        // Properties
+
+        /**
+         * This is the encoding to read.
+         */
+        const std::string& encoding;
+
+        /**
+         * This is the position of the next byte to read.
+         */
+        size_t position = 0;
+
+        // Methods
+
+        /**
+         * This is the constructor of the structure.
+         *
+         * @param[in] encoding
+         *      This is the encoding to read.
+         */
+        explicit Reader(const std::string& encoding) : encoding(encoding) {}
+
+        /**
+         * This method reads a big-endian number of the given size.
+         *
+         * @param[in] size
+         *      This is the number of bytes of the number.
+         *
+         * @param[out] value
+         *      This is where to store the number.
+         *
+         * @return
+         *      An indication of whether or not the number
+         *      could be read is returned.
+         */
+        bool ReadNumber(size_t size, uint64_t& value) {
+            if (encoding.length() - position < size)
+            { return false; }
+            value = 0;
+            for (size_t i = 0; i < size; ++i)
+            { value = (value << 8) | (uint8_t)encoding[position++]; }
+            return true;
+        }
+
+        /**
+         * This method reads a string of the given length,
+         * which must be valid UTF-8.
+         *
+         * @param[in] length
+         *      This is the length of the string.
+         *
+         * @param[out] value
+         *      This is where to store the string.
+         *
+         * @return
+         *      An indication of whether or not a valid string
+         *      could be read is returned.
+         */
+        bool ReadString(uint64_t length, Json::Value& value) {
+            if ((encoding.length() - position < length) ||
+                !IsValidUtf8(encoding.data() + position, (size_t)length))
+            { return false; }
+            value = encoding.substr(position, (size_t)length);
+            position += (size_t)length;
+            return true;
+        }
+
+        /**
+         * This method reads a string of the given length,
+         * which must be valid UTF-8.
+         *
+         * @param[in] length
+         *      This is the length of the string.
+         *
+         * @param[out] value
+         *      This is where to store the string.
+         *
+         * @return
+         *      An indication of whether or not a valid string
+         *      could be read is returned.
+         */
+        bool ReadString(uint64_t length, std::string& value) {
+            if ((encoding.length() - position < length) ||
+                !IsValidUtf8(encoding.data() + position, (size_t)length))
+            { return false; }
+            value.assign(encoding, position, (size_t)length);
+            position += (size_t)length;
+            return true;
+        }
+
+        /**
+         * These are the kinds of values told apart by ReadScalar.
+         */
+        enum class ScalarType
+        {
+            String,
+            Integer,
+            Other,
+        };
+
+        /**
+         * This method reads one value, storing it directly if it's
+         * a string or an integer, and skipping it otherwise.
+         *
+         * @param[out] type
+         *      This is where to store the kind of value read.
+         *
+         * @param[out] string
+         *      This is where to store the value, if it's a string.
+         *
+         * @param[out] integer
+         *      This is where to store the value, if it's an integer.
+         *
+         * @return
+         *      An indication of whether or not the value
+         *      could be read is returned.
+         */
+        bool ReadScalar(ScalarType& type, std::string& string, intmax_t& integer) {
+            if (position >= encoding.length())
+            { return false; }
+            const auto prefix = (uint8_t)encoding[position];
+            uint64_t number = 0;
+            if ((prefix < 0x80) || (prefix >= 0xE0))
+            {
+                ++position;
+                type = ScalarType::Integer;
+                integer = ((prefix < 0x80) ? (intmax_t)prefix : (intmax_t)(int8_t)prefix);
+                return true;
+            } else if ((prefix & 0xE0) == 0xA0)
+            {
+                ++position;
+                type = ScalarType::String;
+                return ReadString(prefix & 0x1F, string);
+            } else if ((prefix >= 0xD9) && (prefix <= 0xDB))
+            {
+                ++position;
+                type = ScalarType::String;
+                return (ReadNumber((size_t)1 << (prefix - 0xD9), number) &&
+                        ReadString(number, string));
+            } else if ((prefix >= 0xCC) && (prefix <= 0xCF))
+            {
+                ++position;
+                type = ScalarType::Integer;
+                if (!ReadNumber((size_t)1 << (prefix - 0xCC), number) ||
+                    (number > (uint64_t)INTMAX_MAX))
+                { return false; }
+                integer = (intmax_t)number;
+                return true;
+            } else if ((prefix >= 0xD0) && (prefix <= 0xD3))
+            {
+                ++position;
+                type = ScalarType::Integer;
+                const auto size = (size_t)1 << (prefix - 0xD0);
+                if (!ReadNumber(size, number))
+                { return false; }
+                const auto shift = 64 - size * 8;
+                integer = (intmax_t)((int64_t)(number << shift) >> shift);
+                return true;
+            }
+            type = ScalarType::Other;
+            Json::Value value;
+            return ReadValue(value, 1);
+        }
+
+        /**
+         * This method reads one value.
+         *
+         * @param[out] value
+         *      This is where to store the value.
+         *
+         * @param[in] depth
+         *      This is how deep the value is nested in arrays and maps.
+         *
+         * @return
+         *      An indication of whether or not the value
+         *      could be read is returned.
+         */
+        bool ReadValue(Json::Value& value, size_t depth) {
+            uint64_t prefix;
+            if (!ReadNumber(1, prefix))
+            { return false; }
+            uint64_t number = 0;
+            if (prefix < 0x80)
+            {
+                value = Json::Value((intmax_t)prefix);
+                return true;
+            } else if (prefix >= 0xE0)
+            {
+                value = Json::Value((intmax_t)(int8_t)prefix);
+                return true;
+            } else if ((prefix & 0xE0) == 0xA0)
+            {
+                return ReadString(prefix & 0x1F, value);
+            } else if ((prefix & 0xF0) == 0x90)
+            {
+                return ReadArray(prefix & 0x0F, value, depth);
+            } else if ((prefix & 0xF0) == 0x80)
+            { return ReadMap(prefix & 0x0F, value, depth); }
+            switch (prefix)
+            {
+            case 0xC0: {
+                value = Json::Value(Json::Value::Type::Null);
+            }
+            break;
+
+            case 0xC2:
+            case 0xC3: {
+                value = (prefix == 0xC3);
+            }
+            break;
+
+            case 0xC4:
+            case 0xC5:
+            case 0xC6:
+            case 0xD9:
+            case 0xDA:
+            case 0xDB: {
+                const auto lengthSize = (size_t)1 << ((prefix >= 0xD9) ? (prefix - 0xD9)
+                                                                        : (prefix - 0xC4));
+                return (ReadNumber(lengthSize, number) && ReadString(number, value));
+            }
+
+            case 0xCA: {
+                float floatingPoint;
+                if (!ReadNumber(4, number))
+                { return false; }
+                const auto bits = (uint32_t)number;
+                (void)memcpy(&floatingPoint, &bits, sizeof(floatingPoint));
+                value = (double)floatingPoint;
+            }
+            break;
+
+            case 0xCB: {
+                double floatingPoint;
+                if (!ReadNumber(8, number))
+                { return false; }
+                (void)memcpy(&floatingPoint, &number, sizeof(floatingPoint));
+                value = floatingPoint;
+            }
+            break;
+
+            case 0xCC:
+            case 0xCD:
+            case 0xCE:
+            case 0xCF: {
+                if (!ReadNumber((size_t)1 << (prefix - 0xCC), number) ||
+                    (number > (uint64_t)INTMAX_MAX))
+                { return false; }
+                value = Json::Value((intmax_t)number);
+            }
+            break;
+
+            case 0xD0:
+            case 0xD1:
+            case 0xD2:
+            case 0xD3: {
+                const auto size = (size_t)1 << (prefix - 0xD0);
+                if (!ReadNumber(size, number))
+                { return false; }
+                const auto shift = 64 - size * 8;
+                value = Json::Value((intmax_t)((int64_t)(number << shift) >> shift));
+            }
+            break;
+
+            case 0xDC:
+            case 0xDD: {
+                return (ReadNumber((prefix == 0xDC) ? 2 : 4, number) &&
+                        ReadArray(number, value, depth));
+            }
+
+            case 0xDE:
+            case 0xDF: {
+                return (ReadNumber((prefix == 0xDE) ? 2 : 4, number) &&
+                        ReadMap(number, value, depth));
+            }
+
+            default:
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * This method reads the elements of an array.
+         *
+         * @param[in] size
+         *      This is the number of elements of the array.
+         *
+         * @param[out] value
+         *      This is where to store the array.
+         *
+         * @param[in] depth
+         *      This is how deep the array is nested in arrays and maps.
+         *
+         * @return
+         *      An indication of whether or not the array
+         *      could be read is returned.
+         */
+        bool ReadArray(uint64_t size, Json::Value& value, size_t depth) {
+            if ((depth >= MAX_DEPTH) || (size > encoding.length() - position))
+            { return false; }
+            value = Json::Value(Json::Value::Type::Array);
+            for (uint64_t i = 0; i < size; ++i)
+            {
+                Json::Value element;
+                if (!ReadValue(element, depth + 1))
+                { return false; }
+                value.Add(element);
+            }
+            return true;
+        }
+
+        /**
+         * This method reads the entries of a map, keeping only
+         * those whose keys are strings.
+         *
+         * @param[in] size
+         *      This is the number of entries of the map.
+         *
+         * @param[out] value
+         *      This is where to store the map.
+         *
+         * @param[in] depth
+         *      This is how deep the map is nested in arrays and maps.
+         *
+         * @return
+         *      An indication of whether or not the map
+         *      could be read is returned.
+         */
+        bool ReadMap(uint64_t size, Json::Value& value, size_t depth) {
+            if ((depth >= MAX_DEPTH) || (size > encoding.length() - position))
+            { return false; }
+            value = Json::Value(Json::Value::Type::Object);
+            for (uint64_t i = 0; i < size; ++i)
+            {
+                Json::Value key;
+                Json::Value element;
+                if (!ReadValue(key, depth + 1) || !ReadValue(element, depth + 1))
+                { return false; }
+                if (key.GetType() == Json::Value::Type::String)
+                { value.Set(key, element); }
+            }
+            return true;
+        }
+    };
+}  // namespace
+
+namespace ChatProtocol
+{
+    MessageType GetMessageType(const std::string& name) {
+        static const auto types = []
+        {
+            std::map<std::string, MessageType> types;
+            for (size_t i = 1; i < NUM_MESSAGE_TYPES; ++i)
+            { types[MESSAGE_TYPE_NAMES[i]] = (MessageType)i; }
+            return types;
+        }();
+        const auto type = types.find(name);
+        return (type == types.end()) ? MessageType::Unknown : type->second;
+    }
+
+    std::string EncodeBinary(const Json::Value& message) {
+        std::string encoding;
+        AppendValue(encoding, message, true);
+        return encoding;
+    }
+
+    std::string EncodeText(const ChatPosted& chatPosted) {
+        std::string encoding = "{\"Type\":\"PostChatResult\",\"Seq\":";
+        encoding += std::to_string(chatPosted.seq);
+        encoding += ",\"Sender\":";
+        AppendJsonString(encoding, chatPosted.sender);
+        encoding += ",\"Chat\":";
+        AppendJsonString(encoding, chatPosted.chat);
+        encoding += ",\"Time\":";
+        AppendJsonString(encoding, chatPosted.time);
+        encoding.push_back('}');
+        return encoding;
+    }
+
+    std::string EncodeBinary(const ChatPosted& chatPosted) {
+        std::string encoding;
+        AppendHeader(encoding, 5, 0x80, 16, 0xDE);
+        AppendInteger(encoding, FIELD_TYPE);
+        AppendInteger(encoding, (intmax_t)MessageType::PostChatResult);
+        AppendInteger(encoding, FIELD_SEQ);
+        AppendInteger(encoding, (intmax_t)chatPosted.seq);
+        AppendInteger(encoding, FIELD_SENDER);
+        AppendString(encoding, chatPosted.sender);
+        AppendInteger(encoding, FIELD_CHAT);
+        AppendString(encoding, chatPosted.chat);
+        AppendInteger(encoding, FIELD_TIME);
+        AppendString(encoding, chatPosted.time);
+        return encoding;
+    }
+
+    bool DecodeText(const std::string& encoding, Request& request) {
+        const auto message = Json::Value::FromEncoding(encoding);
+        if (message.GetType() != Json::Value::Type::Object)
+        { return false; }
+        request.type = GetMessageType(message["Type"]);
+        request.hasUserName = message.Has("UserName");
+        request.userName = (std::string)message["UserName"];
+        request.password = (std::string)message["Password"];
+        request.hasChat = message.Has("Chat");
+        request.chat = (std::string)message["Chat"];
+        request.time = (std::string)message["Time"];
+        if (message.Has("After"))
+        { request.after = (int)message["After"]; }
+        if (message.Has("Before"))
+        { request.before = (int)message["Before"]; }
+        if (message.Has("Count"))
+        { request.count = (int)message["Count"]; }
+        return true;
+    }
+
+    bool DecodeBinary(const std::string& encoding, Request& request) {
+        Reader reader(encoding);
+        uint64_t prefix;
+        uint64_t size;
+        if (!reader.ReadNumber(1, prefix))
+        { return false; }
+        if ((prefix & 0xF0) == 0x80)
+        {
+            size = prefix & 0x0F;
+        } else if ((prefix == 0xDE) || (prefix == 0xDF))
+        {
+            if (!reader.ReadNumber((prefix == 0xDE) ? 2 : 4, size))
+            { return false; }
+        } else
+        { return false; }
+        for (uint64_t i = 0; i < size; ++i)
+        {
+            auto keyType = Reader::ScalarType::Other;
+            std::string keyString;
+            intmax_t keyInteger = 0;
+            auto valueType = Reader::ScalarType::Other;
+            std::string valueString;
+            intmax_t valueInteger = 0;
+            if (!reader.ReadScalar(keyType, keyString, keyInteger) ||
+                !reader.ReadScalar(valueType, valueString, valueInteger))
+            { return false; }
+            auto field = NUM_FIELDS;
+            if (keyType == Reader::ScalarType::Integer)
+            {
+                if ((keyInteger >= 0) && ((size_t)keyInteger < NUM_FIELDS))
+                { field = (size_t)keyInteger; }
+            } else if (keyType == Reader::ScalarType::String)
+            { field = GetFieldKey(keyString); }
+            const auto isString = (valueType == Reader::ScalarType::String);
+            const auto isInteger = (valueType == Reader::ScalarType::Integer);
+            switch (field)
+            {
+            case FIELD_TYPE: {
+                if (isInteger)
+                {
+                    if ((valueInteger > 0) && ((size_t)valueInteger < NUM_MESSAGE_TYPES))
+                    { request.type = (MessageType)valueInteger; }
+                } else if (isString)
+                { request.type = GetMessageType(valueString); }
+            }
+            break;
+
+            case FIELD_USER_NAME: {
+                request.hasUserName = true;
+                if (isString)
+                { request.userName = std::move(valueString); }
+            }
+            break;
+
+            case FIELD_PASSWORD: {
+                if (isString)
+                { request.password = std::move(valueString); }
+            }
+            break;
+
+            case FIELD_CHAT: {
+                request.hasChat = true;
+                if (isString)
+                { request.chat = std::move(valueString); }
+            }
+            break;
+
+            case FIELD_TIME: {
+                if (isString)
+                { request.time = std::move(valueString); }
+            }
+            break;
+
+            case FIELD_AFTER: {
+                if (isInteger)
+                { request.after = valueInteger; }
+            }
+            break;
+
+            case FIELD_BEFORE: {
+                if (isInteger)
+                { request.before = valueInteger; }
+            }
+            break;
+
+            case FIELD_COUNT: {
+                if (isInteger)
+                { request.count = valueInteger; }
+            }
+            break;
+
+            default:
+                break;
+            }
+        }
+        return (reader.position == encoding.length());
+    }
+}  // namespace ChatProtocol
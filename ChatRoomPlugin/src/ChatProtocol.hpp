@@ -0,0 +1,224 @@
+#ifndef CHAT_ROOM_PLUGIN_CHAT_PROTOCOL_HPP
+#define CHAT_ROOM_PLUGIN_CHAT_PROTOCOL_HPP
+
+/**
+ * @file ChatProtocol.hpp
+ *
+ * This module declares the types and functions used to encode
+ * and decode the messages exchanged with users of the chat room.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <stdint.h>
+#include <Json/Json.hpp>
+#include <string>
+
+/**
+ * Messages are JSON objects by default, sent as WebSocket text frames,
+ * with a "Type" string naming the kind of message.
+ *
+ * Users may instead negotiate the binary subprotocol named below, in
+ * which case messages are sent as WebSocket binary frames holding
+ * MessagePack maps. Their keys are the small integers given for each
+ * field name, and the message type is the integer given for each kind
+ * of message, under key 0. Keys not listed are sent as strings.
+ *
+ * Messages from users, and chats posted, which make up most of the
+ * traffic, are decoded and encoded straight between the wire and the
+ * structures below, without building a JSON value in between.
+ */
+namespace ChatProtocol
+{
+    /**
+     * This is the name of the WebSocket subprotocol which users
+     * may negotiate to exchange messages encoded in MessagePack.
+     */
+    constexpr const char* BINARY_SUBPROTOCOL = "chat.msgpack";
+
+    /**
+     * These are the kinds of messages exchanged with users,
+     * along with the integer tags which identify them on the wire.
+     */
+    enum class MessageType
+    {
+        Unknown = 0,
+        SetUserName = 1,
+        SetUserNameResult = 2,
+        GetUserNames = 3,
+        UserNames = 4,
+        PostChat = 5,
+        PostChatResult = 6,
+        JoinChatRoom = 7,
+        JoinChatRoomResponse = 8,
+        GetChatLog = 9,
+        ChatLog = 10,
+        Leave = 11,
+        UserNameModified = 12,
+    };
+
+    /**
+     * This holds the fields of a message received from a user
+     * which the chat room acts on.
+     */
+    struct Request
+    {
+        /**
+         * This is the kind of message.
+         */
+        MessageType type = MessageType::Unknown;
+
+        /**
+         * This indicates whether or not the message has a "UserName".
+         */
+        bool hasUserName = false;
+
+        /**
+         * This is the "UserName" of the message.
+         */
+        std::string userName;
+
+        /**
+         * This is the "Password" of the message.
+         */
+        std::string password;
+
+        /**
+         * This indicates whether or not the message has a "Chat".
+         */
+        bool hasChat = false;
+
+        /**
+         * This is the "Chat" of the message.
+         */
+        std::string chat;
+
+        /**
+         * This is the "Time" of the message.
+         */
+        std::string time;
+
+        /**
+         * This is the "After" of the message, or -1 if it has none.
+         */
+        intmax_t after = -1;
+
+        /**
+         * This is the "Before" of the message, or -1 if it has none.
+         */
+        intmax_t before = -1;
+
+        /**
+         * This is the "Count" of the message, or 0 if it has none.
+         */
+        intmax_t count = 0;
+    };
+
+    /**
+     * This holds the fields of the "PostChatResult" message
+     * telling users about a chat posted to the chat room.
+     */
+    struct ChatPosted
+    {
+        /**
+         * This is the sequence number of the chat.
+         */
+        uint64_t seq = 0;
+
+        /**
+         * This is the user name of the user who posted the chat.
+         */
+        std::string sender;
+
+        /**
+         * This is the chat itself.
+         */
+        std::string chat;
+
+        /**
+         * This is the time given by the user who posted the chat.
+         */
+        std::string time;
+    };
+
+    /**
+     * This returns the kind of message named by the given "Type"
+     * of a message encoded in JSON.
+     *
+     * @param[in] name
+     *      This is the name of the kind of message.
+     *
+     * @return
+     *      The kind of message is returned, or MessageType::Unknown
+     *      if the name isn't recognized.
+     */
+    MessageType GetMessageType(const std::string& name);
+
+    /**
+     * This encodes the given message in MessagePack.
+     *
+     * @param[in] message
+     *      This is the message to encode, as it would be encoded
+     *      in JSON, including its "Type".
+     *
+     * @return
+     *      The encoded message is returned.
+     */
+    std::string EncodeBinary(const Json::Value& message);
+
+    /**
+     * This encodes the given "PostChatResult" message in JSON.
+     *
+     * @param[in] chatPosted
+     *      This is the message to encode.
+     *
+     * @return
+     *      The encoded message is returned.
+     */
+    std::string EncodeText(const ChatPosted& chatPosted);
+
+    /**
+     * This encodes the given "PostChatResult" message in MessagePack.
+     *
+     * @param[in] chatPosted
+     *      This is the message to encode.
+     *
+     * @return
+     *      The encoded message is returned.
+     */
+    std::string EncodeBinary(const ChatPosted& chatPosted);
+
+    /**
+     * This decodes the given message from a user, encoded in JSON.
+     *
+     * @param[in] encoding
+     *      This is the encoded message.
+     *
+     * @param[out] request
+     *      This is where to store the fields of the message.
+     *
+     * @return
+     *      An indication of whether or not the message
+     *      could be decoded is returned.
+     */
+    bool DecodeText(const std::string& encoding, Request& request);
+
+    /**
+     * This decodes the given message from a user, encoded in MessagePack.
+     * Strings in the message must be valid UTF-8, since they may be
+     * passed on to other users in JSON, in WebSocket text frames.
+     *
+     * @param[in] encoding
+     *      This is the encoded message.
+     *
+     * @param[out] request
+     *      This is where to store the fields of the message.
+     *
+     * @return
+     *      An indication of whether or not the message
+     *      could be decoded is returned.
+     */
+    bool DecodeBinary(const std::string& encoding, Request& request);
+}  // namespace ChatProtocol
+
+#endif /* CHAT_ROOM_PLUGIN_CHAT_PROTOCOL_HPP */
@@ -8,16 +8,22 @@
  */
 
 #include <inttypes.h>
+#include <stdlib.h>
 #include <Http/IServer.hpp>
 #include <Json/Json.hpp>
 #include <StringUtils/StringUtils.hpp>
 #include <SystemUtils/File.hpp>
 #include <WebServer/PluginEntryPoint.hpp>
 #include <WebSocket/WebSocket.hpp>
+#include <algorithm>
 #include <functional>
 #include <condition_variable>
+#include <deque>
 #include <thread>
 #include <mutex>
+#include "ChatJournal.hpp"
+#include "ChatProtocol.hpp"
+#include "OutboundQueue.hpp"
 
 #ifdef _WIN32
 #    define API __declspec(dllexport)
@@ -28,10 +34,220 @@
 namespace
 {
     /**
-     * This is the number of milliseconds to wait between rounds of polling
-     * in the worker thread of the chat room.
+     * This is the default maximum number of messages retained
+     * in the history of the chat room.
      */
-    constexpr unsigned int WORKER_POLLING_PERIOD_MILLISECONDS = 50;
+    constexpr size_t DEFAULT_HISTORY_COUNT = 1000;
+
+    /**
+     * This is the default maximum number of bytes accounted to the
+     * messages retained in the history of the chat room.
+     */
+    constexpr size_t DEFAULT_HISTORY_BYTES = 1024 * 1024;
+
+    /**
+     * This is the maximum number of messages returned
+     * for each page of older history requested.
+     */
+    constexpr size_t MAX_HISTORY_PAGE = 100;
+
+    /**
+     * This is the default number of most recent messages
+     * sent to users joining the chat room.
+     */
+    constexpr size_t DEFAULT_JOIN_HISTORY_COUNT = 50;
+
+    /**
+     * This is the default maximum number of messages
+     * waiting to be sent to each user.
+     */
+    constexpr size_t DEFAULT_OUTBOUND_QUEUE_LIMIT = 256;
+
+    /**
+     * This is the default maximum number of bytes handed to the WebSocket
+     * of each user which the user hasn't acknowledged receiving,
+     * by answering a ping sent after them.
+     */
+    constexpr size_t DEFAULT_OUTBOUND_WINDOW_BYTES = 1 << 16;
+
+    /**
+     * This is the WebSocket status code given when disconnecting a user
+     * who doesn't take messages as fast as they're sent to it.
+     */
+    constexpr unsigned int SLOW_CONSUMER_CLOSE_CODE = 1008;
+
+    /**
+     * This is the default maximum number of chat rooms.
+     */
+    constexpr size_t DEFAULT_ROOM_LIMIT = 1024;
+
+    /**
+     * This is the default size, in bytes, past which a new segment
+     * of the log of a chat room is started.
+     */
+    constexpr size_t DEFAULT_HISTORY_SEGMENT_BYTES = 4 * 1024 * 1024;
+
+    /**
+     * This is the prefix of the name of the directory holding
+     * the log of each chat room, followed by the chat room name
+     * in hexadecimal.
+     */
+    const std::string ROOM_DIRECTORY_PREFIX = "room-";
+
+    /**
+     * This holds the configuration items applied to every chat room.
+     */
+    struct RoomSettings
+    {
+        /**
+         * This is the maximum number of messages retained
+         * in the history of each chat room.
+         */
+        size_t historyCount = DEFAULT_HISTORY_COUNT;
+
+        /**
+         * This is the maximum number of bytes accounted to the messages
+         * retained in the history of each chat room.
+         */
+        size_t historyBytes = DEFAULT_HISTORY_BYTES;
+
+        /**
+         * This is the number of most recent messages sent
+         * to users joining a chat room.
+         */
+        size_t joinHistoryCount = DEFAULT_JOIN_HISTORY_COUNT;
+
+        /**
+         * This is the maximum number of messages waiting
+         * to be sent to each user.
+         */
+        size_t outboundQueueLimit = DEFAULT_OUTBOUND_QUEUE_LIMIT;
+
+        /**
+         * This is the maximum number of bytes handed to the WebSocket
+         * of each user which the user hasn't acknowledged receiving yet,
+         * or zero if there's no limit.
+         */
+        size_t outboundWindowBytes = DEFAULT_OUTBOUND_WINDOW_BYTES;
+
+        /**
+         * This is how to deal with users who don't take messages
+         * as fast as they're sent to them.
+         */
+        OutboundQueue::SlowConsumerPolicy slowConsumerPolicy =
+            OutboundQueue::SlowConsumerPolicy::DropOldest;
+
+        /**
+         * This is the path of the directory holding the logs
+         * of the chat rooms, or an empty string if the history
+         * of the chat rooms is only kept in memory.
+         */
+        std::string historyPath;
+
+        /**
+         * This is the size, in bytes, past which a new segment
+         * of the log of a chat room is started.
+         */
+        size_t historySegmentBytes = DEFAULT_HISTORY_SEGMENT_BYTES;
+
+        /**
+         * This is the function to call to deliver a diagnostic message.
+         */
+        SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate diagnosticsMessageDelegate;
+    };
+
+    /**
+     * This returns the name of the directory holding
+     * the log of the chat room with the given name.
+     *
+     * @param[in] name
+     *      This is the name of the chat room.
+     *
+     * @return
+     *      The name of the directory holding the log
+     *      of the chat room is returned.
+     */
+    std::string GetRoomDirectoryName(const std::string& name) {
+        std::string directoryName = ROOM_DIRECTORY_PREFIX;
+        for (const auto c : name)
+        { directoryName += StringUtils::sprintf("%02x", (uint8_t)c); }
+        return directoryName;
+    }
+
+    /**
+     * This gets the name of the chat room whose log
+     * is held in the directory with the given name.
+     *
+     * @param[in] directoryName
+     *      This is the name of the directory.
+     *
+     * @param[out] name
+     *      This is where to store the name of the chat room.
+     *
+     * @return
+     *      An indication of whether or not the directory
+     *      holds the log of a chat room is returned.
+     */
+    bool GetRoomName(const std::string& directoryName, std::string& name) {
+        if ((directoryName.compare(0, ROOM_DIRECTORY_PREFIX.length(), ROOM_DIRECTORY_PREFIX) !=
+             0) ||
+            ((directoryName.length() - ROOM_DIRECTORY_PREFIX.length()) % 2 != 0) ||
+            (directoryName.find_first_not_of("0123456789abcdef", ROOM_DIRECTORY_PREFIX.length()) !=
+             std::string::npos))
+        { return false; }
+        name.clear();
+        for (size_t i = ROOM_DIRECTORY_PREFIX.length(); i < directoryName.length(); i += 2)
+        { name += (char)strtoul(directoryName.substr(i, 2).c_str(), NULL, 16); }
+        return true;
+    }
+
+    struct Shard;
+
+    /**
+     * This is something that happened in a chat room which the worker
+     * of the chat room needs to tell the users of the chat room about.
+     */
+    struct RoomEvent
+    {
+        /**
+         * These are the kinds of things that can happen.
+         */
+        enum class Type
+        {
+            /**
+             * The connection to a user was closed.
+             */
+            UserClosed,
+
+            /**
+             * A user changed their user name.
+             */
+            UserRenamed,
+        };
+
+        /**
+         * This is the kind of thing that happened.
+         */
+        Type type = Type::UserClosed;
+
+        /**
+         * This is the session ID of the user whose connection was closed.
+         */
+        unsigned int sessionId = 0;
+
+        /**
+         * This is the user name of the user who changed
+         * their user name, before the change.
+         */
+        std::string oldUserName;
+
+        /**
+         * This is the user name of the user who changed
+         * their user name, after the change.
+         */
+        std::string userName;
+    };
+
     /**
      * This is a registred user of the chat room
      */
@@ -55,6 +271,11 @@ namespace
          */
         std::string userName;
 
+        /**
+         * This is the session ID of the user.
+         */
+        unsigned int sessionId = 0;
+
         /**
          * This is the websocket connection to the user.
          */
@@ -65,6 +286,24 @@ namespace
          */
         bool open = true;
 
+        /**
+         * This indicates whether or not the user negotiated the binary
+         * subprotocol, so that messages are sent to it encoded
+         * in MessagePack rather than JSON.
+         */
+        bool binary = false;
+
+        /**
+         * These are the messages waiting to be sent to the user.
+         */
+        std::unique_ptr<OutboundQueue> outbox;
+
+        /**
+         * This indicates whether or not the user is in the list
+         * of users whose messages are waiting to be sent.
+         */
+        bool flushPending = false;
+
         /**
          * These are the diagnostic sender name of the user.
          */
@@ -77,22 +316,316 @@ namespace
         SystemUtils::DiagnosticsSender::UnsubscribeDelegate wsDiagnosticsUnsubscribeDelegate;
     };
 
+    /**
+     * This is a message to send to users of the chat room. It's encoded
+     * at most once in each format, and only in the formats used by the
+     * users it's sent to, with the encoding shared between them. Chats
+     * posted are encoded straight from their fields, the rest from
+     * their content as JSON.
+     */
+    struct OutgoingMessage
+    {
+        // Properties
+
+        /**
+         * This is the content of the message.
+         */
+        Json::Value content;
+
+        /**
+         * This holds the fields of the message if it's
+         * a chat posted, or nullptr otherwise.
+         */
+        std::unique_ptr<const ChatProtocol::ChatPosted> chatPosted;
+
+        /**
+         * This is the message encoded in JSON,
+         * or nullptr if it hasn't been encoded yet.
+         */
+        OutboundQueue::Message text;
+
+        /**
+         * This is the message encoded in MessagePack,
+         * or nullptr if it hasn't been encoded yet.
+         */
+        OutboundQueue::Message binary;
+
+        // Methods
+
+        /**
+         * This is the constructor of the structure.
+         *
+         * @param[in] content
+         *      This is the content of the message.
+         */
+        explicit OutgoingMessage(const Json::Value& content) : content(content) {}
+
+        /**
+         * This is the constructor of the structure
+         * used for chats posted.
+         *
+         * @param[in] chatPosted
+         *      This holds the fields of the message.
+         */
+        explicit OutgoingMessage(ChatProtocol::ChatPosted&& chatPosted) :
+            chatPosted(new ChatProtocol::ChatPosted(std::move(chatPosted))) {}
+
+        /**
+         * This method returns the message encoded in the format
+         * used by the given user, encoding it if needed.
+         *
+         * @param[in] user
+         *      This is the user to whom the message is sent.
+         *
+         * @return
+         *      The encoded message is returned.
+         */
+        const OutboundQueue::Message& GetEncoding(const User& user) {
+            if (user.binary)
+            {
+                if (binary == nullptr)
+                {
+                    binary = std::make_shared<const std::string>(
+                        (chatPosted == nullptr) ? ChatProtocol::EncodeBinary(content)
+                                                : ChatProtocol::EncodeBinary(*chatPosted));
+                }
+                return binary;
+            }
+            if (text == nullptr)
+            {
+                text = std::make_shared<const std::string>(
+                    (chatPosted == nullptr) ? content.ToEncoding()
+                                            : ChatProtocol::EncodeText(*chatPosted));
+            }
+            return text;
+        }
+    };
+
+    /**
+     * This is one message posted to the chat room.
+     */
     struct ChatMessage
     {
+        /**
+         * This is the sequence number assigned to the message by the
+         * chat room. Sequence numbers increase by one for every message.
+         */
+        uint64_t seq = 0;
+
+        /**
+         * This is the time given by the user who posted the message.
+         */
         std::string timestamp;
+
+        /**
+         * This is the user name of the user who posted the message,
+         * at the time the message was posted.
+         */
         std::string backupSendername;
+
+        /**
+         * This is the user who posted the message.
+         */
         std::weak_ptr<User> sender;
+
+        /**
+         * This is the content of the message.
+         */
         std::string message;
+    };
+
+    /**
+     * This holds the most recent messages posted to the chat room,
+     * in a ring buffer bounded both in number of messages and in bytes.
+     * Since sequence numbers are contiguous, any retained message
+     * can be found directly from its sequence number.
+     */
+    struct ChatHistory
+    {
+        // Properties
+
+        /**
+         * This is where messages are stored. Its size is the
+         * maximum number of messages retained.
+         */
+        std::vector<ChatMessage> messages = std::vector<ChatMessage>(DEFAULT_HISTORY_COUNT);
+
+        /**
+         * This is the index in the ring buffer of the oldest message retained.
+         */
+        size_t first = 0;
+
+        /**
+         * This is the number of messages retained.
+         */
+        size_t count = 0;
+
+        /**
+         * This is the number of bytes accounted to the messages retained.
+         */
+        size_t bytes = 0;
+
+        /**
+         * This is the maximum number of bytes accounted to the
+         * messages retained.
+         */
+        size_t maxBytes = DEFAULT_HISTORY_BYTES;
+
+        /**
+         * This is the sequence number to assign to the next message.
+         */
+        uint64_t nextSeq = 1;
+
+        // Methods
+
+        /**
+         * This method returns the number of bytes to account for the given message.
+         *
+         * @param[in] message
+         *      This is the message to account for.
+         *
+         * @return
+         *      The number of bytes to account for the message is returned.
+         */
+        static size_t GetMessageSize(const ChatMessage& message) {
+            return (sizeof(ChatMessage) + message.timestamp.length() +
+                    message.backupSendername.length() + message.message.length());
+        }
+
+        /**
+         * This method changes how much history is retained,
+         * keeping the most recent messages.
+         *
+         * @param[in] maxCount
+         *      This is the maximum number of messages to retain.
+         *
+         * @param[in] newMaxBytes
+         *      This is the maximum number of bytes to account to the
+         *      messages retained.
+         */
+        void Configure(size_t maxCount, size_t newMaxBytes) {
+            std::vector<ChatMessage> newMessages(std::max(maxCount, (size_t)1));
+            const auto oldCount = count;
+            const auto oldFirst = first;
+            auto oldMessages = std::move(messages);
+            messages = std::move(newMessages);
+            maxBytes = newMaxBytes;
+            first = 0;
+            count = 0;
+            bytes = 0;
+            for (size_t i = 0; i < oldCount; ++i)
+            { Retain(std::move(oldMessages[(oldFirst + i) % oldMessages.size()])); }
+        }
+
+        /**
+         * This method adds the given message to the history, assigning it
+         * the next sequence number, and dropping the oldest messages
+         * as needed to stay within the retention limits. A message too
+         * large to ever be retained is turned down, leaving the history
+         * as it is.
+         *
+         * @param[in] message
+         *      This is the message to add.
+         *
+         * @return
+         *      The sequence number assigned to the message is returned,
+         *      or zero if the message was turned down.
+         */
+        uint64_t Append(ChatMessage&& message) {
+            if (GetMessageSize(message) > maxBytes)
+            { return 0; }
+            message.seq = nextSeq++;
+            const auto seq = message.seq;
+            Retain(std::move(message));
+            return seq;
+        }
+
+        /**
+         * This method stores the given message, which already has its
+         * sequence number, after the most recent one, dropping the oldest
+         * messages as needed to stay within the retention limits.
+         * A message too large to be retained still drops all older ones,
+         * since retained sequence numbers must stay contiguous.
+         *
+         * @param[in] message
+         *      This is the message to store.
+         */
+        void Retain(ChatMessage&& message) {
+            const auto size = GetMessageSize(message);
+            while ((count > 0) && ((count == messages.size()) || (bytes + size > maxBytes)))
+            {
+                bytes -= GetMessageSize(messages[first]);
+                messages[first] = ChatMessage();
+                first = (first + 1) % messages.size();
+                --count;
+            }
+            if (size > maxBytes)
+            { return; }
+            bytes += size;
+            messages[(first + count) % messages.size()] = std::move(message);
+            ++count;
+        }
+
+        /**
+         * This method returns the sequence number of the oldest
+         * message retained.
+         *
+         * @return
+         *      The sequence number of the oldest message retained is
+         *      returned, or the sequence number of the next message if
+         *      no message is retained.
+         */
+        uint64_t GetFirstSeq() const { return nextSeq - count; }
+
+        /**
+         * This method tells whether or not no message was ever
+         * stored in the history.
+         *
+         * @return
+         *      An indication of whether or not no message was ever
+         *      stored in the history is returned.
+         */
+        bool IsUnused() const { return nextSeq == 1; }
 
-        bool operator<(const ChatMessage& other) const {
-            // Comparer les timestamps en tant que chaînes de caractères
-            if (timestamp != other.timestamp)
-            { return timestamp < other.timestamp; }
-            // Comparer les messages si les timestamps sont identiques
-            if (message != other.message)
-            { return message < other.message; }
-            // Comparer les adresses des pointeurs faibles si tout le reste est identique
-            return sender.owner_before(other.sender);
+        /**
+         * This method stores a message read back from the log of the
+         * chat room, which already has its sequence number. Messages
+         * already held are skipped, and if messages are missing in
+         * between, the older messages are let go, so that sequence
+         * numbers stay contiguous.
+         *
+         * @param[in] message
+         *      This is the message to store.
+         */
+        void Restore(ChatMessage&& message) {
+            if (message.seq < nextSeq)
+            { return; }
+            if (message.seq != nextSeq)
+            {
+                for (; count > 0; --count)
+                {
+                    messages[first] = ChatMessage();
+                    first = (first + 1) % messages.size();
+                }
+                bytes = 0;
+                nextSeq = message.seq;
+            }
+            ++nextSeq;
+            Retain(std::move(message));
+        }
+
+        /**
+         * This method returns the message with the given sequence number,
+         * which must be retained.
+         *
+         * @param[in] seq
+         *      This is the sequence number of the message to return.
+         *
+         * @return
+         *      The message with the given sequence number is returned.
+         */
+        const ChatMessage& Get(uint64_t seq) const {
+            return messages[(first + (size_t)(seq - GetFirstSeq())) % messages.size()];
         }
     };
 
@@ -107,81 +640,928 @@ namespace
         std::mutex mutex;
 
         /**
-         * This is used to notify the worker for any change that
-         * should cause it to wake up.
+         * This is the shard whose worker performs housekeeping
+         * in the background for the chat room.
          */
-        std::condition_variable workerWakeCondition;
+        Shard* shard = nullptr;
 
         /**
-         * This is used to perform housekeeping in the backgroud.
+         * This indicates whether or not the chat room is waiting to be
+         * served by the worker of its shard. It's protected by the mutex
+         * of the shard rather than that of the chat room.
          */
-        std::thread workerThread;
+        bool workPending = false;
 
         /**
-         * This indicates whether or not the worker thread should
-         * stop working.
+         * This is the number of users on their way into the chat room,
+         * which therefore must not be reclaimed. It's protected by the
+         * mutex of the chat rooms rather than that of the chat room.
          */
-        bool stopWorker = false;
+        size_t usersJoining = 0;
 
         /**
-         * This indicates whether an user have to close the ws.
+         * This is the number of users who had tried to join any chat room
+         * when a user last tried to join this one, so that the least
+         * recently used chat room is reclaimed first. It's protected by the
+         * mutex of the chat rooms rather than that of the chat room.
          */
-        bool usersHaveClosed = false;
+        uint64_t lastUse = 0;
+
+        /**
+         * These are the things that happened in the chat room which
+         * the worker has yet to tell the users about, oldest first.
+         */
+        std::deque<RoomEvent> events;
+
+        /**
+         * This is the number of most recent messages sent
+         * to users joining the chat room.
+         */
+        size_t joinHistoryCount = DEFAULT_JOIN_HISTORY_COUNT;
+
+        /**
+         * This is the maximum number of messages waiting
+         * to be sent to each user.
+         */
+        size_t outboundQueueLimit = DEFAULT_OUTBOUND_QUEUE_LIMIT;
+
+        /**
+         * This is the maximum number of bytes handed to the WebSocket
+         * of each user which the user hasn't acknowledged receiving yet,
+         * or zero if there's no limit.
+         */
+        size_t outboundWindowBytes = DEFAULT_OUTBOUND_WINDOW_BYTES;
+
+        /**
+         * This is how to deal with users who don't take messages
+         * as fast as they're sent to them.
+         */
+        OutboundQueue::SlowConsumerPolicy slowConsumerPolicy =
+            OutboundQueue::SlowConsumerPolicy::DropOldest;
+
+        /**
+         * These are the users with messages waiting to be sent,
+         * once the chat room is unlocked.
+         */
+        std::vector<std::shared_ptr<User>> usersToFlush;
+
+        /**
+         * These are the users currently connected to the chat room,
+         * keyed by session Id.
+         */
+        std::map<unsigned int, std::shared_ptr<User>> users;
+
+        /**
+         * These are the registered users of the chat room, keyed by
+         * userName
+         */
+        std::map<std::string, Account> accounts;
+
+        /**
+         * These are the user names of the users currently in the chat
+         * room, along with how many users have each of them, since the
+         * same user may join from more than one connection.
+         */
+        std::map<std::string, size_t> userNameCounts;
+
+        /**
+         * This is the "UserNames" message listing the users currently in
+         * the chat room, built once the list last changed, or nullptr
+         * if the list changed since.
+         */
+        std::unique_ptr<OutgoingMessage> roster;
+
+        /**
+         * This indicates whether or not the list of users currently in
+         * the chat room changed since it was last sent to them.
+         */
+        bool rosterChanged = false;
+
+        /**
+         * This lists the users currently in the chat room, as last
+         * encoded into the "UserNames" message.
+         */
+        Json::Value rosterUserNames;
+
+        /**
+         * These are the most recent messages posted to the chat room.
+         */
+        ChatHistory chatLog;
+
+        /**
+         * This is the name of the chat room.
+         */
+        std::string name;
+
+        /**
+         * This is the log on disk of the messages posted to the chat
+         * room, if the history of the chat room isn't only kept in memory.
+         */
+        std::unique_ptr<ChatJournal> journal;
+        /**
+         * This is the next session id that my be assigned to a new
+         * user.
+         */
+        unsigned int nextSessionId = 1;
+
+        /**
+         * This is the delegate obtained when subscribing
+         * to receive diagnostic messages from the unit under test.
+         * It's called to terminate the subscription.
+         */
+        SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate diagnosticsMessageDelegate;
+
+        // Methods
+
+        /**
+         * This method applies the given configuration items
+         * to the chat room.
+         *
+         * @param[in] settings
+         *      These are the configuration items to apply.
+         */
+        void Configure(const RoomSettings& settings) {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            chatLog.Configure(settings.historyCount, settings.historyBytes);
+            joinHistoryCount = settings.joinHistoryCount;
+            outboundQueueLimit = settings.outboundQueueLimit;
+            outboundWindowBytes = settings.outboundWindowBytes;
+            slowConsumerPolicy = settings.slowConsumerPolicy;
+            diagnosticsMessageDelegate = settings.diagnosticsMessageDelegate;
+            if ((journal != nullptr) || settings.historyPath.empty())
+            { return; }
+            journal.reset(new ChatJournal(settings.historyPath + "/" + GetRoomDirectoryName(name),
+                                          settings.historySegmentBytes));
+            const auto roomDiagnosticsMessageDelegate = diagnosticsMessageDelegate;
+            const auto diagnosticSenderName = StringUtils::sprintf(" Room '%s'", name.c_str());
+            (void)journal->SubscribeToDiagnostics(
+                [roomDiagnosticsMessageDelegate, diagnosticSenderName](
+                    std::string senderName, size_t level, std::string message)
+                {
+                    if (roomDiagnosticsMessageDelegate != nullptr)
+                    { roomDiagnosticsMessageDelegate(diagnosticSenderName, level, message); }
+                });
+            const auto replayed = journal->Open(
+                [this](ChatJournal::Record&& record)
+                {
+                    ChatMessage message;
+                    message.seq = record.seq;
+                    message.timestamp = std::move(record.timestamp);
+                    message.backupSendername = std::move(record.sender);
+                    message.message = std::move(record.message);
+                    chatLog.Restore(std::move(message));
+                });
+            if (!replayed)
+            {
+                journal = nullptr;
+                diagnosticsMessageDelegate(
+                    "", SystemUtils::DiagnosticsSender::Levels::ERROR,
+                    StringUtils::sprintf("unable to open the history of chat room '%s'",
+                                         name.c_str()));
+            }
+        }
+
+        /**
+         * This is called when the chat room is disconnected from the web
+         * server, to let go of its users and accounts. The history
+         * of the chat room is kept.
+         */
+        void Reset() {
+            std::map<unsigned int, std::shared_ptr<User>> oldUsers;
+            std::unique_ptr<ChatJournal> oldJournal;
+            {
+                std::lock_guard<decltype(mutex)> lock(mutex);
+                oldUsers.swap(users);
+                accounts.clear();
+                events.clear();
+                usersToFlush.clear();
+                diagnosticsMessageDelegate = nullptr;
+                nextSessionId = 1;
+                oldJournal = std::move(journal);
+                userNameCounts.clear();
+                roster = nullptr;
+                rosterChanged = false;
+            }
+        }
+
+        /**
+         * This method tells whether or not the chat room has no users,
+         * and its shard is done with it. Such a chat room may be
+         * reclaimed, its history being read back from its log on disk,
+         * if any, should users join it again.
+         *
+         * @return
+         *      An indication of whether or not the chat room
+         *      is idle is returned.
+         */
+        bool IsIdle();
+
+        /**
+         * This method tells whether or not the chat room holds nothing
+         * worth keeping: no accounts, and no history.
+         *
+         * @return
+         *      An indication of whether or not the chat room holds
+         *      nothing worth keeping is returned.
+         */
+        bool IsUnused() {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            return (accounts.empty() && chatLog.IsUnused());
+        }
+
+        /**
+         * This method closes the log on disk of the chat room, if any,
+         * and deletes it, so that the chat room isn't made again from it.
+         */
+        void DestroyJournal() {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            if (journal == nullptr)
+            { return; }
+            journal->Destroy();
+            journal = nullptr;
+        }
+
+        /**
+         * This method asks the worker of the shard of the chat room
+         * to serve the chat room.
+         */
+        void WakeWorker();
+
+        /**
+         * This method queues the given event for the worker
+         * to tell the users of the chat room about.
+         *
+         * @param[in] event
+         *      This is the event to queue.
+         */
+        void PostEvent(RoomEvent&& event) {
+            events.push_back(std::move(event));
+            WakeWorker();
+        }
+
+        /**
+         * This method handles the "GetUserNames" message from users
+         * in the chat room.
+         *
+         * @param[in] userEntry
+         *      This is the entry of the user who sent the message.
+         */
+        void GetUsersName(std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
+            Send(userEntry->second, GetRoster().GetEncoding(*userEntry->second));
+        }
+
+        /**
+         * This method returns the "UserNames" message listing the users
+         * currently in the chat room, building it only if the list
+         * changed since it was last built.
+         *
+         * @return
+         *      The message is returned.
+         */
+        OutgoingMessage& GetRoster() {
+            if (roster == nullptr)
+            {
+                rosterUserNames = Json::Value(Json::Value::Type::Array);
+                for (const auto& userNameCount : userNameCounts)
+                { rosterUserNames.Add(userNameCount.first); }
+                Json::Value response(Json::Value::Type::Object);
+                response.Set("Type", "UserNames");
+                response.Set("UserNames", rosterUserNames);
+                roster.reset(new OutgoingMessage(response));
+            }
+            return *roster;
+        }
+
+        /**
+         * This method counts one more user with the given user name
+         * in the chat room.
+         *
+         * @param[in] userName
+         *      This is the user name to count.
+         */
+        void AddUserName(const std::string& userName) {
+            if (userName.empty())
+            { return; }
+            if (userNameCounts[userName]++ == 0)
+            {
+                roster = nullptr;
+                rosterChanged = true;
+            }
+        }
+
+        /**
+         * This method counts one less user with the given user name
+         * in the chat room.
+         *
+         * @param[in] userName
+         *      This is the user name to count.
+         *
+         * @return
+         *      An indication of whether or not the last user with
+         *      the given user name left the chat room is returned.
+         */
+        bool RemoveUserName(const std::string& userName) {
+            const auto userNameCount = userNameCounts.find(userName);
+            if (userNameCount == userNameCounts.end())
+            { return false; }
+            if (--userNameCount->second > 0)
+            { return false; }
+            (void)userNameCounts.erase(userNameCount);
+            roster = nullptr;
+            rosterChanged = true;
+            return true;
+        }
+
+        /**
+         * This method queues the given message to be sent to the given user
+         * once the chat room is unlocked. If the user doesn't take messages
+         * fast enough, and the policy is to disconnect such users,
+         * the user is taken out of the chat room.
+         *
+         * @param[in] user
+         *      This is the user to whom to send the message.
+         *
+         * @param[in] message
+         *      This is the message to send.
+         */
+        void Send(const std::shared_ptr<User>& user, const OutboundQueue::Message& message) {
+            if (!user->outbox->Push(message) && user->open)
+            {
+                user->open = false;
+                RoomEvent event;
+                event.type = RoomEvent::Type::UserClosed;
+                event.sessionId = user->sessionId;
+                PostEvent(std::move(event));
+                diagnosticsMessageDelegate(user->diagnosticSenderName,
+                                           SystemUtils::DiagnosticsSender::Levels::WARNING,
+                                           "Disconnecting user too slow to take messages");
+            }
+            if (!user->flushPending)
+            {
+                user->flushPending = true;
+                usersToFlush.push_back(user);
+            }
+        }
+
+        /**
+         * This method queues the given message to be sent to the given user,
+         * encoded in the format the user negotiated, once the chat room
+         * is unlocked.
+         *
+         * @param[in] user
+         *      This is the user to whom to send the message.
+         *
+         * @param[in] content
+         *      This is the content of the message to send.
+         */
+        void Send(const std::shared_ptr<User>& user, const Json::Value& content) {
+            OutgoingMessage message(content);
+            Send(user, message.GetEncoding(*user));
+        }
+
+        /**
+         * This method queues the given message to be sent to all the users
+         * in the chat room once it is unlocked. The message is encoded once
+         * for each format in use, and shared between all the users of that
+         * format rather than copied.
+         *
+         * @param[in] content
+         *      This is the content of the message to send.
+         */
+        void Broadcast(const Json::Value& content) {
+            OutgoingMessage message(content);
+            Broadcast(message);
+        }
+
+        /**
+         * This method queues the given message to be sent to all the users
+         * in the chat room once it is unlocked.
+         *
+         * @param[in, out] message
+         *      This is the message to send.
+         */
+        void Broadcast(OutgoingMessage& message) {
+            for (const auto& user : users)
+            {
+                if (user.second->open)
+                { Send(user.second, message.GetEncoding(*user.second)); }
+            }
+        }
+
+        /**
+         * This method sends the messages queued while the chat room was
+         * locked. The chat room is unlocked while they are sent,
+         * so that users slow to take them don't hold it up.
+         *
+         * @param[in, out] lock
+         *      This is the lock held on the chat room.
+         */
+        void FlushOutboxes(std::unique_lock<std::mutex>& lock) {
+            if (usersToFlush.empty())
+            { return; }
+            std::vector<std::shared_ptr<User>> usersWithMessages;
+            usersWithMessages.swap(usersToFlush);
+            for (const auto& user : usersWithMessages)
+            { user->flushPending = false; }
+            lock.unlock();
+            for (const auto& user : usersWithMessages)
+            { user->outbox->Flush(); }
+            lock.lock();
+        }
+
+        /**
+         * This is called by the worker of the shard of the chat room
+         * to perform housekeeping in the background for the chat room.
+         */
+        void Serve() {
+            std::unique_lock<decltype(mutex)> lock(mutex);
+            std::vector<std::shared_ptr<User>> closedUsers;
+            while (!events.empty())
+            {
+                const auto event = std::move(events.front());
+                events.pop_front();
+                switch (event.type)
+                {
+                case RoomEvent::Type::UserClosed: {
+                    const auto userEntry = users.find(event.sessionId);
+                    if (userEntry == users.end())
+                    { break; }
+                    const auto userName = userEntry->second->userName;
+                    closedUsers.push_back(std::move(userEntry->second));
+                    (void)users.erase(userEntry);
+                    if (RemoveUserName(userName))
+                    {
+                        Json::Value response(Json::Value::Type::Object);
+                        response.Set("Type", "Leave");
+                        response.Set("UserName", userName);
+                        Broadcast(response);
+                    }
+                }
+                break;
+
+                case RoomEvent::Type::UserRenamed: {
+                    Json::Value response(Json::Value::Type::Object);
+                    response.Set("Type", "UserNameModified");
+                    response.Set("OldUserName", event.oldUserName);
+                    response.Set("UserName", event.userName);
+                    Broadcast(response);
+                }
+                break;
+
+                default:
+                    break;
+                }
+            }
+            if (rosterChanged)
+            {
+                rosterChanged = false;
+                Broadcast(GetRoster());
+            }
+            FlushOutboxes(lock);
+            lock.unlock();
+            closedUsers.clear();
+        }
+
+        /**
+         * This method handles the "SetUserName" message from users
+         * in the chat room.
+         *
+         * @param[in] request
+         *      This holds the fields of the user message.
+         * @param[in] userEntry
+         *      This is the entry of the user who sent the message.
+         */
+        void SetUserName(const ChatProtocol::Request& request,
+                         std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
+            const auto& userName = request.userName;
+            const auto& password = request.password;
+            Json::Value response(Json::Value::Type::Object);
+            response.Set("Type", "SetUserNameResult");
+            auto accountEntry = accounts.find(userName);
+            if (!userName.empty() &&
+                (accountEntry == accounts.end() || accountEntry->second.password == password))
+            {
+                const auto oldUserName = userEntry->second->userName;
+                userEntry->second->userName = userName;
+                AddUserName(userName);
+                (void)RemoveUserName(oldUserName);
+                auto& account = accounts[userName];
+                account.password = password;
+                response.Set("Success", true);
+                diagnosticsMessageDelegate(
+                    userEntry->second->diagnosticSenderName, 1,
+                    StringUtils::sprintf("User name changed from '%s' to '%s'", oldUserName.c_str(),
+                                         userName.c_str()));
+                RoomEvent event;
+                event.type = RoomEvent::Type::UserRenamed;
+                event.oldUserName = oldUserName;
+                event.userName = userName;
+                PostEvent(std::move(event));
+            } else
+            { response.Set("Success", false); }
+            Send(userEntry->second, response);
+        }
+        /**
+         * This method handles the "JoinChatRoom" message from users.
+         * Users joining for the first time get the most recent messages,
+         * while users coming back give the sequence number of the last
+         * message they saw as "After", and only get the messages
+         * posted since. Either way, the response gives the sequence number
+         * of the last message posted as "Cursor".
+         *
+         * @param[in] request
+         *      This holds the fields of the user message.
+         *
+         * @param[in] userEntry
+         *      This is the entry of the user who sent the message.
+         */
+        void JoinChatRoom(const ChatProtocol::Request& request,
+                          std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
+            const auto resuming = (request.after >= 0);
+            auto firstSeq = chatLog.GetFirstSeq();
+            if (resuming)
+            {
+                firstSeq = std::max(firstSeq, (uint64_t)request.after + 1);
+            } else if (chatLog.nextSeq - firstSeq > joinHistoryCount)
+            { firstSeq = chatLog.nextSeq - joinHistoryCount; }
+            firstSeq = std::min(firstSeq, chatLog.nextSeq);
+            Json::Value response(Json::Value::Type::Object);
+            response.Set("Type", "JoinChatRoomResponse");
+            response.Set("Success", true);
+            response.Set("ChatLog", EncodeChatLog(firstSeq, chatLog.nextSeq));
+            response.Set("Cursor", (int)(chatLog.nextSeq - 1));
+            response.Set("More", !resuming && (firstSeq > chatLog.GetFirstSeq()));
+            (void)GetRoster();
+            response.Set("UserNames", rosterUserNames);
+            Send(userEntry->second, response);
+        }
+
+        /**
+         * This method encodes the messages of the chat log with sequence
+         * numbers in the given range.
+         *
+         * @param[in] firstSeq
+         *      This is the sequence number of the first message to encode.
+         *
+         * @param[in] endSeq
+         *      This is the sequence number following the last message to encode.
+         *
+         * @return
+         *      The encoded messages are returned.
+         */
+        Json::Value EncodeChatLog(uint64_t firstSeq, uint64_t endSeq) {
+            Json::Value chatLogToSend(Json::Value::Type::Array);
+            for (auto seq = firstSeq; seq < endSeq; ++seq)
+            {
+                const auto& chat = chatLog.Get(seq);
+                Json::Value chatObj(Json::Value::Type::Object);
+                chatObj.Set("Seq", (int)chat.seq);
+                chatObj.Set("Time", chat.timestamp);
+                auto sender = chat.sender.lock();
+                if (sender)
+                {
+                    chatObj.Set("Sender",
+                                sender->userName);  // Accès sécurisé au membre userName
+                } else
+                { chatObj.Set("Sender", chat.backupSendername); }
+                chatObj.Set("Chat", chat.message);
+                chatLogToSend.Add(chatObj);
+            }
+            return chatLogToSend;
+        }
+
+        /**
+         * This method handles the "GetChatLog" message from users in the
+         * chat room, returning a page of the messages posted before the
+         * given sequence number, so that older history can be loaded
+         * on demand.
+         *
+         * @param[in] request
+         *      This holds the fields of the user message.
+         *
+         * @param[in] userEntry
+         *      This is the entry of the user who sent the message.
+         */
+        void GetChatLogPage(const ChatProtocol::Request& request,
+                            std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
+            auto endSeq = chatLog.nextSeq;
+            if (request.before >= 0)
+            { endSeq = std::min(endSeq, (uint64_t)request.before); }
+            endSeq = std::max(endSeq, chatLog.GetFirstSeq());
+            auto pageSize = MAX_HISTORY_PAGE;
+            if (request.count > 0)
+            { pageSize = std::min(pageSize, (size_t)request.count); }
+            const auto firstSeq = std::max(chatLog.GetFirstSeq(),
+                                           (endSeq > pageSize) ? (endSeq - pageSize) : 0);
+            Json::Value response(Json::Value::Type::Object);
+            response.Set("Type", "ChatLog");
+            response.Set("ChatLog", EncodeChatLog(firstSeq, endSeq));
+            response.Set("More", firstSeq > chatLog.GetFirstSeq());
+            Send(userEntry->second, response);
+        }
+
+        /**
+         * This method handles the "Chat" message from
+         * users in the chat room.
+         *
+         * @param[in] request
+         *      This holds the fields of the user message.
+         * @param[in] userEntry
+         *      This is the entry of the user whos ent the message.
+         */
+        void Chat(const ChatProtocol::Request& request,
+                  std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
+            const auto& chat = request.chat;
+            const auto& timeIn = request.time;
+            if (chat.empty())
+            { return; }
+            ChatMessage msg;
+            msg.timestamp = timeIn;
+            msg.backupSendername = userEntry->second->userName;
+            msg.sender = userEntry->second;
+            msg.message = chat;
+            ChatJournal::Record record;
+            if (journal != nullptr)
+            {
+                record.timestamp = msg.timestamp;
+                record.sender = msg.backupSendername;
+                record.message = msg.message;
+            }
+            const auto seq = chatLog.Append(std::move(msg));
+            if (seq == 0)
+            {
+                Json::Value response(Json::Value::Type::Object);
+                response.Set("Type", "PostChatResult");
+                response.Set("Success", false);
+                response.Set("Chat", chat);
+                response.Set("Time", timeIn);
+                Send(userEntry->second, response);
+                return;
+            }
+            if (journal != nullptr)
+            {
+                record.seq = seq;
+                journal->Append(record);
+                journal->Trim(chatLog.GetFirstSeq());
+            }
+            ChatProtocol::ChatPosted chatPosted;
+            chatPosted.seq = seq;
+            chatPosted.sender = userEntry->second->userName;
+            chatPosted.chat = chat;
+            chatPosted.time = timeIn;
+            OutgoingMessage response(std::move(chatPosted));
+            Broadcast(response);
+            diagnosticsMessageDelegate(
+                userEntry->second->diagnosticSenderName, 1,
+                StringUtils::sprintf("User '%s' sent '%s' to the room",
+                                     userEntry->second->userName.c_str(), chat.c_str()));
+        }
+
+        /**
+         * This is called whenever a message is received from an user
+         * in the chat room.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the user who sent the message.
+         *
+         * @param[in] data
+         *      This is the content of the received message from the user.
+         *
+         * @param[in] binary
+         *      This indicates whether or not the message was received
+         *      in a binary frame, and so is encoded in MessagePack
+         *      rather than JSON.
+         */
+        void ReceiveMessage(unsigned int sessionId, const std::string& data, bool binary) {
+            std::unique_lock<decltype(mutex)> lock(mutex);
+            const auto userEntry = users.find(sessionId);
+            if (userEntry == users.end())
+            { return; }
+            ChatProtocol::Request request;
+            if (binary ? !ChatProtocol::DecodeBinary(data, request)
+                       : !ChatProtocol::DecodeText(data, request))
+            { return; }
+            switch (request.type)
+            {
+            case ChatProtocol::MessageType::SetUserName: {
+                if (request.hasUserName)
+                { SetUserName(request, userEntry); }
+            }
+            break;
+
+            case ChatProtocol::MessageType::GetUserNames: {
+                GetUsersName(userEntry);
+            }
+            break;
+
+            case ChatProtocol::MessageType::PostChat: {
+                if (request.hasChat)
+                { Chat(request, userEntry); }
+            }
+            break;
+
+            case ChatProtocol::MessageType::JoinChatRoom: {
+                JoinChatRoom(request, userEntry);
+            }
+            break;
+
+            case ChatProtocol::MessageType::GetChatLog: {
+                GetChatLogPage(request, userEntry);
+            }
+            break;
+
+            default:
+                break;
+            }
+            FlushOutboxes(lock);
+        }
+
+        /**
+         * This is called when a user answers a ping sent to it after
+         * messages, acknowledging it received them, so that messages
+         * held back for it may be sent.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the user who answered the ping.
+         *
+         * @param[in] data
+         *      This is the payload of the pong, holding the mark
+         *      the ping was sent for.
+         */
+        void ReceivePong(unsigned int sessionId, const std::string& data) {
+            std::shared_ptr<User> user;
+            {
+                std::lock_guard<decltype(mutex)> lock(mutex);
+                const auto userEntry = users.find(sessionId);
+                if (userEntry == users.end())
+                { return; }
+                user = userEntry->second;
+            }
+            const auto mark = (size_t)strtoull(data.c_str(), NULL, 10);
+            if (user->outbox->Acknowledge(mark))
+            { user->outbox->Flush(); }
+        }
+
+        /**
+         * This is called to remove user from the chat room when websocket
+         * connection is closed.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the user to remove from chat room.
+         */
+        void RemoveUser(unsigned int sessionId, unsigned int code, const std::string& reason) {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            const auto user = users.find(sessionId);
+            if (user == users.end())
+            { return; }
+            user->second->ws.Close(code, reason);
+            if (!user->second->open)
+            { return; }
+            user->second->open = false;
+            RoomEvent event;
+            event.type = RoomEvent::Type::UserClosed;
+            event.sessionId = sessionId;
+            PostEvent(std::move(event));
+        }
+
+        /**
+         * This method is used whenever a new user is tries to
+         * connect to the chat room.
+         *
+         * @param[in] request
+         *      This is the request to connect to the chat room.
+         * @param[in] connection
+         *      This is the connection on which the request was made.
+         * @param[in] trailer
+         *      This holds any characters that have already been received
+         *      by the server and come after the end of the request.
+         *      A handler that upgrades this connection might want to interpret
+         *      these characters whithin the context of the upgraded connection
+         * @return
+         *      The response to be returned to the client is returned.
+         */
+        std::shared_ptr<Http::Client::Response> AddUser(
+            std::shared_ptr<Http::IServer::Request> request,
+            std::shared_ptr<Http::Connection> connection, const std::string& trailer) {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            const auto response = std::make_shared<Http::Client::Response>();
+            const auto sessionId = nextSessionId++;
+            auto user = std::make_shared<User>();
+            const auto userRaw = user.get();
+            user->outbox.reset(new OutboundQueue(
+                outboundQueueLimit, slowConsumerPolicy,
+                [userRaw](const std::string& message)
+                {
+                    if (userRaw->binary)
+                    {
+                        userRaw->ws.SendBinary(message);
+                    } else
+                    { userRaw->ws.SendText(message); }
+                },
+                [userRaw] { userRaw->ws.Close(SLOW_CONSUMER_CLOSE_CODE, "Too slow"); }));
+
+            // Sending a message only buffers it in the WebSocket, so the user
+            // is pinged after each run of messages, and answering the ping
+            // acknowledges receiving them, as pongs come back in order.
+            if (outboundWindowBytes > 0)
+            {
+                user->outbox->SetWindow(outboundWindowBytes,
+                                        [userRaw](size_t mark)
+                                        { userRaw->ws.Ping(StringUtils::sprintf("%zu", mark)); });
+                user->ws.SetPongDelegate([this, sessionId](const std::string& data)
+                                         { ReceivePong(sessionId, data); });
+            }
+            user->sessionId = sessionId;
+            users[sessionId] = user;
+            const auto diagnosticSenderName = StringUtils::sprintf(" Session #%zu", sessionId);
+            user->diagnosticSenderName = diagnosticSenderName;
+            user->wsDiagnosticsUnsubscribeDelegate = user->ws.SubscribeToDiagnostics(
+                [this, diagnosticSenderName](std::string senderName, size_t level,
+                                             std::string message)
+                { diagnosticsMessageDelegate(diagnosticSenderName, level, message); });
+            user->ws.SetTextDelegate([this, sessionId](const std::string& data)
+                                     { ReceiveMessage(sessionId, data, false); });
+            const auto subprotocols = request->headers.GetHeaderTokens("Sec-WebSocket-Protocol");
+            user->binary = (std::find(subprotocols.begin(), subprotocols.end(),
+                                      ChatProtocol::BINARY_SUBPROTOCOL) != subprotocols.end());
+            if (user->binary)
+            {
+                user->ws.SetBinaryDelegate([this, sessionId](const std::string& data)
+                                           { ReceiveMessage(sessionId, data, true); });
+            }
+            user->ws.SetCloseDelegate(
+                [this, sessionId](unsigned int code, const std::string& reason)
+                { RemoveUser(sessionId, code, reason); });
+            if (!user->ws.OpenAsServer(connection, *request, *response, trailer))
+            {
+                (void)users.erase(sessionId);
+                response->statusCode = 200;
+                response->headers.SetHeader("Content-Type", "Text/plain");
+                response->body = "Try again, but next time use a WebSocket. thxbye!";
+            } else if (user->binary)
+            {
+                response->headers.SetHeader("Sec-WebSocket-Protocol",
+                                            ChatProtocol::BINARY_SUBPROTOCOL);
+            }
+            return response;
+        }
+    };
 
+    /**
+     * This is one of a fixed number of workers sharing out the
+     * housekeeping of the chat rooms, so that chat rooms are served
+     * in parallel without needing a thread each.
+     */
+    struct Shard
+    {
         /**
-         * This indicates whether an user join the room with an user name.
+         * This synchronizes access to the shard.
          */
-        bool userJoinRoom = false;
+        std::mutex mutex;
 
         /**
-         * This indicates whether an user change his user name.
+         * This is used to notify the worker for any change that
+         * should cause it to wake up.
          */
-        bool userNameModified = false;
+        std::condition_variable workerWakeCondition;
 
         /**
-         * These are the users currently connected to the chat room,
-         * keyed by session Id.
+         * This is used to perform housekeeping in the backgroud.
          */
-        std::map<unsigned int, std::shared_ptr<User>> users;
+        std::thread workerThread;
 
         /**
-         * These are the registered users of the chat room, keyed by
-         * userName
+         * This indicates whether or not the worker thread should
+         * stop working.
          */
-        std::map<std::string, Account> accounts;
+        bool stopWorker = false;
 
         /**
-         *
-         */
-        std::set<ChatMessage> chatLog;
-        /**
-         * This is the next session id that my be assigned to a new
-         * user.
+         * These are the chat rooms waiting to be served by the worker.
          */
-        unsigned int nextSessionId = 1;
+        std::vector<Room*> roomsToServe;
 
         /**
-         * This is the delegate obtained when subscribing
-         * to receive diagnostic messages from the unit under test.
-         * It's called to terminate the subscription.
+         * These are the chat rooms being served by the worker.
          */
-        SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate diagnosticsMessageDelegate;
+        std::vector<Room*> roomsBeingServed;
 
         // Methods
+
         /**
-         * This is called before the chat room is connected into the web server
-         * in order to prepare it for operating.
+         * This is called before the chat rooms are connected into the web
+         * server in order to prepare the shard for operating.
          */
         void Start() {
             if (workerThread.joinable())
             { return; }
             stopWorker = false;
-            workerThread = std::thread(&Room::Worker, this);
+            workerThread = std::thread(&Shard::Worker, this);
         }
 
         /**
-         * This is called when the chat room is disconnected frome the web
-         * server in order to cleanly shut it down.
+         * This is called when the chat rooms are disconnected from the web
+         * server in order to cleanly shut the shard down.
          */
         void Stop() {
             if (!workerThread.joinable())
@@ -192,285 +1572,264 @@ namespace
                 workerWakeCondition.notify_all();
             }
             workerThread.join();
+            for (const auto room : roomsToServe)
+            { room->workPending = false; }
+            roomsToServe.clear();
         }
 
         /**
-         * This method handles the "GetUserNames" message from users
-         * in the chat room.
+         * This method tells whether or not the given chat room is
+         * waiting to be served, or being served, by the worker.
          *
-         * @param[in] userEntry
-         *      This is the entry of the user who sent the message.
+         * @param[in] room
+         *      This is the chat room to check.
+         *
+         * @return
+         *      An indication of whether or not the worker still has
+         *      the chat room in hand is returned.
          */
-        void GetUsersName(std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
-            Json::Value response(Json::Value::Type::Object);
-            response.Set("Type", "UserNames");
-            std::set<std::string> userNamesSet;
-            for (const auto& user : users)
-            {
-                if (!user.second->userName.empty())
-                { userNamesSet.insert(user.second->userName); }
-            }
-            Json::Value userNames(Json::Value::Type::Array);
-            for (const auto& userName : userNamesSet)
-            {
-                { userNames.Add(userName); }
-            }
-            response.Set("UserNames", userNames);
-            userEntry->second->ws.SendText(response.ToEncoding());
+        bool IsServing(Room* room) {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            return (room->workPending ||
+                    (std::find(roomsBeingServed.begin(), roomsBeingServed.end(), room) !=
+                     roomsBeingServed.end()));
+        }
+
+        /**
+         * This method asks the worker to serve the given chat room.
+         *
+         * @param[in] room
+         *      This is the chat room to serve.
+         */
+        void Wake(Room* room) {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            if (room->workPending)
+            { return; }
+            room->workPending = true;
+            roomsToServe.push_back(room);
+            workerWakeCondition.notify_all();
         }
 
         /**
          * This is called in a separate thread to perform
-         * housekeeping in the background for the chat room.
+         * housekeeping in the background for the chat rooms
+         * of the shard.
          */
         void Worker() {
             std::unique_lock<decltype(mutex)> lock(mutex);
             while (!stopWorker)
             {
-                workerWakeCondition.wait_for(
-                    lock, std::chrono::milliseconds(WORKER_POLLING_PERIOD_MILLISECONDS),
-                    [this]
-                    { return stopWorker || usersHaveClosed || userJoinRoom || userNameModified; });
-                if (usersHaveClosed)
-                {
-                    std::vector<std::shared_ptr<User>> closedUsers;
-                    for (auto user = users.begin(); user != users.end();)
-                    {
-                        if (user->second->open)
-                        {
-                            ++user;
-                        } else
-                        {
-                            const auto userName = user->second->userName;
-                            closedUsers.push_back(std::move(user->second));
-                            user = users.erase(user);
-                            bool stillInTheRoom = false;
-                            for (const auto& userEntry : users)
-                            {
-                                if (userEntry.second->userName == userName)
-                                {
-                                    stillInTheRoom = true;
-                                    break;
-                                }
-                            }
-                            if (!stillInTheRoom)
-                            {
-                                Json::Value response(Json::Value::Type::Object);
-                                response.Set("Type", "Leave");
-                                response.Set("UserName", userName);
-                                const auto responseToEncoding = response.ToEncoding();
-                                for (auto user = users.begin(); user != users.end();)
-                                {
-                                    user->second->ws.SendText(responseToEncoding);
-                                    if (user->second->open)
-                                    { GetUsersName(user); }
-                                    ++user;
-                                }
-                            }
-                        }
-                    }
-                    usersHaveClosed = false;
-                    {
-                        lock.unlock();
-                        closedUsers.clear();
-                        lock.lock();
-                    }
-                }
-                if (userJoinRoom)
-                {
-                    for (auto user = users.begin(); user != users.end();)
-                    {
-                        GetUsersName(user);
-                        ++user;
-                    }
-                    userJoinRoom = false;
-                }
-                if (userNameModified)
-                {
-                    for (auto user = users.begin(); user != users.end();)
-                    {
-                        Json::Value response(Json::Value::Type::Object);
-                        response.Set("Type", "UserNameModified");
-                        response.Set("UserName", user->second->userName);
-                        response.Set("Success", true);
-                        GetChatLog(response, user);
-                        ++user;
-                    }
-                    userNameModified = false;
-                }
+                workerWakeCondition.wait(
+                    lock, [this] { return stopWorker || !roomsToServe.empty(); });
+                roomsBeingServed.swap(roomsToServe);
+                for (const auto room : roomsBeingServed)
+                { room->workPending = false; }
+                lock.unlock();
+                for (const auto room : roomsBeingServed)
+                { room->Serve(); }
+                lock.lock();
+                roomsBeingServed.clear();
             }
         }
+    };
+
+    bool Room::IsIdle() {
+        std::lock_guard<decltype(mutex)> lock(mutex);
+        return (users.empty() && events.empty() && !shard->IsServing(this));
+    }
+
+    void Room::WakeWorker() {
+        shard->Wake(this);
+    }
 
+    /**
+     * This holds all the chat rooms, keyed by name, along with the shards
+     * sharing out their housekeeping. Users are sent to the chat room named
+     * by the path of the request they make to join, relative to the space
+     * of the plug-in; chat rooms are made on demand.
+     */
+    struct ChatRooms
+    {
         /**
-         * This method handles the "SetUserName" message from users
-         * in the chat room.
+         * This synchronizes access to the chat rooms and shards.
+         */
+        std::mutex mutex;
+
+        /**
+         * These are the chat rooms, keyed by name. Chat rooms outlive
+         * their users, and the plug-in being unloaded and loaded again,
+         * until they're reclaimed to make way for new ones: first those
+         * holding nothing worth keeping, then the least recently used
+         * of those without users. The history of a chat room reclaimed
+         * is read back from its log on disk, if any, when it's made again.
+         */
+        std::map<std::string, std::unique_ptr<Room>> rooms;
+
+        /**
+         * These are the shards sharing out the housekeeping
+         * of the chat rooms.
+         */
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        /**
+         * These are the configuration items applied to every chat room.
+         */
+        RoomSettings settings;
+
+        /**
+         * This is the maximum number of chat rooms.
+         */
+        size_t roomLimit = DEFAULT_ROOM_LIMIT;
+
+        /**
+         * This is the number of users who tried to join any chat room.
+         */
+        uint64_t uses = 0;
+
+        // Methods
+
+        /**
+         * This method returns the shard serving the chat room
+         * with the given name.
          *
-         * @param[in] message
-         *      This is the content of the user message.
-         * @param[in] userEntry
-         *      This is the entry of the user who sent the message.
+         * @param[in] name
+         *      This is the name of the chat room.
+         *
+         * @return
+         *      The shard serving the chat room is returned.
          */
-        void SetUserName(const Json::Value& message,
-                         std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
-            const std::string userName = message["UserName"];
-            const std::string password = message["Password"];
-            Json::Value response(Json::Value::Type::Object);
-            response.Set("Type", "SetUserNameResult");
-            auto accountEntry = accounts.find(userName);
-            if (!userName.empty() &&
-                (accountEntry == accounts.end() || accountEntry->second.password == password))
-            {
-                const auto oldUserName = userEntry->second->userName;
-                userEntry->second->userName = userName;
-                auto& account = accounts[userName];
-                account.password = password;
-                response.Set("Success", true);
-                diagnosticsMessageDelegate(
-                    userEntry->second->diagnosticSenderName, 1,
-                    StringUtils::sprintf("User name changed from '%s' to '%s'", oldUserName.c_str(),
-                                         userName.c_str()));
-            } else
-            { response.Set("Success", false); }
-            userEntry->second->ws.SendText(response.ToEncoding());
-            userNameModified = true;
-            workerWakeCondition.notify_all();
+        Shard* GetShard(const std::string& name) {
+            return shards[std::hash<std::string>()(name) % shards.size()].get();
         }
+
         /**
-         * This method handles the "JoinChatRoom" message from users
+         * This method makes a new chat room with the given name,
+         * reading back its history if it's kept on disk.
+         *
+         * @param[in] name
+         *      This is the name of the chat room to make.
+         *
+         * @return
+         *      The entry of the new chat room is returned.
          */
-        void JoinChatRoom(const Json::Value& message,
-                          std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
-            const std::string Sender = message["userSender"];
-            Json::Value response(Json::Value::Type::Object);
-
-            response.Set("Type", "JoinChatRoomResponse");
-            response.Set("Success", true);
-            GetChatLog(response, userEntry);
-            userJoinRoom = true;
-            workerWakeCondition.notify_all();
+        std::map<std::string, std::unique_ptr<Room>>::iterator AddRoom(const std::string& name) {
+            const auto roomEntry = rooms.emplace(name, std::unique_ptr<Room>(new Room())).first;
+            roomEntry->second->name = name;
+            roomEntry->second->shard = GetShard(name);
+            roomEntry->second->Configure(settings);
+            return roomEntry;
         }
+
         /**
-         * This method is used to make the chat log to send to the user.
+         * This method destroys the given chat room, if it's idle and no
+         * user is on the way into it. Its log on disk is kept, unless
+         * the chat room holds nothing worth keeping, or it's asked to
+         * be kept only then.
+         *
+         * @param[in] roomEntry
+         *      This is the entry of the chat room to reclaim.
+         *
+         * @param[in] onlyIfUnused
+         *      This indicates whether or not to reclaim the chat room
+         *      only if it holds nothing worth keeping.
+         *
+         * @return
+         *      An indication of whether or not the chat room
+         *      was reclaimed is returned.
          */
-        void GetChatLog(Json::Value& response,
-                        std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
-            Json::Value chatLogToSend(Json::Value::Type::Array);
-            for (const auto& chat : chatLog)
-            {
-                Json::Value chatObj(Json::Value::Type::Object);
-                chatObj.Set("Time", chat.timestamp);
-                auto sender = chat.sender.lock();
-                if (sender)
-                {
-                    chatObj.Set("Sender",
-                                sender->userName);  // Accès sécurisé au membre userName
-                } else
-                { chatObj.Set("Sender", chat.backupSendername); }
-                chatObj.Set("Chat", chat.message);
-                chatLogToSend.Add(chatObj);
-            }
-            response.Set("ChatLog", chatLogToSend);
-            Json::Value userNames(Json::Value::Type::Array);
-            std::set<std::string> userNamesSet;
-            for (const auto& user : users)
-            {
-                if (!user.second->userName.empty())
-                { userNamesSet.insert(user.second->userName); }
-            }
-            for (const auto& userName : userNamesSet)
+        bool ReclaimRoom(std::map<std::string, std::unique_ptr<Room>>::iterator roomEntry,
+                         bool onlyIfUnused = true) {
+            const auto& room = roomEntry->second;
+            if ((room->usersJoining > 0) || !room->IsIdle())
+            { return false; }
+            if (room->IsUnused())
             {
-                { userNames.Add(userName); }
-            }
-            response.Set("UserNames", userNames);
-            userEntry->second->ws.SendText(response.ToEncoding());
+                room->DestroyJournal();
+            } else if (onlyIfUnused)
+            { return false; }
+            (void)rooms.erase(roomEntry);
+            return true;
         }
+
         /**
-         * This method handles the "Chat" message from
-         * users in the chat room.
-         *
-         * @param[in] message
-         *      This is the content of the user message.
-         * @param[in] userEntry
-         *      This is the entry of the user whos ent the message.
+         * This method destroys all the idle chat rooms holding nothing
+         * worth keeping, and if that's not enough, the least recently
+         * used idle chat room, to make way for a new one.
          */
-        void Chat(const Json::Value& message,
-                  std::map<unsigned int, std::shared_ptr<User>>::iterator userEntry) {
-            const std::string chat = message["Chat"];
-            const std::string timeIn = message["Time"];
-            if (chat.empty())
-            { return; }
-            ChatMessage msg;
-            msg.timestamp = timeIn;
-            msg.backupSendername = userEntry->second->userName;
-            msg.sender = userEntry->second;
-            msg.message = chat;
-            chatLog.insert(msg);
-            Json::Value response(Json::Value::Type::Object);
-            response.Set("Type", "PostChatResult");
-            response.Set("Sender", userEntry->second->userName);
-            response.Set("Chat", chat);
-            response.Set("Time", timeIn);
-            std::string respEncod = response.ToEncoding();
-            for (auto& user : users)
-            { user.second->ws.SendText(respEncod); }
-            diagnosticsMessageDelegate(
-                userEntry->second->diagnosticSenderName, 1,
-                StringUtils::sprintf("User '%s' sent '%s' to the room",
-                                     userEntry->second->userName.c_str(), chat.c_str()));
+        void ReclaimIdleRooms() {
+            auto leastRecentlyUsed = rooms.end();
+            for (auto roomEntry = rooms.begin(); roomEntry != rooms.end();)
+            {
+                auto nextRoomEntry = roomEntry;
+                ++nextRoomEntry;
+                if (!ReclaimRoom(roomEntry) &&
+                    ((leastRecentlyUsed == rooms.end()) ||
+                     (roomEntry->second->lastUse < leastRecentlyUsed->second->lastUse)) &&
+                    (roomEntry->second->usersJoining == 0) && roomEntry->second->IsIdle())
+                { leastRecentlyUsed = roomEntry; }
+                roomEntry = nextRoomEntry;
+            }
+            if ((rooms.size() >= roomLimit) && (leastRecentlyUsed != rooms.end()))
+            { (void)ReclaimRoom(leastRecentlyUsed, false); }
         }
 
         /**
-         * This is called whenever a text message is received from an user
-         * in the chat room.
-         *
-         * @param[in] sessionId
-         *      This is the session ID of the user who sent the message.
+         * This is called before the chat rooms are connected into the web
+         * server in order to prepare them for operating.
          *
-         * @param[in] data
-         *      This is the content of the received message from the user.
+         * @param[in] numShards
+         *      This is the number of shards sharing out the housekeeping
+         *      of the chat rooms.
          *
+         * @param[in] newSettings
+         *      These are the configuration items to apply
+         *      to every chat room.
          */
-        void ReceiveMessage(unsigned int sessionId, const std::string& data) {
+        void Start(size_t numShards, const RoomSettings& newSettings) {
             std::lock_guard<decltype(mutex)> lock(mutex);
-            const auto userEntry = users.find(sessionId);
-            if (userEntry == users.end())
-            { return; }
-            const auto message = Json::Value::FromEncoding(data);
-            if ((message["Type"] == "SetUserName") && message.Has("UserName"))
+            settings = newSettings;
+            if (shards.size() != numShards)
             {
-                SetUserName(message, userEntry);
-
-            } else if (message["Type"] == "GetUserNames")
+                shards.clear();
+                for (size_t i = 0; i < numShards; ++i)
+                { shards.emplace_back(new Shard()); }
+            }
+            for (const auto& room : rooms)
             {
-                GetUsersName(userEntry);
-            } else if (message["Type"] == "PostChat" && message.Has("Chat"))
+                room.second->shard = GetShard(room.first);
+                room.second->Configure(settings);
+            }
+            if (!settings.historyPath.empty())
             {
-                Chat(message, userEntry);
-            } else if (message["Type"] == "JoinChatRoom")
-            { JoinChatRoom(message, userEntry); }
+                std::vector<std::string> entries;
+                SystemUtils::File::ListDirectory(settings.historyPath, entries);
+                for (const auto& entry : entries)
+                {
+                    std::string name;
+                    if (GetRoomName(entry.substr(entry.find_last_of("/\\") + 1), name) &&
+                        (rooms.find(name) == rooms.end()) && (rooms.size() < roomLimit))
+                    { (void)AddRoom(name); }
+                }
+            }
+            for (const auto& shard : shards)
+            { shard->Start(); }
         }
 
         /**
-         * This is called to remove user from the chat room when websocket
-         * connection is closed.
-         *
-         * @param[in] sessionId
-         *      This is the session ID of the user to remove from chat room.
+         * This is called when the chat rooms are disconnected from the web
+         * server in order to cleanly shut them down.
          */
-        void RemoveUser(unsigned int sessionId, unsigned int code, const std::string& reason) {
+        void Stop() {
             std::lock_guard<decltype(mutex)> lock(mutex);
-            const auto user = users.find(sessionId);
-            if (user == users.end())
-            { return; }
-            user->second->ws.Close(code, reason);
-            user->second->open = false;
-            usersHaveClosed = true;
-            workerWakeCondition.notify_all();
+            for (const auto& shard : shards)
+            { shard->Stop(); }
+            for (const auto& room : rooms)
+            { room.second->Reset(); }
         }
 
         /**
-         * This method is used whenever a new user is tries to
-         * connect to the chat room.
+         * This method is used whenever a new user tries to connect to one
+         * of the chat rooms.
          *
          * @param[in] request
          *      This is the request to connect to the chat room.
@@ -479,40 +1838,52 @@ namespace
          * @param[in] trailer
          *      This holds any characters that have already been received
          *      by the server and come after the end of the request.
-         *      A handler that upgrades this connection might want to interpret
-         *      these characters whithin the context of the upgraded connection
          * @return
          *      The response to be returned to the client is returned.
          */
         std::shared_ptr<Http::Client::Response> AddUser(
             std::shared_ptr<Http::IServer::Request> request,
             std::shared_ptr<Http::Connection> connection, const std::string& trailer) {
-            std::lock_guard<decltype(mutex)> lock(mutex);
-            const auto response = std::make_shared<Http::Client::Response>();
-            const auto sessionId = nextSessionId++;
-            auto user = std::make_shared<User>();
-            users[sessionId] = user;
-            const auto diagnosticSenderName = StringUtils::sprintf(" Session #%zu", sessionId);
-            user->diagnosticSenderName = diagnosticSenderName;
-            user->wsDiagnosticsUnsubscribeDelegate = user->ws.SubscribeToDiagnostics(
-                [this, diagnosticSenderName](std::string senderName, size_t level,
-                                             std::string message)
-                { diagnosticsMessageDelegate(diagnosticSenderName, level, message); });
-            user->ws.SetTextDelegate([this, sessionId](const std::string& data)
-                                     { ReceiveMessage(sessionId, data); });
-            user->ws.SetCloseDelegate(
-                [this, sessionId](unsigned int code, const std::string& reason)
-                { RemoveUser(sessionId, code, reason); });
-            if (!user->ws.OpenAsServer(connection, *request, *response, trailer))
+            std::string name;
+            for (const auto& segment : request->target.GetPath())
             {
-                (void)users.erase(sessionId);
-                response->statusCode = 200;
-                response->headers.SetHeader("Content-Type", "Text/plain");
-                response->body = "Try again, but next time use a WebSocket. thxbye!";
+                if (segment.empty())
+                { continue; }
+                if (!name.empty())
+                { name += '/'; }
+                name += segment;
+            }
+            Room* room = nullptr;
+            {
+                std::lock_guard<decltype(mutex)> lock(mutex);
+                auto roomEntry = rooms.find(name);
+                if (roomEntry == rooms.end())
+                {
+                    if (rooms.size() >= roomLimit)
+                    { ReclaimIdleRooms(); }
+                    if (rooms.size() >= roomLimit)
+                    {
+                        const auto response = std::make_shared<Http::Client::Response>();
+                        response->statusCode = 503;
+                        response->status = "Service Unavailable";
+                        response->headers.SetHeader("Content-Type", "Text/plain");
+                        response->body = "Too many chat rooms.";
+                        return response;
+                    }
+                    roomEntry = AddRoom(name);
+                }
+                room = roomEntry->second.get();
+                ++room->usersJoining;
+                room->lastUse = ++uses;
             }
+            const auto response = room->AddUser(request, connection, trailer);
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            --room->usersJoining;
+            if (response->statusCode != 101)
+            { (void)ReclaimRoom(rooms.find(name)); }
             return response;
         }
-    } room;
+    } chatRooms;
 }  // namespace
 
 /**
@@ -553,22 +1924,78 @@ extern "C" API void LoadPlugin(
     auto space = uri.GetPath();
     (void)space.erase(space.begin());
 
-    room.diagnosticsMessageDelegate = diagnosticMessageDelegate;
-    room.Start();
+    // Determine how much history the chat room retains.
+    RoomSettings settings;
+    if (configuration.Has("history-count"))
+    { settings.historyCount = (size_t)std::max((int)configuration["history-count"], 1); }
+    if (configuration.Has("history-bytes"))
+    { settings.historyBytes = (size_t)std::max((int)configuration["history-bytes"], 0); }
+    if (configuration.Has("join-history-count"))
+    {
+        settings.joinHistoryCount =
+            (size_t)std::max((int)configuration["join-history-count"], 0);
+    }
+
+    // Determine how to deal with users slow to take messages.
+    if (configuration.Has("outbound-queue-limit"))
+    {
+        settings.outboundQueueLimit =
+            (size_t)std::max((int)configuration["outbound-queue-limit"], 1);
+    }
+    if (configuration.Has("outbound-window-bytes"))
+    {
+        settings.outboundWindowBytes =
+            (size_t)std::max((int)configuration["outbound-window-bytes"], 0);
+    }
+    if (configuration.Has("slow-consumer-policy"))
+    {
+        const std::string slowConsumerPolicy = configuration["slow-consumer-policy"];
+        if (slowConsumerPolicy == "disconnect")
+        {
+            settings.slowConsumerPolicy = OutboundQueue::SlowConsumerPolicy::Disconnect;
+        } else if (slowConsumerPolicy != "drop-oldest")
+        {
+            diagnosticMessageDelegate(
+                "", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                StringUtils::sprintf("unknown slow consumer policy '%s'; dropping oldest",
+                                     slowConsumerPolicy.c_str()));
+        }
+    }
+
+    if (configuration.Has("history-path"))
+    {
+        settings.historyPath = (std::string)configuration["history-path"];
+        if (!SystemUtils::File::IsAbsolutePath(settings.historyPath))
+        {
+            settings.historyPath =
+                SystemUtils::File::GetExeParentDirectory() + "/" + settings.historyPath;
+        }
+    }
+    if (configuration.Has("history-segment-bytes"))
+    {
+        settings.historySegmentBytes =
+            (size_t)std::max((int)configuration["history-segment-bytes"], 1);
+    }
+    settings.diagnosticsMessageDelegate = diagnosticMessageDelegate;
+
+    // Determine how many chat rooms there may be, and how many
+    // threads share out their housekeeping.
+    chatRooms.roomLimit = DEFAULT_ROOM_LIMIT;
+    if (configuration.Has("room-limit"))
+    { chatRooms.roomLimit = (size_t)std::max((int)configuration["room-limit"], 1); }
+    size_t numShards = std::max(std::thread::hardware_concurrency(), 1U);
+    if (configuration.Has("shards"))
+    { numShards = (size_t)std::max((int)configuration["shards"], 1); }
+    chatRooms.Start(numShards, settings);
     const auto unregistrationDelegate = server->RegisterResource(
         space, [](std::shared_ptr<Http::IServer::Request> request,
                   std::shared_ptr<Http::Connection> connection, const std::string& trailer)
-        { return room.AddUser(request, connection, trailer); });
+        { return chatRooms.AddUser(request, connection, trailer); });
 
     unloadDelegate = [unregistrationDelegate]
     {
         unregistrationDelegate();
-        room.Stop();
-        room.users.clear();
-        room.accounts.clear();
-        room.usersHaveClosed = false;
-        room.diagnosticsMessageDelegate = nullptr;
-        room.nextSessionId = 1;
+        chatRooms.Stop();
     };
 }
 
@@ -0,0 +1,197 @@
+/**
+ * @file OutboundQueue.cpp
+ *
+ * This module contains the implementation of the OutboundQueue class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include "OutboundQueue.hpp"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+struct OutboundQueue::Impl
+{
+    // Properties
+
+    /**
+     * This synchronizes access to the queue.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * These are the messages waiting to be sent, oldest first.
+     */
+    std::deque<Message> messages;
+
+    /**
+     * This is the maximum number of messages to hold in the queue.
+     */
+    size_t capacity = 1;
+
+    /**
+     * This is how to deal with the queue being full.
+     */
+    SlowConsumerPolicy policy = SlowConsumerPolicy::DropOldest;
+
+    /**
+     * This is the function to call to send one message to the user.
+     */
+    SendDelegate sendDelegate;
+
+    /**
+     * This is the function to call to disconnect the user.
+     */
+    DisconnectDelegate disconnectDelegate;
+
+    /**
+     * This is the maximum number of bytes sent which the user
+     * may not have acknowledged, or zero if there's no limit.
+     */
+    size_t windowBytes = 0;
+
+    /**
+     * This is the function to call after sending messages,
+     * to have the user acknowledge once it received them.
+     */
+    MarkDelegate markDelegate;
+
+    /**
+     * This is the number of bytes sent to the user.
+     */
+    size_t sentBytes = 0;
+
+    /**
+     * This is the number of bytes sent up to the last mark
+     * the user was asked to acknowledge.
+     */
+    size_t markedBytes = 0;
+
+    /**
+     * This is the number of bytes sent which the user
+     * acknowledged receiving.
+     */
+    size_t acknowledgedBytes = 0;
+
+    /**
+     * This indicates whether or not a thread is sending
+     * the messages in the queue.
+     */
+    bool sending = false;
+
+    /**
+     * This indicates whether or not the queue overflowed under
+     * the policy of disconnecting the user.
+     */
+    bool overflowed = false;
+
+    /**
+     * This indicates whether or not the user was disconnected.
+     */
+    bool disconnected = false;
+
+    /**
+     * This is the number of messages dropped because the queue was full.
+     */
+    size_t dropped = 0;
+
+    // Methods
+
+    /**
+     * This method indicates whether or not the user has
+     * as many bytes it hasn't acknowledged as the window allows.
+     *
+     * @return
+     *      An indication of whether or not the window is full is returned.
+     */
+    bool IsWindowFull() const {
+        return ((windowBytes != 0) && (sentBytes - acknowledgedBytes >= windowBytes));
+    }
+};
+
+OutboundQueue::~OutboundQueue() noexcept = default;
+
+OutboundQueue::OutboundQueue(size_t capacity, SlowConsumerPolicy policy,
+                             SendDelegate sendDelegate, DisconnectDelegate disconnectDelegate)
+    : impl_(new Impl()) {
+    impl_->capacity = std::max(capacity, (size_t)1);
+    impl_->policy = policy;
+    impl_->sendDelegate = sendDelegate;
+    impl_->disconnectDelegate = disconnectDelegate;
+}
+
+bool OutboundQueue::Push(Message message) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (impl_->overflowed)
+    { return false; }
+    if (impl_->messages.size() >= impl_->capacity)
+    {
+        if (impl_->policy == SlowConsumerPolicy::Disconnect)
+        {
+            impl_->dropped += impl_->messages.size() + 1;
+            impl_->messages.clear();
+            impl_->overflowed = true;
+            return false;
+        }
+        impl_->messages.pop_front();
+        ++impl_->dropped;
+    }
+    impl_->messages.push_back(std::move(message));
+    return true;
+}
+
+void OutboundQueue::SetWindow(size_t windowBytes, MarkDelegate markDelegate) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    impl_->windowBytes = windowBytes;
+    impl_->markDelegate = markDelegate;
+}
+
+bool OutboundQueue::Acknowledge(size_t mark) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if ((mark > impl_->acknowledgedBytes) && (mark <= impl_->markedBytes))
+    { impl_->acknowledgedBytes = mark; }
+    return !impl_->messages.empty();
+}
+
+void OutboundQueue::Flush() {
+    std::unique_lock<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (impl_->sending)
+    { return; }
+    impl_->sending = true;
+    for (;;)
+    {
+        if (impl_->overflowed && !impl_->disconnected)
+        {
+            impl_->disconnected = true;
+            lock.unlock();
+            impl_->disconnectDelegate();
+            lock.lock();
+        }
+        if (impl_->messages.empty() || impl_->IsWindowFull())
+        {
+            // The user may acknowledge the mark before the delegate
+            // returns, so the window is checked again afterwards.
+            if ((impl_->sentBytes == impl_->markedBytes) || !impl_->markDelegate)
+            { break; }
+            impl_->markedBytes = impl_->sentBytes;
+            const auto mark = impl_->markedBytes;
+            lock.unlock();
+            impl_->markDelegate(mark);
+            lock.lock();
+            continue;
+        }
+        const auto message = std::move(impl_->messages.front());
+        impl_->messages.pop_front();
+        impl_->sentBytes += message->length();
+        lock.unlock();
+        impl_->sendDelegate(*message);
+        lock.lock();
+    }
+    impl_->sending = false;
+}
+
+size_t OutboundQueue::GetDroppedCount() const {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    return impl_->dropped;
+}
@@ -0,0 +1,197 @@
+#ifndef CHAT_ROOM_PLUGIN_OUTBOUND_QUEUE_HPP
+#define CHAT_ROOM_PLUGIN_OUTBOUND_QUEUE_HPP
+
+/**
+ * @file OutboundQueue.hpp
+ *
+ * This module declares the OutboundQueue class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * This class holds the messages waiting to be sent to one user of the
+ * chat room. Messages are encoded once and shared between the queues
+ * of all the users they're sent to.
+ *
+ * Messages are pushed while the chat room is locked, and sent later,
+ * by calling Flush once the chat room is unlocked. Whichever thread
+ * flushes the queue first sends all the messages queued, including
+ * those pushed while it's sending, while other threads flushing
+ * the same queue return immediately. This way, a user slow to take
+ * the messages sent to it holds up neither the chat room nor the
+ * threads serving other users.
+ *
+ * The number of messages queued is bounded. When the queue is full,
+ * either the oldest message queued is dropped, or the user is
+ * disconnected, depending on the policy chosen.
+ *
+ * Sending a message only hands it over to be delivered, so the queue
+ * may also be given a window: the number of bytes sent which the user
+ * may not have received yet. Once the window is full, messages stay
+ * in the queue, under its bound and policy, until the user acknowledges
+ * receiving the bytes sent up to a mark the queue asked it to acknowledge.
+ */
+class OutboundQueue
+{
+    // Types
+public:
+    /**
+     * This is the type of message held in the queue.
+     */
+    typedef std::shared_ptr<const std::string> Message;
+
+    /**
+     * These are the ways to deal with a user who doesn't take messages
+     * as fast as they're sent to it.
+     */
+    enum class SlowConsumerPolicy
+    {
+        /**
+         * Drop the oldest message queued to make room for the new one.
+         */
+        DropOldest,
+
+        /**
+         * Drop all messages queued and disconnect the user.
+         */
+        Disconnect,
+    };
+
+    /**
+     * This is the type of function called to send one message to the user.
+     *
+     * @param[in] message
+     *      This is the message to send.
+     */
+    typedef std::function<void(const std::string& message)> SendDelegate;
+
+    /**
+     * This is the type of function called to disconnect the user.
+     */
+    typedef std::function<void()> DisconnectDelegate;
+
+    /**
+     * This is the type of function called, after sending messages,
+     * to have the user acknowledge once it received them.
+     *
+     * @param[in] mark
+     *      This is the number of bytes sent so far, to be given
+     *      back to Acknowledge once the user received them.
+     */
+    typedef std::function<void(size_t mark)> MarkDelegate;
+
+    // Lifecycle Methods
+public:
+    ~OutboundQueue() noexcept;
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue(OutboundQueue&&) noexcept = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(OutboundQueue&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] capacity
+     *      This is the maximum number of messages to hold in the queue.
+     *
+     * @param[in] policy
+     *      This is how to deal with the queue being full.
+     *
+     * @param[in] sendDelegate
+     *      This is the function to call to send one message to the user.
+     *
+     * @param[in] disconnectDelegate
+     *      This is the function to call to disconnect the user.
+     */
+    OutboundQueue(size_t capacity, SlowConsumerPolicy policy, SendDelegate sendDelegate,
+                  DisconnectDelegate disconnectDelegate);
+
+    /**
+     * This method adds the given message to the end of the queue.
+     *
+     * @param[in] message
+     *      This is the message to add.
+     *
+     * @return
+     *      An indication of whether or not the user is still taking
+     *      messages is returned. It isn't once the queue overflowed
+     *      under the policy of disconnecting the user.
+     */
+    bool Push(Message message);
+
+    /**
+     * This method limits the number of bytes sent which the user
+     * hasn't acknowledged receiving yet.
+     *
+     * @param[in] windowBytes
+     *      This is the maximum number of bytes sent which the user
+     *      may not have acknowledged. Once it's reached, no more messages
+     *      are sent until the user acknowledges some. A message is
+     *      always sent once every one sent before it was acknowledged.
+     *      Zero means there's no limit.
+     *
+     * @param[in] markDelegate
+     *      This is the function to call after sending messages,
+     *      to have the user acknowledge once it received them.
+     */
+    void SetWindow(size_t windowBytes, MarkDelegate markDelegate);
+
+    /**
+     * This method records that the user received the bytes sent
+     * up to the given mark.
+     *
+     * @param[in] mark
+     *      This is the mark given to the function called to have
+     *      the user acknowledge receiving the messages sent.
+     *
+     * @return
+     *      An indication of whether or not messages are waiting
+     *      to be sent, so that the queue needs flushing, is returned.
+     */
+    bool Acknowledge(size_t mark);
+
+    /**
+     * This method sends the messages in the queue, as far as the
+     * window allows, unless another thread is already doing so,
+     * and disconnects the user if the queue overflowed
+     * under the policy of doing so.
+     *
+     * This must not be called while holding a lock that
+     * the functions given to the constructor take.
+     */
+    void Flush();
+
+    /**
+     * This method returns the number of messages dropped
+     * because the queue was full.
+     *
+     * @return
+     *      The number of messages dropped because the queue
+     *      was full is returned.
+     */
+    size_t GetDroppedCount() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* CHAT_ROOM_PLUGIN_OUTBOUND_QUEUE_HPP */
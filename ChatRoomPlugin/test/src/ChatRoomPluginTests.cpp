@@ -8,6 +8,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <mutex>
 #include <condition_variable>
 #include <SystemUtils/File.hpp>
@@ -15,6 +16,8 @@
 #include <WebServer/PluginEntryPoint.hpp>
 #include <WebSocket/WebSocket.hpp>
 #include <functional>
+#include <thread>
+#include <chrono>
 
 #ifdef _WIN32
 #    define API __declspec(dllimport)
@@ -141,6 +144,99 @@ namespace
 
         virtual void Break(bool clean) override { broken = true; }
     };
+
+    /**
+     * This builds the message the chat room broadcasts
+     * when a user changes their user name.
+     *
+     * @param[in] oldUserName
+     *      This is the user name before the change.
+     *
+     * @param[in] userName
+     *      This is the user name after the change.
+     *
+     * @return
+     *      The message broadcast for the change is returned.
+     */
+    Json::Value UserNameModified(const std::string& oldUserName, const std::string& userName) {
+        return Json::Object(
+            {{"Type", "UserNameModified"}, {"OldUserName", oldUserName}, {"UserName", userName}});
+    }
+
+    /**
+     * This builds the message the chat room broadcasts
+     * when the list of users in it changes.
+     *
+     * @param[in] userNames
+     *      These are the user names of the users in the chat room.
+     *
+     * @return
+     *      The message broadcast for the change is returned.
+     */
+    Json::Value UserNames(const std::vector<std::string>& userNames) {
+        Json::Value userNamesArray(Json::Value::Type::Array);
+        for (const auto& userName : userNames)
+        { userNamesArray.Add(userName); }
+        return Json::Object({{"Type", "UserNames"}, {"UserNames", userNamesArray}});
+    }
+
+    /**
+     * This appends a little-endian number of the given size
+     * to the given data.
+     *
+     * @param[in, out] data
+     *      This is the data to which to append the number.
+     *
+     * @param[in] value
+     *      This is the number to append.
+     *
+     * @param[in] size
+     *      This is the number of bytes of the number.
+     */
+    void AppendNumber(std::string& data, uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; ++i)
+        {
+            data.push_back((char)(value & 0xFF));
+            value >>= 8;
+        }
+    }
+
+    /**
+     * This encodes one message as a record of the log
+     * in which the chat room keeps its history.
+     *
+     * @param[in] seq
+     *      This is the sequence number of the message.
+     *
+     * @param[in] sender
+     *      This is the user name of the user who posted the message.
+     *
+     * @param[in] chat
+     *      This is the content of the message.
+     *
+     * @return
+     *      The encoded record is returned.
+     */
+    std::string EncodeHistoryRecord(uint64_t seq, const std::string& sender,
+                                    const std::string& chat) {
+        std::string body;
+        AppendNumber(body, seq, 8);
+        for (const auto& field : {std::string(), sender, chat})
+        {
+            AppendNumber(body, field.length(), 4);
+            body += field;
+        }
+        uint32_t checksum = 2166136261U;
+        for (const auto c : body)
+        {
+            checksum ^= (uint8_t)c;
+            checksum *= 16777619U;
+        }
+        std::string record;
+        AppendNumber(record, body.length(), 4);
+        AppendNumber(record, checksum, 4);
+        return record + body;
+    }
 }  // namespace
 
 struct ChatRoomPluginTests : public ::testing::Test
@@ -195,6 +291,11 @@ struct ChatRoomPluginTests : public ::testing::Test
      */
     std::vector<Json::Value> messagesReceived[NUM_MOCK_CLIENTS];
 
+    /**
+     * This stores all binary messages received from the chat room.
+     */
+    std::vector<std::string> binaryMessagesReceived[NUM_MOCK_CLIENTS];
+
     /**
      * These are the diagnostic messages that have been received
      * from the unit under test.
@@ -206,6 +307,42 @@ struct ChatRoomPluginTests : public ::testing::Test
      * It's called to terminate the subscription.
      */
     SystemUtils::DiagnosticsSender::UnsubscribeDelegate diagnosticsUnsubscribeDelegate;
+
+    /**
+     * This is the path of the directory in which the chat room keeps
+     * its history, or an empty string if it's only kept in memory.
+     */
+    std::string historyPath;
+
+    /**
+     * This is the maximum number of bytes of history the chat room
+     * keeps, or zero to leave the default.
+     */
+    size_t historyBytes = 0;
+
+    /**
+     * This is the maximum number of chat rooms,
+     * or zero to leave the default.
+     */
+    size_t roomLimit = 0;
+
+    /**
+     * This is the maximum number of bytes handed to each user
+     * which it hasn't acknowledged, or zero to leave the default.
+     */
+    size_t outboundWindowBytes = 0;
+
+    /**
+     * This is the maximum number of messages waiting to be sent
+     * to each user, or zero to leave the default.
+     */
+    size_t outboundQueueLimit = 0;
+
+    /**
+     * This is how to deal with users slow to take messages,
+     * or an empty string to leave the default.
+     */
+    std::string slowConsumerPolicy;
     // Methods
 
     void InitilizeClientWebsocket(size_t i) {
@@ -226,6 +363,13 @@ struct ChatRoomPluginTests : public ::testing::Test
                 messagesReceived[i].push_back(Json::Value::FromEncoding(data));
                 wsWaitCondition.notify_all();
             });
+        ws[i].SetBinaryDelegate(
+            [this, i](const std::string& data)
+            {
+                std::lock_guard<decltype(wsMutex)> lock(wsMutex);
+                binaryMessagesReceived[i].push_back(data);
+                wsWaitCondition.notify_all();
+            });
         ws[i].SetCloseDelegate(
             [this, i](unsigned int code, const std::string& reason)
             {
@@ -239,6 +383,18 @@ struct ChatRoomPluginTests : public ::testing::Test
     virtual void SetUp() {
         Json::Value config(Json::Value::Type::Object);
         config.Set("space", CHAT_ROOM_PATH);
+        if (!historyPath.empty())
+        { config.Set("history-path", historyPath); }
+        if (historyBytes > 0)
+        { config.Set("history-bytes", (int)historyBytes); }
+        if (roomLimit > 0)
+        { config.Set("room-limit", (int)roomLimit); }
+        if (outboundWindowBytes > 0)
+        { config.Set("outbound-window-bytes", (int)outboundWindowBytes); }
+        if (outboundQueueLimit > 0)
+        { config.Set("outbound-queue-limit", (int)outboundQueueLimit); }
+        if (!slowConsumerPolicy.empty())
+        { config.Set("slow-consumer-policy", slowConsumerPolicy); }
         LoadPlugin(
             &server, config,
             [this](std::string senderName, size_t level, std::string message)
@@ -291,9 +447,8 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SetUserName_Test) {
     ASSERT_EQ((std::vector<std::string>{" Session #1[1]: User name changed from '' to 'Hatem'"}),
               diagnosticMessages);
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"Hatem\", \"UserNames\": [\"Hatem\"]}"),
+                  UserNameModified("", "Hatem"),
+                  UserNames({"Hatem"}),
                   Json::Value::FromEncoding("{\"Type\":\"UserNames\", \"UserNames\": [\"Hatem\"]}"),
               }),
               messagesReceived[0]);
@@ -325,9 +480,8 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SetUserNameTwice_Test) {
     expectedResponse.Set("Type", "SetUserNameResult");
     expectedResponse.Set("Success", false);
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"\", \"UserNames\": [\"Hatem\"]}"),
+                  UserNameModified("", "Hatem"),
+                  UserNames({"Hatem"}),
                   expectedResponse}),
               messagesReceived[1]);
     messagesReceived[1].clear();
@@ -345,12 +499,8 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SetUserNameTwice_Test) {
     expectedResponse.Set("Type", "SetUserNameResult");
     expectedResponse.Set("Success", true);
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"\", \"UserNames\": [\"Hatem\"]}"),
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"\", \"UserNames\": [\"Hatem\"]}"),
+                  UserNameModified("", "Hatem"),
+                  UserNames({"Hatem"}),
                   expectedResponse}),
               messagesReceived[2]);
     messagesReceived[2].clear();
@@ -362,12 +512,7 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SetUserNameTwice_Test) {
     expectedResponse.Set("Type", "UserNames");
     expectedResponse.Set("UserNames", {"Hatem"});
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"\", \"UserNames\": [\"Hatem\"]}"),
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"\", \"UserNames\": [\"Hatem\"]}"),
+                  UserNameModified("", "Hatem"),
                   expectedResponse}),
               messagesReceived[1]);
     messagesReceived[1].clear();
@@ -425,9 +570,8 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_TellSomeThings_Test) {
     expectedResponse.Set("Type", "SetUserNameResult");
     expectedResponse.Set("Success", true);
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"\", \"UserNames\": [\"Hatem\"]}"),
+                  UserNameModified("", "Hatem"),
+                  UserNames({"Hatem"}),
                   expectedResponse}),
               messagesReceived[1]);
     messagesReceived[1].clear();
@@ -440,12 +584,10 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_TellSomeThings_Test) {
     expectedResponse.Set("Type", "UserNames");
     expectedResponse.Set("UserNames", {"Hatem", "Maya"});
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding(
-                      "{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                      "\"UserNameModified\",\"UserName\": \"Hatem\", \"UserNames\": [\"Hatem\"]}"),
-                  Json::Value::FromEncoding("{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                                            "\"UserNameModified\",\"UserName\": \"Hatem\", "
-                                            "\"UserNames\": [\"Hatem\", \"Maya\"]}"),
+                  UserNameModified("", "Hatem"),
+                  UserNames({"Hatem"}),
+                  UserNameModified("", "Maya"),
+                  UserNames({"Hatem", "Maya"}),
                   expectedResponse}),
               messagesReceived[0]);
     messagesReceived[0].clear();
@@ -461,11 +603,9 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_TellSomeThings_Test) {
     expectedResponse.Set("Sender", "Maya");
     expectedResponse.Set("Chat", "Hello");
     expectedResponse.Set("Time", "");
+    expectedResponse.Set("Seq", 1);
     ASSERT_EQ((std::vector<Json::Value>{
-                  Json::Value::FromEncoding("{\"ChatLog\": [], \"Success\": true, \"Type\": "
-                                            "\"UserNameModified\",\"UserName\": \"Maya\", "
-                                            "\"UserNames\": [\"Hatem\", \"Maya\"]}"),
-                  expectedResponse}),
+                  UserNameModified("", "Maya"), UserNames({"Hatem", "Maya"}), expectedResponse}),
               messagesReceived[1]);
     ASSERT_EQ((std::vector<std::string>{" Session #2[1]: User 'Maya' sent 'Hello' to the room"}),
               diagnosticMessages);
@@ -498,14 +638,9 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_LeaveTheRoom_Test) {
     expectedResponse = Json::Value(Json::Value::Type::Object);
     expectedResponse.Set("Type", "SetUserNameResult");
     expectedResponse.Set("Success", true);
-    ASSERT_EQ(
-        (std::vector<Json::Value>{
-            Json::Value::FromEncoding("{\"ChatLog\": [{\"Chat\": \"Hello\", \"Sender\":\"Maya\", "
-                                      "\"Time\":\"\"}], \"Success\": true, \"Type\": "
-                                      "\"UserNameModified\",\"UserName\": \"\" , "
-                                      "\"UserNames\": [\"Hatem\"]}"),
-            expectedResponse}),
-        messagesReceived[1]);
+    ASSERT_EQ((std::vector<Json::Value>{UserNameModified("", "Hatem"), UserNames({"Hatem"}),
+                                        expectedResponse}),
+              messagesReceived[1]);
     messagesReceived[1].clear();
     EXPECT_TRUE(messagesReceived[1].empty());
 
@@ -516,18 +651,10 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_LeaveTheRoom_Test) {
     expectedResponse = Json::Value(Json::Value::Type::Object);
     expectedResponse.Set("Type", "UserNames");
     expectedResponse.Set("UserNames", {"Hatem", "Maya"});
-    ASSERT_EQ(
-        (std::vector<Json::Value>{
-            Json::Value::FromEncoding("{\"ChatLog\": [{\"Chat\": \"Hello\", \"Sender\":\"Maya\", "
-                                      "\"Time\":\"\"}], \"Success\": true, \"Type\": "
-                                      "\"UserNameModified\",\"UserName\": \"Hatem\" , "
-                                      "\"UserNames\": [\"Hatem\"]}"),
-            Json::Value::FromEncoding("{\"ChatLog\": [{\"Chat\": \"Hello\", \"Sender\":\"Maya\", "
-                                      "\"Time\":\"\"}], \"Success\": true, \"Type\": "
-                                      "\"UserNameModified\",\"UserName\": \"Hatem\" , "
-                                      "\"UserNames\": [\"Hatem\", \"Maya\"]}"),
-            expectedResponse}),
-        messagesReceived[0]);
+    ASSERT_EQ((std::vector<Json::Value>{UserNameModified("", "Hatem"), UserNames({"Hatem"}),
+                                        UserNameModified("", "Maya"),
+                                        UserNames({"Hatem", "Maya"}), expectedResponse}),
+              messagesReceived[0]);
     messagesReceived[0].clear();
 
     // Maya says some things.
@@ -540,14 +667,10 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_LeaveTheRoom_Test) {
     expectedResponse.Set("Sender", "Maya");
     expectedResponse.Set("Chat", "Hello");
     expectedResponse.Set("Time", "");
-    ASSERT_EQ(
-        (std::vector<Json::Value>{
-            Json::Value::FromEncoding("{\"ChatLog\": [{\"Chat\": \"Hello\", \"Sender\":\"Maya\", "
-                                      "\"Time\":\"\"}], \"Success\": true, \"Type\": "
-                                      "\"UserNameModified\",\"UserName\": \"Maya\" , "
-                                      "\"UserNames\": [\"Hatem\", \"Maya\"]}"),
-            expectedResponse}),
-        messagesReceived[1]);
+    expectedResponse.Set("Seq", 2);
+    ASSERT_EQ((std::vector<Json::Value>{UserNameModified("", "Maya"),
+                                        UserNames({"Hatem", "Maya"}), expectedResponse}),
+              messagesReceived[1]);
     messagesReceived[1].clear();
     ASSERT_EQ((std::vector<Json::Value>{expectedResponse}), messagesReceived[0]);
     messagesReceived[0].clear();
@@ -556,8 +679,8 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_LeaveTheRoom_Test) {
     ws[1].Close();
     {
         std::unique_lock<decltype(wsMutex)> lock(wsMutex);
-        wsWaitCondition.wait(lock,
-                             [this] { return (!messagesReceived[0].empty() && wsClosed[1]); });
+        wsWaitCondition.wait(
+            lock, [this] { return ((messagesReceived[0].size() >= 2) && wsClosed[1]); });
     }
     // Hatem peeks at the chat room member list.
     message = Json::Value(Json::Value::Type::Object);
@@ -578,6 +701,75 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_LeaveTheRoom_Test) {
     EXPECT_TRUE(messagesReceived[0].empty());
 }
 
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_ShareUserNameBetweenSessions_Test) {
+    // Hatem joins the chat room from two connections.
+    for (const auto i : {0, 2})
+    {
+        ws[i].SendText(Json::Object({{"Type", "SetUserName"},
+                                     {"UserName", "Hatem"},
+                                     {"Password", "PopChamp"}})
+                           .ToEncoding());
+    }
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (messagesReceived[1].size() >= 3); });
+    }
+    for (size_t i = 0; i < NUM_MOCK_CLIENTS; ++i)
+    { messagesReceived[i].clear(); }
+
+    // Hatem closes one of them, and Maya joins the chat room, which
+    // the chat room gets around to after Hatem's connection is closed.
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    ws[1].SendText(
+        Json::Object({{"Type", "SetUserName"}, {"UserName", "Maya"}, {"Password", "PopOps"}})
+            .ToEncoding());
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (messagesReceived[1].size() >= 3); });
+    }
+
+    // Hatem is still in the chat room, so his leaving one connection
+    // is neither announced, nor makes the list of users go out again;
+    // only Maya joining does.
+    ASSERT_EQ(3, messagesReceived[1].size());
+    EXPECT_NE(messagesReceived[1].end(), std::find(messagesReceived[1].begin(),
+                                                   messagesReceived[1].end(),
+                                                   UserNameModified("", "Maya")));
+    for (const auto& message : messagesReceived[1])
+    {
+        EXPECT_NE("Leave", (std::string)message["Type"]);
+        if ((std::string)message["Type"] == "UserNames")
+        { EXPECT_EQ(UserNames({"Hatem", "Maya"}), message); }
+    }
+    messagesReceived[1].clear();
+    ws[1].SendText(Json::Object({{"Type", "GetUserNames"}}).ToEncoding());
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (messagesReceived[1].size() >= 1); });
+    }
+    Json::Value expectedResponse(Json::Value::Type::Object);
+    expectedResponse.Set("Type", "UserNames");
+    expectedResponse.Set("UserNames", {"Hatem", "Maya"});
+    EXPECT_EQ((std::vector<Json::Value>{expectedResponse}), messagesReceived[1]);
+    messagesReceived[1].clear();
+
+    // Once Hatem closes his last connection, he leaves the chat room,
+    // and the list of users goes out again.
+    ws[0].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (messagesReceived[1].size() >= 2); });
+    }
+    expectedResponse.Set("UserNames", {"Maya"});
+    EXPECT_EQ((std::vector<Json::Value>{Json::Object({{"Type", "Leave"}, {"UserName", "Hatem"}}),
+                                        expectedResponse}),
+              messagesReceived[1]);
+}
+
 TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SetUserNameInTrailer_test) {
     // Reopen a WebSocket connection with part of a "SetUserName" message
     // captured in the trailer.
@@ -625,15 +817,9 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SetUserNameInTrailer_test) {
     expectedResponse = Json::Value(Json::Value::Type::Object);
     expectedResponse.Set("Type", "UserNames");
     expectedResponse.Set("UserNames", {"Hatem"});
-    ASSERT_EQ(
-        (std::vector<Json::Value>{
-            Json::Value::FromEncoding(
-                "{\"ChatLog\": [{\"Chat\": \"Hello\", \"Sender\":\"Maya\", \"Time\":\"\"}, "
-                "{\"Chat\": \"Hello\", \"Sender\":\"Maya\", \"Time\":\"\"}], \"Success\": true, "
-                "\"Type\": \"UserNameModified\", \"UserName\": \"Hatem\" , \"UserNames\": "
-                "[\"Hatem\"]}"),
-            expectedResponse}),
-        messagesReceived[0]);
+    ASSERT_EQ((std::vector<Json::Value>{UserNameModified("", "Hatem"), UserNames({"Hatem"}),
+                                        expectedResponse}),
+              messagesReceived[0]);
     messagesReceived[0].clear();
     EXPECT_TRUE(messagesReceived[0].empty());
 }
@@ -665,3 +851,534 @@ TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_ChangeUserName_Test) {
     expectedResponse.Set("Success", true);
     ASSERT_EQ((std::vector<Json::Value>{expectedResponse}), messagesReceived[0]);
 }
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_GetOlderChatLog_Test) {
+    for (const auto chat : {"One", "Two", "Three"})
+    { ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", chat}}).ToEncoding()); }
+    ASSERT_EQ(3, messagesReceived[0].size());
+    const auto firstSeq = (int)messagesReceived[0][0]["Seq"];
+    EXPECT_EQ(firstSeq + 1, (int)messagesReceived[0][1]["Seq"]);
+    EXPECT_EQ(firstSeq + 2, (int)messagesReceived[0][2]["Seq"]);
+    messagesReceived[0].clear();
+
+    // Ask for the two messages before the last one.
+    ws[0].SendText(
+        Json::Object({{"Type", "GetChatLog"}, {"Before", firstSeq + 2}, {"Count", 2}})
+            .ToEncoding());
+    auto chatLog = Json::Value(Json::Value::Type::Array);
+    chatLog.Add(Json::Object({{"Seq", firstSeq}, {"Time", ""}, {"Sender", ""}, {"Chat", "One"}}));
+    chatLog.Add(
+        Json::Object({{"Seq", firstSeq + 1}, {"Time", ""}, {"Sender", ""}, {"Chat", "Two"}}));
+    ASSERT_EQ((std::vector<Json::Value>{Json::Object(
+                  {{"Type", "ChatLog"}, {"ChatLog", chatLog}, {"More", firstSeq > 1}})}),
+              messagesReceived[0]);
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_TurnDownChatTooLargeForHistory_Test) {
+    TearDown();
+    historyBytes = 1024;
+    SetUp();
+    ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "One"}}).ToEncoding());
+    ASSERT_EQ(1, messagesReceived[0].size());
+    for (size_t i = 0; i < NUM_MOCK_CLIENTS; ++i)
+    { messagesReceived[i].clear(); }
+
+    // A message which can't fit in the history is turned down,
+    // without pushing older messages out of the history.
+    const std::string tooLarge(2 * historyBytes, 'x');
+    ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", tooLarge}}).ToEncoding());
+    ASSERT_EQ((std::vector<Json::Value>{Json::Object({{"Type", "PostChatResult"},
+                                                      {"Success", false},
+                                                      {"Chat", tooLarge},
+                                                      {"Time", ""}})}),
+              messagesReceived[0]);
+    EXPECT_TRUE(messagesReceived[1].empty());
+    messagesReceived[0].clear();
+    ws[0].SendText(Json::Object({{"Type", "GetChatLog"}}).ToEncoding());
+    auto chatLog = Json::Value(Json::Value::Type::Array);
+    chatLog.Add(Json::Object({{"Seq", 1}, {"Time", ""}, {"Sender", ""}, {"Chat", "One"}}));
+    EXPECT_EQ((std::vector<Json::Value>{Json::Object(
+                  {{"Type", "ChatLog"}, {"ChatLog", chatLog}, {"More", false}})}),
+              messagesReceived[0]);
+    TearDown();
+    historyBytes = 0;
+    SetUp();
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_JoinChatRoomFromCursor_Test) {
+    for (const auto chat : {"One", "Two"})
+    { ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", chat}}).ToEncoding()); }
+    ASSERT_EQ(2, messagesReceived[0].size());
+    const auto lastSeq = (int)messagesReceived[0][1]["Seq"];
+    messagesReceived[0].clear();
+
+    // A user joining for the first time gets the most recent messages.
+    ws[0].SendText(Json::Object({{"Type", "JoinChatRoom"}}).ToEncoding());
+    ASSERT_FALSE(messagesReceived[0].empty());
+    auto response = messagesReceived[0][0];
+    EXPECT_EQ("JoinChatRoomResponse", (std::string)response["Type"]);
+    EXPECT_EQ(lastSeq, (int)response["Cursor"]);
+    const auto& chatLog = response["ChatLog"];
+    ASSERT_LE(2, chatLog.GetSize());
+    EXPECT_EQ("Two", (std::string)chatLog[chatLog.GetSize() - 1]["Chat"]);
+    EXPECT_EQ(lastSeq, (int)chatLog[chatLog.GetSize() - 1]["Seq"]);
+
+    // A user coming back only gets the messages posted since.
+    ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "Three"}}).ToEncoding());
+    messagesReceived[1].clear();
+    ws[1].SendText(Json::Object({{"Type", "JoinChatRoom"}, {"After", lastSeq}}).ToEncoding());
+    ASSERT_FALSE(messagesReceived[1].empty());
+    response = messagesReceived[1][0];
+    auto expectedChatLog = Json::Value(Json::Value::Type::Array);
+    expectedChatLog.Add(
+        Json::Object({{"Seq", lastSeq + 1}, {"Time", ""}, {"Sender", ""}, {"Chat", "Three"}}));
+    EXPECT_EQ(expectedChatLog, response["ChatLog"]);
+    EXPECT_EQ(lastSeq + 1, (int)response["Cursor"]);
+    EXPECT_FALSE((bool)response["More"]);
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_SeparateRooms_Test) {
+    // Move the third client to another room.
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    const auto openRequest = std::make_shared<Http::Server::Request>();
+    openRequest->method = "GET";
+    (void)openRequest->target.ParseFromString("/chat/lobby");
+    ws[2] = WebSocket::WebSocket();
+    InitilizeClientWebsocket(2);
+    ws[2].StartOpenAsClient(*openRequest);
+    const auto openResponse =
+        server.registredResourceDelegate(openRequest, serverConnection[2], "");
+    ASSERT_TRUE(ws[2].CompleteOpenAsClient(clientConnection[2], *openResponse));
+    for (size_t i = 0; i < NUM_MOCK_CLIENTS; ++i)
+    { messagesReceived[i].clear(); }
+
+    // Only users in the same room hear what is said there.
+    ws[2].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "Hi"}}).ToEncoding());
+    ASSERT_EQ((std::vector<Json::Value>{Json::Object({{"Type", "PostChatResult"},
+                                                      {"Seq", 1},
+                                                      {"Sender", ""},
+                                                      {"Chat", "Hi"},
+                                                      {"Time", ""}})}),
+              messagesReceived[2]);
+    EXPECT_TRUE(messagesReceived[0].empty());
+    EXPECT_TRUE(messagesReceived[1].empty());
+    messagesReceived[2].clear();
+    ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "Hello"}}).ToEncoding());
+    EXPECT_EQ(1, messagesReceived[0].size());
+    EXPECT_EQ(1, messagesReceived[1].size());
+    EXPECT_TRUE(messagesReceived[2].empty());
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_ReclaimIdleRooms_Test) {
+    TearDown();
+    roomLimit = 2;
+    SetUp();
+    const auto get = [this](const std::string& path)
+    {
+        const auto connection = std::make_shared<MockConnection>("mock-client");
+        connection->sendDataDelegate = [](const std::vector<uint8_t>& data) {};
+        const auto request = std::make_shared<Http::Server::Request>();
+        request->method = "GET";
+        (void)request->target.ParseFromString(path);
+        return server.registredResourceDelegate(request, connection, "")->statusCode;
+    };
+
+    // Requests which aren't upgraded don't leave chat rooms behind.
+    for (size_t i = 0; i < 5; ++i)
+    { EXPECT_EQ(200, get(StringUtils::sprintf("/chat/room%zu", i))); }
+
+    // Move the third client to another room, using up the last one.
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    const auto openRequest = std::make_shared<Http::Server::Request>();
+    openRequest->method = "GET";
+    (void)openRequest->target.ParseFromString("/chat/lobby");
+    ws[2] = WebSocket::WebSocket();
+    InitilizeClientWebsocket(2);
+    ws[2].StartOpenAsClient(*openRequest);
+    const auto openResponse =
+        server.registredResourceDelegate(openRequest, serverConnection[2], "");
+    ASSERT_TRUE(ws[2].CompleteOpenAsClient(clientConnection[2], *openResponse));
+    EXPECT_EQ(503, get("/chat/other"));
+
+    // Once its last user leaves, the chat room, having no history,
+    // makes way for a new one.
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    auto statusCode = get("/chat/other");
+    for (size_t i = 0; (statusCode == 503) && (i < 100); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        statusCode = get("/chat/other");
+    }
+    EXPECT_EQ(200, statusCode);
+
+    // The chat room with users isn't reclaimed.
+    ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "Still here"}}).ToEncoding());
+    EXPECT_EQ(1, messagesReceived[1].size());
+    TearDown();
+    roomLimit = 0;
+    SetUp();
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_HandleEventsWithoutPolling_Test) {
+    TearDown();
+    roomLimit = 2;
+    SetUp();
+    const auto waitFor = [this](size_t i, const std::function<bool(const Json::Value&)>& match)
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        return wsWaitCondition.wait_for(
+            lock, std::chrono::seconds(1),
+            [this, i, &match]
+            {
+                return std::any_of(messagesReceived[i].begin(), messagesReceived[i].end(),
+                                   match);
+            });
+    };
+    const auto setUserName = [this](size_t i, const std::string& userName)
+    {
+        ws[i].SendText(
+            Json::Object({{"Type", "SetUserName"}, {"UserName", userName}}).ToEncoding());
+    };
+
+    // The worker used to poll every 50 milliseconds, so each of these
+    // events, waited for in turn, took that long to reach the other users.
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < 20; ++i)
+    {
+        const auto userName = StringUtils::sprintf("Name%zu", i);
+        setUserName(0, userName);
+        ASSERT_TRUE(waitFor(1, [&userName](const Json::Value& message)
+                            { return (message == UserNames({userName})); }));
+    }
+
+    // Joining sends the list of users to the user joining only, so the
+    // list goes out to the others again only once it changes.
+    {
+        std::lock_guard<decltype(wsMutex)> lock(wsMutex);
+        messagesReceived[1].clear();
+    }
+    ws[2].SendText(Json::Object({{"Type", "JoinChatRoom"}}).ToEncoding());
+    setUserName(2, "Bob");
+    ASSERT_TRUE(waitFor(1, [](const Json::Value& message)
+                        { return (message == UserNames({"Bob", "Name19"})); }));
+    {
+        std::lock_guard<decltype(wsMutex)> lock(wsMutex);
+        EXPECT_EQ((std::vector<Json::Value>{UserNameModified("", "Bob"),
+                                            UserNames({"Bob", "Name19"})}),
+                  messagesReceived[1]);
+    }
+    ws[2].Close();
+    ASSERT_TRUE(waitFor(1, [](const Json::Value& message)
+                        { return (message == Json::Object({{"Type", "Leave"},
+                                                           {"UserName", "Bob"}})); }));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+
+    // A chat room the worker served is reclaimed once the worker is done
+    // with it and its last user left.
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    const auto openRequest = std::make_shared<Http::Server::Request>();
+    openRequest->method = "GET";
+    (void)openRequest->target.ParseFromString("/chat/lobby");
+    ws[2] = WebSocket::WebSocket();
+    InitilizeClientWebsocket(2);
+    ws[2].StartOpenAsClient(*openRequest);
+    const auto openResponse =
+        server.registredResourceDelegate(openRequest, serverConnection[2], "");
+    ASSERT_TRUE(ws[2].CompleteOpenAsClient(clientConnection[2], *openResponse));
+    ws[2].SendText(Json::Object({{"Type", "JoinChatRoom"}}).ToEncoding());
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    const auto get = [this](const std::string& path)
+    {
+        const auto connection = std::make_shared<MockConnection>("mock-client");
+        connection->sendDataDelegate = [](const std::vector<uint8_t>& data) {};
+        const auto request = std::make_shared<Http::Server::Request>();
+        request->method = "GET";
+        (void)request->target.ParseFromString(path);
+        return server.registredResourceDelegate(request, connection, "")->statusCode;
+    };
+    auto statusCode = get("/chat/other");
+    for (size_t i = 0; (statusCode == 503) && (i < 100); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        statusCode = get("/chat/other");
+    }
+    EXPECT_EQ(200, statusCode);
+    TearDown();
+    roomLimit = 0;
+    SetUp();
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_ReclaimRoomsWithHistory_Test) {
+    TearDown();
+    historyPath = SystemUtils::File::GetExeParentDirectory() + "/ChatRoomHistory";
+    (void)SystemUtils::File::DeleteDirectory(historyPath);
+    roomLimit = 2;
+    SetUp();
+    const auto get = [this](const std::string& path)
+    {
+        const auto connection = std::make_shared<MockConnection>("mock-client");
+        connection->sendDataDelegate = [](const std::vector<uint8_t>& data) {};
+        const auto request = std::make_shared<Http::Server::Request>();
+        request->method = "GET";
+        (void)request->target.ParseFromString(path);
+        return server.registredResourceDelegate(request, connection, "")->statusCode;
+    };
+    const auto moveThirdClient = [this](const std::string& path)
+    {
+        ws[2].Close();
+        {
+            std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+            wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+        }
+        const auto openRequest = std::make_shared<Http::Server::Request>();
+        openRequest->method = "GET";
+        (void)openRequest->target.ParseFromString(path);
+        ws[2] = WebSocket::WebSocket();
+        InitilizeClientWebsocket(2);
+        ws[2].StartOpenAsClient(*openRequest);
+        const auto openResponse =
+            server.registredResourceDelegate(openRequest, serverConnection[2], "");
+        return ws[2].CompleteOpenAsClient(clientConnection[2], *openResponse);
+    };
+
+    // The third client leaves a name and a chat in another room,
+    // using up the last one.
+    ASSERT_TRUE(moveThirdClient("/chat/lobby"));
+    ws[2].SendText(Json::Object({{"Type", "SetUserName"}, {"UserName", "Bob"}}).ToEncoding());
+    ws[2].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "Remember me"}}).ToEncoding());
+    EXPECT_EQ(503, get("/chat/other"));
+
+    // Once its last user leaves, the chat room makes way for a new one,
+    // even though it has history.
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    auto statusCode = get("/chat/other");
+    for (size_t i = 0; (statusCode == 503) && (i < 100); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        statusCode = get("/chat/other");
+    }
+    EXPECT_EQ(200, statusCode);
+
+    // The chat room is made again from its log when users come back.
+    ASSERT_TRUE(moveThirdClient("/chat/lobby"));
+    messagesReceived[2].clear();
+    ws[2].SendText(Json::Object({{"Type", "JoinChatRoom"}}).ToEncoding());
+    ASSERT_FALSE(messagesReceived[2].empty());
+    auto chatLog = Json::Value(Json::Value::Type::Array);
+    chatLog.Add(
+        Json::Object({{"Seq", 1}, {"Time", ""}, {"Sender", "Bob"}, {"Chat", "Remember me"}}));
+    EXPECT_EQ(chatLog, messagesReceived[2][0]["ChatLog"]);
+    TearDown();
+    ASSERT_TRUE(SystemUtils::File::DeleteDirectory(historyPath));
+    historyPath.clear();
+    roomLimit = 0;
+    SetUp();
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_KeepHistoryOnDisk_Test) {
+    // Prepare the log of a chat room named "journal".
+    TearDown();
+    historyPath = SystemUtils::File::GetExeParentDirectory() + "/ChatRoomHistory";
+    (void)SystemUtils::File::DeleteDirectory(historyPath);
+    const auto roomPath = historyPath + "/room-6a6f75726e616c";
+    ASSERT_TRUE(SystemUtils::File::CreateDirectory(roomPath));
+    SystemUtils::File segment(roomPath + "/00000000000000000007.log");
+    ASSERT_TRUE(segment.OpenReadWrite());
+    const auto record = EncodeHistoryRecord(7, "Hatem", "Hello from disk");
+    ASSERT_EQ(record.length(), segment.Write(record.data(), record.length()));
+    segment.Close();
+
+    // The chat room reads its log back when the plug-in is loaded.
+    SetUp();
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    const auto openRequest = std::make_shared<Http::Server::Request>();
+    openRequest->method = "GET";
+    (void)openRequest->target.ParseFromString("/journal");
+    ws[2] = WebSocket::WebSocket();
+    InitilizeClientWebsocket(2);
+    ws[2].StartOpenAsClient(*openRequest);
+    const auto openResponse =
+        server.registredResourceDelegate(openRequest, serverConnection[2], "");
+    ASSERT_TRUE(ws[2].CompleteOpenAsClient(clientConnection[2], *openResponse));
+    messagesReceived[2].clear();
+    ws[2].SendText(Json::Object({{"Type", "JoinChatRoom"}}).ToEncoding());
+    ASSERT_FALSE(messagesReceived[2].empty());
+    auto chatLog = Json::Value(Json::Value::Type::Array);
+    chatLog.Add(Json::Object(
+        {{"Seq", 7}, {"Time", ""}, {"Sender", "Hatem"}, {"Chat", "Hello from disk"}}));
+    EXPECT_EQ(chatLog, messagesReceived[2][0]["ChatLog"]);
+    EXPECT_EQ(7, (int)messagesReceived[2][0]["Cursor"]);
+
+    // New messages carry on from the log, and are appended to it.
+    messagesReceived[2].clear();
+    ws[2].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", "Hello again"}}).ToEncoding());
+    ASSERT_FALSE(messagesReceived[2].empty());
+    EXPECT_EQ(8, (int)messagesReceived[2][0]["Seq"]);
+    TearDown();
+    SystemUtils::File newSegment(roomPath + "/00000000000000000008.log");
+    EXPECT_TRUE(newSegment.IsExisting());
+    EXPECT_EQ(EncodeHistoryRecord(8, "", "Hello again").length(), newSegment.GetSize());
+    ASSERT_TRUE(SystemUtils::File::DeleteDirectory(historyPath));
+    historyPath.clear();
+    SetUp();
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_BinarySubprotocol_Test) {
+    // Reconnect the third client, asking for the binary subprotocol.
+    ws[2].Close();
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (wsClosed[2]); });
+    }
+    const auto openRequest = std::make_shared<Http::Server::Request>();
+    openRequest->method = "GET";
+    (void)openRequest->target.ParseFromString("/chat/binary");
+    ws[2] = WebSocket::WebSocket();
+    InitilizeClientWebsocket(2);
+    ws[2].StartOpenAsClient(*openRequest);
+    openRequest->headers.SetHeader("Sec-WebSocket-Protocol", "chat.v2, chat.msgpack");
+    const auto openResponse =
+        server.registredResourceDelegate(openRequest, serverConnection[2], "");
+    EXPECT_EQ("chat.msgpack", openResponse->headers.GetHeaderValue("Sec-WebSocket-Protocol"));
+
+    // The client end of the WebSocket doesn't negotiate subprotocols itself.
+    openResponse->headers.RemoveHeader("Sec-WebSocket-Protocol");
+    ASSERT_TRUE(ws[2].CompleteOpenAsClient(clientConnection[2], *openResponse));
+
+    // Messages are MessagePack maps with integer keys and type tags:
+    // {Type: SetUserName, UserName: "Bob"}.
+    ws[2].SendBinary(std::string("\x82\x00\x01\x01\xa3"
+                                 "Bob",
+                                 8));
+    {
+        std::unique_lock<decltype(wsMutex)> lock(wsMutex);
+        wsWaitCondition.wait(lock, [this] { return (binaryMessagesReceived[2].size() >= 3); });
+        binaryMessagesReceived[2].clear();
+    }
+
+    // {Type: GetUserNames} is answered with {Type: UserNames, UserNames: ["Bob"]}.
+    ws[2].SendBinary(std::string("\x81\x00\x03", 3));
+    EXPECT_EQ((std::vector<std::string>{std::string("\x82\x00\x04\x0b\x91\xa3"
+                                                    "Bob",
+                                                    9)}),
+              binaryMessagesReceived[2]);
+    EXPECT_TRUE(messagesReceived[2].empty());
+    binaryMessagesReceived[2].clear();
+
+    // {Type: PostChat, Chat: "Hi", Time: "1"} is answered with
+    // {Type: PostChatResult, Seq: 1, Sender: "Bob", Chat: "Hi", Time: "1"}.
+    ws[2].SendBinary(std::string("\x83\x00\x05\x04\xa2"
+                                 "Hi"
+                                 "\x05\xa1"
+                                 "1",
+                                 10));
+    EXPECT_EQ((std::vector<std::string>{std::string("\x85\x00\x06\x06\x01\x07\xa3"
+                                                    "Bob"
+                                                    "\x04\xa2"
+                                                    "Hi"
+                                                    "\x05\xa1"
+                                                    "1",
+                                                    17)}),
+              binaryMessagesReceived[2]);
+    binaryMessagesReceived[2].clear();
+
+    // Chats which aren't valid UTF-8 are turned down, since they couldn't
+    // be passed on to users taking JSON in WebSocket text frames.
+    ws[2].SendBinary(std::string("\x82\x00\x05\x04\xa2"
+                                 "\xc3\x28",
+                                 7));
+    EXPECT_TRUE(binaryMessagesReceived[2].empty());
+    ws[2].SendBinary(std::string("\x83\x00\x05\x04\xa2"
+                                 "Yo"
+                                 "\x05\xa1"
+                                 "2",
+                                 10));
+    EXPECT_EQ((std::vector<std::string>{std::string("\x85\x00\x06\x06\x02\x07\xa3"
+                                                    "Bob"
+                                                    "\x04\xa2"
+                                                    "Yo"
+                                                    "\x05\xa1"
+                                                    "2",
+                                                    17)}),
+              binaryMessagesReceived[2]);
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_EscapeChatsInJson_Test) {
+    const std::string chat = "Say \"hi\"\\\n\tnow\x01";
+    ws[0].SendText(
+        Json::Object({{"Type", "PostChat"}, {"Chat", chat}, {"Time", "1"}}).ToEncoding());
+    EXPECT_EQ((std::vector<Json::Value>{Json::Object({{"Type", "PostChatResult"},
+                                                      {"Seq", 1},
+                                                      {"Sender", ""},
+                                                      {"Chat", chat},
+                                                      {"Time", "1"}})}),
+              messagesReceived[1]);
+}
+
+TEST_F(ChatRoomPluginTests, ChatRoomPluginTests_HoldBackMessagesFromUserNotReading_Test) {
+    TearDown();
+    outboundWindowBytes = 256;
+    outboundQueueLimit = 4;
+    slowConsumerPolicy = "disconnect";
+    SetUp();
+
+    // The second client stops reading: nothing more reaches it,
+    // so it doesn't answer pings either.
+    size_t bytesHeld = 0;
+    serverConnection[1]->sendDataDelegate = [this, &bytesHeld](const std::vector<uint8_t>& data)
+    {
+        std::lock_guard<decltype(wsMutex)> lock(wsMutex);
+        bytesHeld += data.size();
+    };
+
+    // The chat room keeps posting chats to the other clients, while it only
+    // hands the second one what fits in its window, and disconnects it once
+    // its queue overflows.
+    const std::string chat(100, 'x');
+    for (size_t i = 0; i < 100; ++i)
+    { ws[0].SendText(Json::Object({{"Type", "PostChat"}, {"Chat", chat}}).ToEncoding()); }
+    EXPECT_EQ(100, messagesReceived[0].size());
+    EXPECT_EQ(100, messagesReceived[2].size());
+    {
+        std::lock_guard<decltype(wsMutex)> lock(wsMutex);
+        EXPECT_LT(bytesHeld, outboundWindowBytes + 2 * (chat.length() + 100));
+    }
+    EXPECT_TRUE(std::any_of(diagnosticMessages.begin(), diagnosticMessages.end(),
+                            [](const std::string& message)
+                            {
+                                return ((message.find(" Session #2[") == 0)
+                                        && (message.find("too slow") != std::string::npos));
+                            }));
+    TearDown();
+    outboundWindowBytes = 0;
+    outboundQueueLimit = 0;
+    slowConsumerPolicy.clear();
+    SetUp();
+}
\ No newline at end of file
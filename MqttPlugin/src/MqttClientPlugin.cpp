@@ -12,13 +12,21 @@
 #include <MqttNetworkTransport/MqttClientNetworkTransport.hpp>
 #include <MqttV5/MqttClient.hpp>
 #include <WebSocket/WebSocket.hpp>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <thread>
 #include <queue>
 #include <mutex>
 #include <map>
+#include <set>
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include "OutboundQueue.hpp"
 #include "TimeKeeper.hpp"
+#include "TopicFilterTrie.hpp"
+#include "TopicRouter.hpp"
 
 namespace
 {
@@ -29,43 +37,37 @@ namespace
     constexpr unsigned int WORKER_POLLING_PERIOD_MILLISECONDS = 50;
 
     constexpr unsigned int PING_POLLING_PERIOD_MILLISECONDS = 50000;
+
     /**
-     *
+     * This is the maximum number of topic filters to put
+     * in a single SUBSCRIBE or UNSUBSCRIBE packet.
      */
-    bool topicMatchesfilter(const std::string& filter, const std::string& topic) {
-        auto f = StringUtils::Split(filter, "/");
-        auto t = StringUtils::Split(topic, "/");
-        size_t fi = 0;
-        size_t ti = 0;
+    constexpr size_t MAX_TOPICS_PER_PACKET = 64;
 
-        while (fi < f.size() && ti < t.size())
-        {
-            const auto& fl = f[fi];
-            if (fl == "#")
-            {
-                return fi + 1 == f.size();
-            } else if (fl == "+")
-            {
-                ++fi;
-                ++ti;
-            } else
-            {
-                if (fl != t[ti])
-                    return false;
-                ++fi;
-                ++ti;
-            }
-        }
+    /**
+     * This is the default maximum number of messages to hold
+     * for a mqttPoint while it's slow to take them.
+     */
+    constexpr size_t DEFAULT_OUTBOUND_QUEUE_LIMIT = 256;
 
-        if (ti == t.size())
-        {
-            if (fi == f.size())
-            { return true; }
-            if (fi + 1 == f.size() && f[fi] == "#")
-            { return true; }
-        }
-        return false;
-    }
+    /**
+     * This is the default maximum number of bytes the messages held
+     * for a mqttPoint while it's slow to take them may add up to.
+     */
+    constexpr size_t DEFAULT_OUTBOUND_QUEUE_BYTES = 1 << 20;
+
+    /**
+     * This is the default maximum number of bytes handed to the WebSocket
+     * of a mqttPoint which the mqttPoint hasn't acknowledged receiving,
+     * by answering a ping sent after them.
+     */
+    constexpr size_t DEFAULT_OUTBOUND_WINDOW_BYTES = 1 << 16;
+
+    /**
+     * This is the WebSocket close code (policy violation) sent to
+     * a mqttPoint disconnected for being too slow to take messages.
+     */
+    constexpr unsigned int SLOW_CONSUMER_CLOSE_CODE = 1008;
 
     /**
      * This is a registred user of the chat room
@@ -96,6 +98,122 @@ namespace
         MqttV5::RetainHandling retainHandling;
         bool withAutoFeadBack;
         bool retainAsPublished;
+        OutboundQueue::SlowConsumerPolicy policy = OutboundQueue::SlowConsumerPolicy::DropOldest;
+    };
+
+    /**
+     * This holds the topic filters of a SUBSCRIBE or UNSUBSCRIBE packet,
+     * linked in the order they were added.
+     *
+     * @note
+     *      The topic filters are unlinked before being destroyed,
+     *      so that each is destroyed exactly once.
+     */
+    template <typename Topic> struct TopicList
+    {
+        /**
+         * These are the topic filters, in the order they were added.
+         */
+        std::vector<std::unique_ptr<Topic>> topics;
+
+        ~TopicList() noexcept {
+            for (const auto& topic : topics)
+            { topic->next = nullptr; }
+        }
+
+        /**
+         * This method adds the given topic filter to the end of the list.
+         *
+         * @param[in] topic
+         *      This is the topic filter to add.
+         */
+        void Add(std::unique_ptr<Topic> topic) {
+            if (!topics.empty())
+            { topics.back()->next = topic.get(); }
+            topics.push_back(std::move(topic));
+        }
+
+        /**
+         * This method returns the first topic filter of the list.
+         *
+         * @return
+         *      The first topic filter of the list is returned,
+         *      or nullptr if the list is empty.
+         */
+        Topic* Head() const { return (topics.empty() ? nullptr : topics.front().get()); }
+    };
+
+    /**
+     * This is a SUBSCRIBE or UNSUBSCRIBE packet waiting
+     * to be sent to the broker.
+     */
+    struct BrokerPacket
+    {
+        /**
+         * This indicates whether the packet subscribes or unsubscribes.
+         */
+        CommandeType type;
+
+        /**
+         * These are the commands whose topic filters to subscribe to,
+         * if the packet subscribes.
+         */
+        std::vector<EndPointCommande> commands;
+
+        /**
+         * These are the topic filters from which to unsubscribe,
+         * if the packet unsubscribes.
+         */
+        std::vector<std::string> topics;
+
+        /**
+         * This indicates whether or not the packet is sent again because
+         * the reason codes the broker gave for it were lost, in which
+         * case it isn't sent a third time.
+         */
+        bool retry = false;
+    };
+
+    /**
+     * This is the type of function called by the worker thread, with the
+     * mutex of the broker held, once a transaction with the broker
+     * completes or times out.
+     *
+     * @param[in] state
+     *      This is the state in which the transaction ended.
+     *
+     * @param[in] reasons
+     *      These are the reason codes the broker gave, if any.
+     */
+    typedef std::function<void(MqttV5::IMqttV5Client::Transaction::State state,
+                               const std::vector<MqttV5::ReasonCode>& reasons)>
+        TransactionCompletion;
+
+    /**
+     * This is a transaction with the broker which hasn't completed yet.
+     */
+    struct InFlightTransaction
+    {
+        /**
+         * This is the transaction, kept until it completes.
+         */
+        std::shared_ptr<MqttV5::IMqttV5Client::Transaction> transaction;
+
+        /**
+         * This is the number of the connection to the broker
+         * on which the transaction was started.
+         */
+        size_t connection = 0;
+
+        /**
+         * This is the time after which to give up on the transaction.
+         */
+        std::chrono::steady_clock::time_point deadline;
+
+        /**
+         * This is the function to call once the transaction completes.
+         */
+        TransactionCompletion onCompletion;
     };
 
     struct BrockerConfig
@@ -114,9 +232,61 @@ namespace
         std::string willPayload;
         MqttV5::QoSDelivery qos = MqttV5::AtLeastOne;
         uint16_t keepAlive = 10U;
+        size_t maxInFlight = 16;
         MqttV5::Properties* props = nullptr;
+        std::string name = "broker";
+        size_t connections = 1;
     };
 
+    /**
+     * This reads the configuration items of a broker found
+     * in the given configuration, leaving the others as they were.
+     *
+     * @param[in] configuration
+     *      This holds the configuration items of the broker.
+     *
+     * @param[in, out] mqttConfiguration
+     *      This is where to store the configuration items found.
+     */
+    void ReadBrokerConfig(const Json::Value& configuration, BrockerConfig& mqttConfiguration) {
+        if (configuration.Has("Name"))
+        { mqttConfiguration.name = (std::string)configuration["Name"]; }
+        if (configuration.Has("Connections"))
+        { mqttConfiguration.connections = (size_t)(int)configuration["Connections"]; }
+        if (configuration.Has("Host"))
+        { mqttConfiguration.host = (std::string)configuration["Host"]; }
+        if (configuration.Has("Port"))
+        { mqttConfiguration.port = (uint16_t)(int)configuration["Port"]; }
+        if (configuration.Has("UserName"))
+        { mqttConfiguration.userName = (std::string)configuration["UserName"]; }
+        if (configuration.Has("Password"))
+        { mqttConfiguration.password = (std::string)configuration["Password"]; }
+        if (configuration.Has("Client-Id"))
+        { mqttConfiguration.clientId = (std::string)configuration["Client-Id"]; }
+        if (configuration.Has("Clean-Session"))
+        { mqttConfiguration.cleanSession = (bool)configuration["Clean-Session"]; }
+        if (configuration.Has("Reconnect-Period"))
+        {
+            mqttConfiguration.reconnectPeriod = (uint16_t)(int)configuration["Reconnect-Period"];
+        }
+        if (configuration.Has("Connect-Timeout"))
+        { mqttConfiguration.connectTimeOut = (uint16_t)(int)configuration["Connect-Timeout"]; }
+        if (configuration.Has("KeepAlive"))
+        { mqttConfiguration.keepAlive = (uint16_t)(int)configuration["KeepAlive"]; }
+        if (configuration.Has("Will-Topic"))
+        { mqttConfiguration.willTopic = (bool)configuration["Will-Topic"]; }
+        if (configuration.Has("Will-Retain"))
+        { mqttConfiguration.willRetain = (bool)configuration["Will-Retain"]; }
+        if (configuration.Has("Will-Payload"))
+        { mqttConfiguration.willPayload = (std::string)configuration["Will-Payload"]; }
+        if (configuration.Has("QoS"))
+        { mqttConfiguration.qos = (MqttV5::QoSDelivery)(int)configuration["QoS"]; }
+        if (configuration.Has("Max-In-Flight"))
+        { mqttConfiguration.maxInFlight = (size_t)(int)configuration["Max-In-Flight"]; }
+        if (mqttConfiguration.maxInFlight == 0)
+        { mqttConfiguration.maxInFlight = 1; }
+    }
+
     struct MqttPoint;
 
     struct WsAppReceiver;
@@ -149,9 +319,28 @@ namespace
         std::vector<std::string> topics;
         /**
          * This indicate whether or not the device is connected to the broker.
+         * It's atomic since the thread receiving messages from the broker
+         * reads it without taking the mutex of the broker.
+         */
+        std::atomic<bool> connected{true};
+
+        /**
+         * These are the messages received from the broker
+         * waiting to be sent to the mqttPoint.
+         */
+        std::unique_ptr<OutboundQueue> outbox;
+
+        /**
+         * This indicates whether or not the mqttPoint is already
+         * waiting for the sender thread to flush its messages.
          */
+        std::atomic<bool> flushPending{false};
 
-        bool connected = true;
+        /**
+         * These are the policies of the subscriptions of the mqttPoint,
+         * including those the client is still making, keyed by topic filter.
+         */
+        std::map<std::string, OutboundQueue::SlowConsumerPolicy> policies;
 
         /**
          * These are the diagnostic sender name of the user.
@@ -165,6 +354,55 @@ namespace
         SystemUtils::DiagnosticsSender::UnsubscribeDelegate wsDiagnosticsUnsubscribeDelegate;
     };
 
+    /**
+     * These are the subscriptions of the mqttPoints to the topic filters
+     * the router assigns to one of the connections to the brokers.
+     */
+    struct ConnectionSubscriptions
+    {
+        /**
+         * These are the topic filters to which the mqttPoints are subscribed.
+         */
+        TopicFilterTrie subscriptions;
+
+        /**
+         * These are the subscriptions whose messages are conflated
+         * when the mqttPoint is slow to take them.
+         */
+        TopicFilterTrie conflatingSubscriptions;
+
+        /**
+         * These are the subscriptions whose mqttPoint is disconnected
+         * when it's too slow to take their messages.
+         */
+        TopicFilterTrie disconnectingSubscriptions;
+    };
+
+    /**
+     * This is what the threads receiving messages from the brokers need to
+     * route them to the mqttPoints subscribed to them. Once published, it's
+     * never changed; changes to the subscriptions are made to a copy,
+     * which then replaces it.
+     */
+    struct RoutingTable
+    {
+        /**
+         * These are the subscriptions assigned to each connection to the
+         * brokers, indexed by the number of the connection. The messages
+         * received on a connection are only matched against its own
+         * subscriptions, since the router may assign overlapping topic
+         * filters to different connections, and the brokers then send
+         * the messages matching both on each of them.
+         */
+        std::vector<ConnectionSubscriptions> connections;
+
+        /**
+         * These are the mqttPoints subscribed to any topic filter,
+         * keyed by session Id.
+         */
+        std::map<unsigned int, std::shared_ptr<MqttPoint>> mqttPoints;
+    };
+
     /**
      *
      */
@@ -173,6 +411,27 @@ namespace
         // pointeur sur le broker
         Broker* broker = nullptr;
 
+        /**
+         * This is the number of the connection to the broker
+         * whose messages are received.
+         */
+        size_t connection = 0;
+
+        /**
+         * This is where the session IDs of the mqttPoints subscribed to
+         * each message received are stored, kept from one message
+         * to the next so that routing a message doesn't allocate.
+         */
+        std::vector<unsigned int> matchingSessionIds;
+
+        /**
+         * These are where the session IDs of the mqttPoints subscribed
+         * to each message received with a policy of conflating messages,
+         * or disconnecting, are stored, kept for the same reason.
+         */
+        std::vector<unsigned int> conflatingSessionIds;
+        std::vector<unsigned int> disconnectingSessionIds;
+
         void onMessageReceived(const MqttV5::Storage::DynamicStringView topic,
                                MqttV5::Storage::DynamicBinaryDataView payload,
                                uint16_t packetId) override;
@@ -183,6 +442,72 @@ namespace
         uint32_t maxUnAckedPackets() const override { return 16u; }
     };
 
+    /**
+     * This is one of the connections to the brokers. Each has its own
+     * client, and so its own thread receiving messages from the broker.
+     */
+    struct BrokerConnection
+    {
+        /**
+         * This is the configuration of the broker, with the client ID
+         * made unique to the connection.
+         */
+        BrockerConfig mqttConfiguration;
+
+        /**
+         * This is the client connection to the broker
+         */
+        std::shared_ptr<MqttV5::MqttClient> mqttClient;
+
+        /**
+         * This is the Mqtt Network transport layer.
+         */
+        std::shared_ptr<MqttNetworkTransport::MqttClientNetworkTransport> mqttTransport;
+
+        /**
+         * This receives the messages the broker sends on the connection.
+         */
+        WsAppReceiver appReceiver;
+
+        /**
+         * This indicate whether or not the mqttClient is connected to the broker.
+         */
+        bool mqttConnected = false;
+
+        /**
+         * This indicates whether or not the client needs to connect to the broker.
+         */
+        bool initialConnectPending = true;
+
+        /**
+         * This indicates whether or not the client is connecting to the broker.
+         */
+        bool connectInFlight = false;
+
+        /**
+         * This indicates whether or not the client needs to ping the broker.
+         */
+        bool pingPending = false;
+
+        /**
+         * This indicates whether or not the client is waiting
+         * for the broker to answer a ping.
+         */
+        bool pingInFlight = false;
+
+        /**
+         * This is the number of transactions started on the connection
+         * which haven't completed yet.
+         */
+        size_t transactionsInFlight = 0;
+
+        /**
+         * These are the SUBSCRIBE and UNSUBSCRIBE packets waiting
+         * for a transaction slot to be sent to the broker.
+         */
+        std::queue<BrokerPacket> pendingPackets;
+    };
+
     /**
      *
      */
@@ -209,15 +534,59 @@ namespace
          * stop working.
          */
         bool stopWorker = false;
+
         /**
-         *
+         * This is used to notify the sender thread
+         * that mqttPoints have messages to flush.
          */
-        bool brokerConfigLoaded = false;
+        std::condition_variable senderWakeCondition;
+
         /**
-         *
+         * This synchronizes access to the mqttPoints to flush, apart from
+         * the mutex, so that scheduling a flush never waits on it.
+         */
+        std::mutex senderMutex;
+
+        /**
+         * This sends the messages received from the broker to the
+         * mqttPoints, so that the threads receiving them never wait
+         * on a slow mqttPoint.
+         */
+        std::thread senderThread;
+
+        /**
+         * These are the mqttPoints with messages to flush.
+         */
+        std::vector<std::shared_ptr<MqttPoint>> pointsToFlush;
+
+        /**
+         * This indicates whether or not the sender thread should stop.
          */
-        bool initialConnectPending = false;
+        bool stopSender = false;
 
+        /**
+         * This is the maximum number of messages to hold
+         * for a mqttPoint while it's slow to take them.
+         */
+        size_t outboundQueueLimit = DEFAULT_OUTBOUND_QUEUE_LIMIT;
+
+        /**
+         * This is the maximum number of bytes the messages held
+         * for a mqttPoint while it's slow to take them may add up to.
+         */
+        size_t outboundQueueBytes = DEFAULT_OUTBOUND_QUEUE_BYTES;
+
+        /**
+         * This is the maximum number of bytes handed to the WebSocket
+         * of a mqttPoint which it hasn't acknowledged receiving yet.
+         * Past it, messages wait in the queue of the mqttPoint, under
+         * its limits, rather than in the buffers of the WebSocket.
+         */
+        size_t outboundWindowBytes = DEFAULT_OUTBOUND_WINDOW_BYTES;
+        /**
+         *
+         */
+        bool brokerConfigLoaded = false;
         /**
          * This indicates whether a device have to close the ws.
          */
@@ -243,39 +612,96 @@ namespace
          */
         bool ping = false;
 
+        /**
+         * These are the transactions started with the broker which haven't
+         * completed yet, keyed by the identifiers given to them when started.
+         * No more than the Max-In-Flight configuration item of a broker
+         * are started at a time on each of its connections.
+         */
+        std::map<unsigned int, InFlightTransaction> transactionsInFlight;
+
+        /**
+         * These are the identifiers of the transactions the broker
+         * completed, along with the reason codes it gave, waiting
+         * to be handed over by the worker thread.
+         */
+        std::queue<std::pair<unsigned int, std::vector<MqttV5::ReasonCode>>>
+            completedTransactions;
+
+        /**
+         * This is the identifier to give to the next transaction started.
+         */
+        unsigned int nextTransactionId = 1;
+
         /**
          * This is the broker configurations loaded when the plugin start.
          */
         BrockerConfig mqttConfiguration;
+
+        /**
+         * These are the connections to the brokers, numbered
+         * as they are by the router.
+         */
+        std::vector<std::unique_ptr<BrokerConnection>> connections;
+
+        /**
+         * This picks the connection which subscribes to each topic filter.
+         */
+        TopicRouter router;
+
         /**
          *
          */
         std::queue<EndPointCommande> pendingCommandes;
         /**
-         * This is the client connection to the broker
+         * These are the mqttPoints currently connected to the server,
+         * keyed by session Id.
          */
-        std::shared_ptr<MqttV5::MqttClient> mqttClient;
+        std::map<unsigned int, std::shared_ptr<MqttPoint>> mqttPoints;
 
         /**
-         *
+         * These are the subscriptions of the mqttPoints, used to route the
+         * messages received from the brokers, kept for each connection
+         * to the brokers apart, indexed by the number of the connection.
          */
-        WsAppReceiver appReceiver;
+        std::vector<ConnectionSubscriptions> subscriptions;
 
         /**
-         * This indicate whether or not the mqttClient is connected to the broker.
+         * This is the routing table last published for the thread receiving
+         * messages from the broker. It's only read and replaced through
+         * std::atomic_load and std::atomic_store, so that routing messages
+         * never waits on the mutex, and changing subscriptions never waits
+         * on messages being routed.
          */
-        bool mqttConnected = false;
+        std::shared_ptr<const RoutingTable> routingTable = std::make_shared<const RoutingTable>();
 
         /**
-         * This is the Mqtt Network transport layer.
+         * This indicates whether or not the subscriptions changed since
+         * the routing table was last published.
          */
-        std::shared_ptr<MqttNetworkTransport::MqttClientNetworkTransport> mqttTransport;
+        bool routingTableDirty = false;
 
         /**
-         * These are the mqttPoints currently connected to the server,
-         * keyed by session Id.
+         * These are the sessions of the mqttPoints subscribed to each topic
+         * filter to which the broker acknowledged subscribing the client.
+         * The broker is only asked to subscribe to a topic filter for its
+         * first subscriber, and to unsubscribe from it once its last
+         * subscriber leaves.
          */
-        std::map<unsigned int, std::shared_ptr<MqttPoint>> mqttPoints;
+        std::map<std::string, std::set<unsigned int>> filterSubscribers;
+
+        /**
+         * These are the commands with which the client subscribed at the
+         * broker to each topic filter in filterSubscribers, kept in order
+         * to subscribe to it again once its connection is made again.
+         */
+        std::map<std::string, EndPointCommande> filterCommands;
+
+        /**
+         * These are the sessions of the mqttPoints waiting for the broker
+         * to acknowledge subscribing the client to each topic filter.
+         */
+        std::map<std::string, std::vector<unsigned int>> pendingSubscribers;
 
         /**
          * This is the next session id that my be assigned to a new
@@ -299,49 +725,107 @@ namespace
             if (workerThread.joinable())
             { return; }
 
-            if (configuration.Has("Host"))
-            { mqttConfiguration.host = (std::string)configuration["Host"]; }
-            if (configuration.Has("Port"))
-            { mqttConfiguration.port = (uint16_t)(int)configuration["Port"]; }
-            if (configuration.Has("UserName"))
-            { mqttConfiguration.userName = (std::string)configuration["UserName"]; }
-            if (configuration.Has("Password"))
-            { mqttConfiguration.password = (std::string)configuration["Password"]; }
-            if (configuration.Has("Client-Id"))
-            { mqttConfiguration.clientId = (std::string)configuration["Client-Id"]; }
-            if (configuration.Has("Clean-Session"))
-            { mqttConfiguration.cleanSession = (bool)configuration["Clean-Session"]; }
-            if (configuration.Has("Reconnect-Period"))
-            {
-                mqttConfiguration.reconnectPeriod =
-                    (uint16_t)(int)configuration["Reconnect-Period"];
-            }
-            if (configuration.Has("Connect-Timeout"))
-            { mqttConfiguration.connectTimeOut = (uint16_t)(int)configuration["Connect-Timeout"]; }
-            if (configuration.Has("KeepAlive"))
-            { mqttConfiguration.keepAlive = (uint16_t)(int)configuration["KeepAlive"]; }
-            if (configuration.Has("Will-Topic"))
-            { mqttConfiguration.willTopic = (bool)configuration["Will-Topic"]; }
-            if (configuration.Has("Will-Retain"))
-            { mqttConfiguration.willRetain = (bool)configuration["Will-Retain"]; }
-            if (configuration.Has("Will-Payload"))
-            { mqttConfiguration.willPayload = (std::string)configuration["Will-Payload"]; }
-            if (configuration.Has("QoS"))
-            { mqttConfiguration.qos = (MqttV5::QoSDelivery)(int)configuration["QoS"]; }
-
-            appReceiver.broker = this;
+            ReadBrokerConfig(configuration, mqttConfiguration);
+            if (configuration.Has("Brokers"))
+            {
+                const auto& brokers = configuration["Brokers"];
+                for (size_t i = 0; i < brokers.GetSize(); ++i)
+                {
+                    auto brokerConfiguration = mqttConfiguration;
+                    brokerConfiguration.name = StringUtils::sprintf("broker%zu", i + 1);
+                    brokerConfiguration.connections = 1;
+                    ReadBrokerConfig(brokers[i], brokerConfiguration);
+                    AddBroker(brokerConfiguration);
+                }
+            } else
+            { AddBroker(mqttConfiguration); }
+            if (configuration.Has("Routes"))
+            {
+                const auto& routes = configuration["Routes"];
+                for (size_t i = 0; i < routes.GetSize(); ++i)
+                {
+                    const std::string prefix = routes[i]["Prefix"];
+                    const std::string brokerName = routes[i]["Broker"];
+                    if (!router.AddRoute(prefix, brokerName))
+                    {
+                        diagnosticsMessageDelegate(
+                            "MqttClientPlugin", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                            StringUtils::sprintf("no broker '%s' to route '%s' to",
+                                                 brokerName.c_str(), prefix.c_str()));
+                    }
+                }
+            }
+
+            if (configuration.Has("Outbound-Queue-Limit"))
+            { outboundQueueLimit = (size_t)(int)configuration["Outbound-Queue-Limit"]; }
+            if (configuration.Has("Outbound-Queue-Bytes"))
+            { outboundQueueBytes = (size_t)(int)configuration["Outbound-Queue-Bytes"]; }
+            if (configuration.Has("Outbound-Window-Bytes"))
+            { outboundWindowBytes = (size_t)(int)configuration["Outbound-Window-Bytes"]; }
+
             brokerConfigLoaded = true;
-            initialConnectPending = true;
             stopWorker = false;
+            stopSender = false;
 
             workerThread = std::thread(&Broker::Worker, this);
+            senderThread = std::thread(&Broker::Sender, this);
         }
 
         /**
-         * This is called when the ws-gateway is disconnected frome the web
-         * server in order to cleanly shut it down.
+         * This method adds the connections to the given broker.
+         *
+         * @param[in] brokerConfiguration
+         *      This is the configuration of the broker.
          */
-        void Stop() {
+        void AddBroker(const BrockerConfig& brokerConfiguration) {
+            if (!router.AddBroker(brokerConfiguration.name, brokerConfiguration.connections))
+            {
+                diagnosticsMessageDelegate(
+                    "MqttClientPlugin", SystemUtils::DiagnosticsSender::Levels::ERROR,
+                    StringUtils::sprintf("broker '%s' is a duplicate or has no connections",
+                                         brokerConfiguration.name.c_str()));
+                return;
+            }
+            for (size_t i = 0; i < brokerConfiguration.connections; ++i)
+            {
+                std::unique_ptr<BrokerConnection> connection(new BrokerConnection());
+                connection->mqttConfiguration = brokerConfiguration;
+
+                // Brokers only let one connection use each client ID.
+                if (brokerConfiguration.connections > 1)
+                {
+                    connection->mqttConfiguration.clientId +=
+                        StringUtils::sprintf("-%zu", i + 1);
+                }
+                connection->appReceiver.broker = this;
+                connection->appReceiver.connection = connections.size();
+                connections.push_back(std::move(connection));
+                subscriptions.emplace_back();
+            }
+        }
+
+        /**
+         * This method indicates whether or not any connection
+         * to the brokers is established. It's called with the mutex held.
+         *
+         * @return
+         *      An indication of whether or not any connection
+         *      is established is returned.
+         */
+        bool IsAnyConnected() const {
+            for (const auto& connection : connections)
+            {
+                if (connection->mqttConnected)
+                { return true; }
+            }
+            return false;
+        }
+
+        /**
+         * This is called when the ws-gateway is disconnected frome the web
+         * server in order to cleanly shut it down.
+         */
+        void Stop() {
             if (!workerThread.joinable())
             { return; }
             {
@@ -350,6 +834,74 @@ namespace
                 workerWakeCondition.notify_all();
             }
             workerThread.join();
+            {
+                std::lock_guard<decltype(senderMutex)> lock(senderMutex);
+                stopSender = true;
+                senderWakeCondition.notify_all();
+            }
+            senderThread.join();
+        }
+
+        /**
+         * This method has the sender thread flush the messages
+         * of the given mqttPoint, unless it's already going to.
+         * It may be called from any thread, without holding the mutex.
+         *
+         * @param[in] mqttPoint
+         *      This is the mqttPoint whose messages to flush.
+         */
+        void ScheduleFlush(const std::shared_ptr<MqttPoint>& mqttPoint) {
+            if (mqttPoint->flushPending.exchange(true))
+            { return; }
+            std::lock_guard<decltype(senderMutex)> lock(senderMutex);
+            pointsToFlush.push_back(mqttPoint);
+            senderWakeCondition.notify_all();
+        }
+
+        /**
+         * This method is the body of the sender thread, which sends
+         * the messages queued for the mqttPoints, in the order
+         * the mqttPoints were scheduled.
+         */
+        void Sender() {
+            std::vector<std::shared_ptr<MqttPoint>> flushing;
+            std::unique_lock<decltype(senderMutex)> lock(senderMutex);
+            while (!stopSender)
+            {
+                senderWakeCondition.wait(lock,
+                                         [this] { return stopSender || !pointsToFlush.empty(); });
+                flushing.swap(pointsToFlush);
+                lock.unlock();
+                for (const auto& mqttPoint : flushing)
+                {
+                    mqttPoint->flushPending = false;
+                    mqttPoint->outbox->Flush();
+                }
+                flushing.clear();
+                lock.lock();
+            }
+        }
+
+        /**
+         * This method replaces the routing table used by the thread
+         * receiving messages from the broker with a copy of the current
+         * subscriptions, if they changed since it was last published.
+         * It's called with the mutex held, once a batch of changes
+         * to the subscriptions is done.
+         */
+        void PublishRoutingTable() {
+            if (!routingTableDirty)
+            { return; }
+            routingTableDirty = false;
+            auto newRoutingTable = std::make_shared<RoutingTable>();
+            newRoutingTable->connections = subscriptions;
+            for (const auto& mqttPoint : mqttPoints)
+            {
+                if (!mqttPoint.second->topics.empty())
+                { (void)newRoutingTable->mqttPoints.insert(mqttPoint); }
+            }
+            std::atomic_store(&routingTable,
+                              std::shared_ptr<const RoutingTable>(std::move(newRoutingTable)));
         }
 
         void GetEndPointId(std::map<unsigned int, std::shared_ptr<MqttPoint>>::iterator endPoint) {
@@ -367,6 +919,160 @@ namespace
             response.Set("EndPoints", mqttendPoints);
         }
 
+        /**
+         * This method indicates whether or not another transaction
+         * may be started on the given connection, without going over
+         * the limit of transactions in flight. It's called with the mutex held.
+         *
+         * @param[in] connection
+         *      This is the connection on which to start the transaction.
+         *
+         * @return
+         *      An indication of whether or not another transaction
+         *      may be started is returned.
+         */
+        static bool HasTransactionSlot(const BrokerConnection& connection) {
+            return (connection.transactionsInFlight <
+                    connection.mqttConfiguration.maxInFlight);
+        }
+
+        /**
+         * This method indicates whether or not the worker thread
+         * has anything to do. It's called with the mutex held.
+         *
+         * @return
+         *      An indication of whether or not the worker thread
+         *      has anything to do is returned.
+         */
+        bool HasWork() const {
+            if (stopWorker || endPointHaveClosed || !completedTransactions.empty() || ping ||
+                endPointJoinServer)
+            { return true; }
+            if (!pendingCommandes.empty() && !connections.empty())
+            { return true; }
+            for (const auto& connection : connections)
+            {
+                if (connection->initialConnectPending && !connection->connectInFlight)
+                { return true; }
+                if (connection->mqttConnected && HasTransactionSlot(*connection) &&
+                    (!connection->pendingPackets.empty() ||
+                     (connection->pingPending && !connection->pingInFlight)))
+                { return true; }
+            }
+            return false;
+        }
+
+        /**
+         * This method starts a transaction with the broker, without waiting
+         * for it to complete. Once the broker completes it, or it times
+         * out, its result is posted back to the worker thread, which
+         * then calls the given delegate. It's called by the worker thread
+         * with the mutex held, which is released while the transaction
+         * is started.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] connection
+         *      This is the number of the connection
+         *      on which to start the transaction.
+         *
+         * @param[in] issue
+         *      This is the function to call to start the transaction.
+         *
+         * @param[in] onCompletion
+         *      This is the function to call, with the mutex held,
+         *      once the transaction completes.
+         *
+         * @return
+         *      An indication of whether or not the transaction
+         *      was started is returned.
+         */
+        bool StartTransaction(
+            std::unique_lock<std::mutex>& lock, size_t connection,
+            const std::function<std::shared_ptr<MqttV5::IMqttV5Client::Transaction>()>& issue,
+            TransactionCompletion onCompletion) {
+            const auto id = nextTransactionId++;
+            const auto posted = std::make_shared<bool>(false);
+            lock.unlock();
+            const auto transaction = issue();
+            if (transaction)
+            {
+                transaction->SetCompletionDelegate(
+                    [this, id, posted](std::vector<MqttV5::ReasonCode>& reasons)
+                    {
+                        std::lock_guard<std::mutex> g(mutex);
+                        if (*posted)
+                        { return; }
+                        *posted = true;
+                        completedTransactions.emplace(id, reasons);
+                        workerWakeCondition.notify_all();
+                    });
+            }
+            lock.lock();
+            if (!transaction)
+            { return false; }
+            auto& inFlight = transactionsInFlight[id];
+            inFlight.transaction = transaction;
+            inFlight.connection = connection;
+            inFlight.deadline =
+                std::chrono::steady_clock::now() +
+                std::chrono::seconds(connections[connection]->mqttConfiguration.connectTimeOut);
+            ++connections[connection]->transactionsInFlight;
+            inFlight.onCompletion = std::move(onCompletion);
+
+            // The broker may have answered before the delegate was set,
+            // in which case the delegate is never called and the reason
+            // codes are lost; the completion is handed no reason codes.
+            if (!*posted && transaction->AwaitCompletion(std::chrono::milliseconds(0)))
+            {
+                *posted = true;
+                completedTransactions.emplace(id, std::vector<MqttV5::ReasonCode>());
+            }
+            return true;
+        }
+
+        /**
+         * This method hands the results of the transactions which completed
+         * to the delegates waiting for them, and gives up on the
+         * transactions the broker didn't complete in time.
+         * It's called by the worker thread with the mutex held.
+         */
+        void CompleteTransactions() {
+            while (!completedTransactions.empty())
+            {
+                const auto result = std::move(completedTransactions.front());
+                completedTransactions.pop();
+                const auto inFlight = transactionsInFlight.find(result.first);
+                if (inFlight == transactionsInFlight.end())
+                { continue; }
+                const auto state = inFlight->second.transaction->transactionState;
+                const auto onCompletion = std::move(inFlight->second.onCompletion);
+                --connections[inFlight->second.connection]->transactionsInFlight;
+                (void)transactionsInFlight.erase(inFlight);
+                onCompletion(state, result.second);
+            }
+            const auto now = std::chrono::steady_clock::now();
+            for (auto inFlight = transactionsInFlight.begin();
+                 inFlight != transactionsInFlight.end();)
+            {
+                if (now < inFlight->second.deadline)
+                {
+                    ++inFlight;
+                    continue;
+                }
+                const auto onCompletion = std::move(inFlight->second.onCompletion);
+                --connections[inFlight->second.connection]->transactionsInFlight;
+                inFlight = transactionsInFlight.erase(inFlight);
+                diagnosticsMessageDelegate("MqttClientPlugin",
+                                           SystemUtils::DiagnosticsSender::Levels::WARNING,
+                                           "transaction with the broker timed out");
+                onCompletion(MqttV5::IMqttV5Client::Transaction::State::Timeout,
+                             std::vector<MqttV5::ReasonCode>());
+            }
+            PublishRoutingTable();
+        }
+
         void Worker() {
             std::unique_lock<decltype(mutex)> lock(mutex);
             int pingPollingPeriod = PING_POLLING_PERIOD_MILLISECONDS;
@@ -380,49 +1086,45 @@ namespace
                         pingPollingPeriod -= WORKER_POLLING_PERIOD_MILLISECONDS;
                         if (pingPollingPeriod < 0)
                         { ping = true; }
-                        return stopWorker || endPointHaveClosed || initialConnectPending ||
-                               !pendingCommandes.empty() || ping || endPointJoinServer;
+                        return HasWork();
                     });
                 if (stopWorker)
                 {
-                    if (mqttConnected && mqttClient)
-                    { mqttClient->Demobilize(); }
+                    for (const auto& connection : connections)
+                    {
+                        if (connection->mqttConnected && connection->mqttClient)
+                        { connection->mqttClient->Demobilize(); }
+                    }
                     break;
                 }
 
-                if (mqttConnected && (ping || endPointJoinServer))
+                // 1) Hand over the results of transactions with the broker
+                CompleteTransactions();
+
+                if (ping || endPointJoinServer)
                 {
                     ping = false;
                     if (endPointJoinServer)
                     { endPointJoinServer = false; }
                     pingPollingPeriod = PING_POLLING_PERIOD_MILLISECONDS;
-                    lock.unlock();
-                    Ping();
-                    lock.lock();
-                }
-
-                if (initialConnectPending && brokerConfigLoaded && !mqttConnected)
-                {
-                    initialConnectPending = false;
-                    lock.unlock();
-                    DoInitialConnect();
-                    lock.lock();
+                    for (const auto& connection : connections)
+                    { connection->pingPending = connection->mqttConnected; }
                 }
 
                 // 3) Handles SUB/UNSUB Transaction
-                if (!pendingCommandes.empty() && mqttConnected && mqttClient)
+                if (!pendingCommandes.empty() && !connections.empty())
                 {
-                    EndPointCommande cmd = pendingCommandes.front();
-                    pendingCommandes.pop();
-                    lock.unlock();
-                    if (cmd.type == CommandeType::Subscribe)
+                    std::vector<EndPointCommande> commands;
+                    commands.reserve(pendingCommandes.size());
+                    while (!pendingCommandes.empty())
                     {
-                        HandleSubscribeCommand(cmd);
-                    } else if (cmd.type == CommandeType::Unsubscribe)
-                    { HandleUnSubscribeCommand(cmd); }
-
-                    lock.lock();
+                        commands.push_back(std::move(pendingCommandes.front()));
+                        pendingCommandes.pop();
+                    }
+                    PrepareCommands(commands);
                 }
+                for (size_t i = 0; i < connections.size(); ++i)
+                { ServiceConnection(lock, i); }
 
                 if (endPointHaveClosed)
                 {
@@ -448,24 +1150,73 @@ namespace
             }
         }
 
-        void DoInitialConnect() {
+        /**
+         * This method connects the given connection to its broker, pings
+         * the broker, and sends it the packets waiting to be sent,
+         * as needed. It's called by the worker thread with the mutex held.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] i
+         *      This is the number of the connection.
+         */
+        void ServiceConnection(std::unique_lock<std::mutex>& lock, size_t i) {
+            auto& connection = *connections[i];
+            if (connection.initialConnectPending && brokerConfigLoaded &&
+                !connection.mqttConnected && !connection.connectInFlight)
+            {
+                connection.initialConnectPending = false;
+                DoInitialConnect(lock, i);
+            }
+
+            if (connection.mqttConnected && connection.pingPending && !connection.pingInFlight &&
+                HasTransactionSlot(connection))
+            {
+                connection.pingPending = false;
+                Ping(lock, i);
+            }
+
+            while (connection.mqttConnected && !connection.pendingPackets.empty() &&
+                   HasTransactionSlot(connection))
+            {
+                const auto packet = std::move(connection.pendingPackets.front());
+                connection.pendingPackets.pop();
+                SendPacket(lock, i, packet);
+            }
+        }
+
+        /**
+         * This method starts connecting the given connection to its broker.
+         * It's called by the worker thread with the mutex held.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] i
+         *      This is the number of the connection.
+         */
+        void DoInitialConnect(std::unique_lock<std::mutex>& lock, size_t i) {
+            auto& connection = *connections[i];
+            const auto& mqttConfiguration = connection.mqttConfiguration;
             // Creation du clien si necessaire
-            if (!mqttClient)
+            if (!connection.mqttClient)
             {
-                mqttTransport =
+                connection.mqttTransport =
                     std::make_shared<MqttNetworkTransport::MqttClientNetworkTransport>();
                 // mqttTransport->SubscribeTodiagnostics(diagnosticsMessageDelegate);
                 auto timeKeeper = std::make_shared<TimeKeeper>();
                 std::unique_ptr<MqttV5::Storage::PacketStore> store(nullptr);
 
-                mqttClient = std::make_shared<MqttV5::MqttClient>(
-                    mqttConfiguration.clientId.c_str(), &appReceiver, nullptr, store.get());
+                connection.mqttClient = std::make_shared<MqttV5::MqttClient>(
+                    mqttConfiguration.clientId.c_str(), &connection.appReceiver, nullptr,
+                    store.get());
                 MqttV5::MqttClient::MqttMobilizationDependencies deps;
-                deps.transport = mqttTransport;
+                deps.transport = connection.mqttTransport;
                 deps.timeKeeper = timeKeeper;
                 deps.requestTimeoutSeconds = mqttConfiguration.connectTimeOut;
                 deps.inactivityInterval = mqttConfiguration.reconnectPeriod;
-                mqttClient->Mobilize(deps);
+                connection.mqttClient->Mobilize(deps);
             }
 
             std::string userName;
@@ -491,42 +1242,104 @@ namespace
             willMsg.payload = will;
             mqttConfiguration.props->initialize();
 
-            auto transaction = mqttClient->ConnectTo(
-                "broker.test", mqttConfiguration.host, mqttConfiguration.port,
-                mqttConfiguration.useTLS, mqttConfiguration.cleanSession,
-                mqttConfiguration.keepAlive, userName.c_str(), &password, &willMsg,
-                mqttConfiguration.qos, mqttConfiguration.willRetain, mqttConfiguration.props);
-            if (!transaction)
+            connection.connectInFlight = true;
+            const auto started = StartTransaction(
+                lock, i,
+                [&]
+                {
+                    return connection.mqttClient->ConnectTo(
+                        mqttConfiguration.name, mqttConfiguration.host, mqttConfiguration.port,
+                        mqttConfiguration.useTLS, mqttConfiguration.cleanSession,
+                        mqttConfiguration.keepAlive, userName.c_str(), &password, &willMsg,
+                        mqttConfiguration.qos, mqttConfiguration.willRetain,
+                        mqttConfiguration.props);
+                },
+                [this, &connection, i](MqttV5::IMqttV5Client::Transaction::State state,
+                                       const std::vector<MqttV5::ReasonCode>& reasons)
+                {
+                    connection.connectInFlight = false;
+
+                    // The reason code may have been lost if the broker answered
+                    // before the transaction was handed its delegate, in which
+                    // case the state of the transaction tells the outcome.
+                    bool ok = (state == MqttV5::IMqttV5Client::Transaction::State::Success) &&
+                              (reasons.empty() ||
+                               (reasons.back() == MqttV5::Storage::ReasonCode::Success));
+                    connection.mqttConnected = ok;
+                    if (ok)
+                    { Resubscribe(i); }
+                    diagnosticsMessageDelegate(
+                        "MqttClientPlugin",
+                        ok ? SystemUtils::DiagnosticsSender::Levels::INFO
+                           : SystemUtils::DiagnosticsSender::Levels::ERROR,
+                        StringUtils::sprintf(ok ? "Mqtt client '%s' connected to the broker."
+                                                : "Mqtt client '%s' connection failed",
+                                             connection.mqttConfiguration.clientId.c_str()));
+                });
+            if (!started)
             {
+                connection.connectInFlight = false;
                 diagnosticsMessageDelegate(
                     "MqttClientPlugin", SystemUtils::DiagnosticsSender::Levels::ERROR,
                     "ConnectTo() return null. Check transport/timekeeper/mobilize;");
-                return;
             }
-            transaction->SetCompletionDelegate(
-                [this](std::vector<MqttV5::ReasonCode>& reasons)
-                {
-                    std::lock_guard<std::mutex> g(mutex);
-                    bool ok =
-                        !reasons.empty() && reasons.back() == MqttV5::Storage::ReasonCode::Success;
-                    mqttConnected = ok;
-                    diagnosticsMessageDelegate("MqttClientPlugin",
-                                               ok ? SystemUtils::DiagnosticsSender::Levels::INFO
-                                                  : SystemUtils::DiagnosticsSender::Levels::ERROR,
-                                               ok ? "Mqtt client connected to the broker."
-                                                  : "Mqtt client connection failed");
-                });
-            if (transaction->transactionState ==
-                MqttV5::IMqttV5Client::Transaction::State::WaitingForResult)
+        }
+
+        /**
+         * This method queues the SUBSCRIBE packets needed to subscribe
+         * the given connection again to the topic filters routed to it
+         * which mqttPoints are subscribed to, since the broker may have
+         * dropped them along with the connection.
+         * It's called with the mutex held, once the connection is made.
+         *
+         * @param[in] i
+         *      This is the number of the connection.
+         */
+        void Resubscribe(size_t i) {
+            BrokerPacket packet;
+            packet.type = CommandeType::Subscribe;
+            for (const auto& filter : filterCommands)
             {
-                if (transaction->AwaitCompletion(
-                        std::chrono::milliseconds(mqttConfiguration.connectTimeOut)))
+                if (router.Route(filter.first) != i)
+                { continue; }
+                packet.commands.push_back(filter.second);
+                if (packet.commands.size() == MAX_TOPICS_PER_PACKET)
+                {
+                    connections[i]->pendingPackets.push(std::move(packet));
+                    packet = BrokerPacket();
+                    packet.type = CommandeType::Subscribe;
+                }
+            }
+            if (!packet.commands.empty())
+            { connections[i]->pendingPackets.push(std::move(packet)); }
+        }
+
+        /**
+         * This method starts pinging the broker of the given connection.
+         * It's called by the worker thread with the mutex held.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] i
+         *      This is the number of the connection.
+         */
+        void Ping(std::unique_lock<std::mutex>& lock, size_t i) {
+            auto& connection = *connections[i];
+            connection.pingInFlight = true;
+            const auto started = StartTransaction(
+                lock, i,
+                [&connection]
+                { return connection.mqttClient->Ping(connection.mqttConfiguration.name); },
+                [this, &connection](MqttV5::IMqttV5Client::Transaction::State state,
+                                    const std::vector<MqttV5::ReasonCode>& reasons)
                 {
-                    switch (transaction->transactionState)
+                    connection.pingInFlight = false;
+                    switch (state)
                     {
                     case MqttV5::IMqttV5Client::Transaction::State::Success:
                         diagnosticsMessageDelegate("MqttClientPlugin", 3,
-                                                   "Connection established.");
+                                                   "Pong Response Received Successfully.");
                         break;
                     case MqttV5::IMqttV5Client::Transaction::State::ShunkedPacket:
                         diagnosticsMessageDelegate("MqttClientPlugin", 2, "ShunkedPacket.");
@@ -534,154 +1347,649 @@ namespace
                     default:
                         break;
                     }
-                }
-            }
-        }
-
-        void Ping() {
-            auto transaction = mqttClient->Ping("broker.test");
-            if (!transaction)
+                });
+            if (!started)
             {
+                connection.pingInFlight = false;
                 diagnosticsMessageDelegate(
                     "MqttClientPlugin", SystemUtils::DiagnosticsSender::Levels::ERROR,
                     "Ping() return null. Check transport/timekeeper/mobilize;");
+            }
+        }
+
+        /**
+         * This method sends the result of a subscription command
+         * to the given mqttPoint, if it's still connected.
+         * It's called with the mutex held.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the mqttPoint to which to send the result.
+         *
+         * @param[in] type
+         *      This is the type of result to send.
+         *
+         * @param[in] topic
+         *      This is the topic filter given with the command.
+         *
+         * @param[in] ok
+         *      This indicates whether or not the command succeeded.
+         *
+         * @param[in] reason
+         *      This explains why the command failed, if it did.
+         */
+        void SendCommandResult(unsigned int sessionId, const std::string& type,
+                               const std::string& topic, bool ok,
+                               const std::string& reason = "") {
+            auto it = mqttPoints.find(sessionId);
+            if (it == mqttPoints.end() || !it->second->ws)
+            { return; }
+            Json::Value resp(Json::Value::Type::Object);
+            resp.Set("Type", type);
+            resp.Set("Topic", topic);
+            resp.Set("Status", ok ? "Success" : "Error");
+            if (!reason.empty())
+            { resp.Set("Message", reason); }
+            it->second->ws->SendText(resp.ToEncoding());
+        }
+
+        /**
+         * This method indicates whether or not the client needs to stay
+         * subscribed to the given topic filter at the broker, because
+         * a mqttPoint is either subscribed or waiting to be.
+         * It's called with the mutex held.
+         *
+         * @param[in] topic
+         *      This is the topic filter to check.
+         *
+         * @return
+         *      An indication of whether or not the topic filter
+         *      is in use is returned.
+         */
+        bool IsFilterInUse(const std::string& topic) const {
+            return ((filterSubscribers.find(topic) != filterSubscribers.end()) ||
+                    (pendingSubscribers.find(topic) != pendingSubscribers.end()));
+        }
+
+        /**
+         * This method returns the subscriptions of the connection
+         * to the brokers the router assigns the given topic filter to.
+         * It's called with the mutex held.
+         *
+         * @param[in] topic
+         *      This is the topic filter.
+         *
+         * @return
+         *      The subscriptions of the connection are returned.
+         */
+        ConnectionSubscriptions& SubscriptionsOf(const std::string& topic) {
+            return subscriptions[router.Route(topic)];
+        }
+
+        /**
+         * This method subscribes the given mqttPoint to the given topic
+         * filter, which the client is already subscribed to at the broker.
+         * It's called with the mutex held.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the mqttPoint to subscribe.
+         *
+         * @param[in] topic
+         *      This is the topic filter to which to subscribe the mqttPoint.
+         */
+        void AddSubscriber(unsigned int sessionId, const std::string& topic) {
+            auto it = mqttPoints.find(sessionId);
+            if (it == mqttPoints.end())
+            { return; }
+
+            // Subscribing again only changes the policy of the subscription.
+            ApplyPolicy(sessionId, *it->second, topic);
+            if (filterSubscribers[topic].insert(sessionId).second)
+            {
+                it->second->topics.push_back(topic);
+                (void)SubscriptionsOf(topic).subscriptions.Add(topic, sessionId);
+            }
+            routingTableDirty = true;
+        }
+
+        /**
+         * This method files the subscription of the given mqttPoint to the
+         * given topic filter under the policy it was made with.
+         * It's called with the mutex held.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the mqttPoint.
+         *
+         * @param[in] mqttPoint
+         *      This is the mqttPoint.
+         *
+         * @param[in] topic
+         *      This is the topic filter of the subscription.
+         */
+        void ApplyPolicy(unsigned int sessionId, const MqttPoint& mqttPoint,
+                         const std::string& topic) {
+            auto& connectionSubscriptions = SubscriptionsOf(topic);
+            (void)connectionSubscriptions.conflatingSubscriptions.Remove(topic, sessionId);
+            (void)connectionSubscriptions.disconnectingSubscriptions.Remove(topic, sessionId);
+            const auto policy = mqttPoint.policies.find(topic);
+            if (policy == mqttPoint.policies.end())
+            { return; }
+            switch (policy->second)
+            {
+            case OutboundQueue::SlowConsumerPolicy::Conflate: {
+                (void)connectionSubscriptions.conflatingSubscriptions.Add(topic, sessionId);
+            }
+            break;
+
+            case OutboundQueue::SlowConsumerPolicy::Disconnect: {
+                (void)connectionSubscriptions.disconnectingSubscriptions.Add(topic, sessionId);
+            }
+            break;
+
+            default:
+                break;
+            }
+        }
+
+        /**
+         * This method unsubscribes the given mqttPoint from the given topic
+         * filter. It's called with the mutex held.
+         *
+         * @param[in] sessionId
+         *      This is the session ID of the mqttPoint to unsubscribe.
+         *
+         * @param[in, out] mqttPoint
+         *      This is the mqttPoint to unsubscribe.
+         *
+         * @param[in] topic
+         *      This is the topic filter from which to unsubscribe the mqttPoint.
+         *
+         * @return
+         *      An indication of whether or not the mqttPoint was the last
+         *      subscriber of the topic filter is returned.
+         */
+        bool RemoveSubscriber(unsigned int sessionId, MqttPoint& mqttPoint,
+                              const std::string& topic) {
+            const auto subscribers = filterSubscribers.find(topic);
+            if ((subscribers == filterSubscribers.end()) ||
+                (subscribers->second.erase(sessionId) == 0))
+            { return false; }
+            mqttPoint.topics.erase(
+                std::remove(mqttPoint.topics.begin(), mqttPoint.topics.end(), topic),
+                mqttPoint.topics.end());
+            auto& connectionSubscriptions = SubscriptionsOf(topic);
+            (void)connectionSubscriptions.subscriptions.Remove(topic, sessionId);
+            (void)connectionSubscriptions.conflatingSubscriptions.Remove(topic, sessionId);
+            (void)connectionSubscriptions.disconnectingSubscriptions.Remove(topic, sessionId);
+            (void)mqttPoint.policies.erase(topic);
+            routingTableDirty = true;
+            if (!subscribers->second.empty())
+            { return false; }
+            (void)filterSubscribers.erase(subscribers);
+            (void)filterCommands.erase(topic);
+            return true;
+        }
+
+        /**
+         * This method handles the subscription commands of a mqttPoint
+         * locally when it can, sharing the subscription of the client
+         * if it already has one, or else marks the topic filter as
+         * needing a subscription at the broker.
+         * It's called with the mutex held.
+         *
+         * @param[in] cmd
+         *      This is the command to handle.
+         *
+         * @param[in, out] subscribeBatch
+         *      This is where to add the command if the client needs
+         *      to subscribe to its topic filter at the broker.
+         */
+        void PrepareSubscribeCommand(const EndPointCommande& cmd,
+                                     std::vector<EndPointCommande>& subscribeBatch) {
+            const auto mqttPoint = mqttPoints.find(cmd.sessionId);
+            if (mqttPoint == mqttPoints.end())
+            { return; }
+            mqttPoint->second->policies[cmd.topic] = cmd.policy;
+
+            // Share the subscription of the client if it already has one.
+            if (filterSubscribers.find(cmd.topic) != filterSubscribers.end())
+            {
+                AddSubscriber(cmd.sessionId, cmd.topic);
+                SendCommandResult(cmd.sessionId, "SubscribeResult", cmd.topic, true);
                 return;
             }
-            // transaction->SetCompletionDelegate(
-            //     [this](std::vector<MqttV5::ReasonCode>& reasons)
-            //     {
-            //         std::lock_guard<std::mutex> g(mutex);
-            //         bool ok =
-            //             !reasons.empty() && reasons.back() ==
-            //             MqttV5::Storage::ReasonCode::Success;
-            //         mqttConnected = ok;
-            //         diagnosticsMessageDelegate("MqttClientPlugin",
-            //                                    ok ? SystemUtils::DiagnosticsSender::Levels::INFO
-            //                                       :
-            //                                       SystemUtils::DiagnosticsSender::Levels::ERROR,
-            //                                    ok ? "Mqtt client connected to the broker."
-            //                                       : "Mqtt client connection failed");
-            //     });
-            if (transaction->transactionState ==
-                MqttV5::IMqttV5Client::Transaction::State::WaitingForResult)
-            {
-                if (transaction->AwaitCompletion(
-                        std::chrono::milliseconds(mqttConfiguration.connectTimeOut)))
-                {
-                    switch (transaction->transactionState)
+
+            // Wait along with others if the client is already subscribing.
+            auto pending = pendingSubscribers.find(cmd.topic);
+            if (pending != pendingSubscribers.end())
+            {
+                pending->second.push_back(cmd.sessionId);
+                return;
+            }
+            pendingSubscribers[cmd.topic].push_back(cmd.sessionId);
+            subscribeBatch.push_back(cmd);
+        }
+
+        /**
+         * This method handles an unsubscription command locally, and marks
+         * the topic filter as needing to be unsubscribed at the broker
+         * if its last subscriber left. Commands with a session ID of zero
+         * come from the plug-in itself, once the last subscriber of a topic
+         * filter left, and only unsubscribe the client at the broker.
+         * It's called with the mutex held.
+         *
+         * @param[in] cmd
+         *      This is the command to handle.
+         *
+         * @param[in, out] unsubscribeBatch
+         *      This is where to add the topic filter if the client needs
+         *      to unsubscribe from it at the broker.
+         */
+        void PrepareUnSubscribeCommand(const EndPointCommande& cmd,
+                                       std::vector<std::string>& unsubscribeBatch) {
+            if (cmd.sessionId != 0)
+            {
+                auto it = mqttPoints.find(cmd.sessionId);
+                if (it == mqttPoints.end())
+                { return; }
+                auto subscribed = (std::find(it->second->topics.begin(), it->second->topics.end(),
+                                             cmd.topic) != it->second->topics.end());
+                const auto last = RemoveSubscriber(cmd.sessionId, *it->second, cmd.topic);
+
+                // Stop waiting for a subscription the client is still making.
+                auto pending = pendingSubscribers.find(cmd.topic);
+                if (pending != pendingSubscribers.end())
+                {
+                    auto& waiting = pending->second;
+                    const auto position = std::find(waiting.begin(), waiting.end(), cmd.sessionId);
+                    if (position != waiting.end())
                     {
-                    case MqttV5::IMqttV5Client::Transaction::State::Success:
-                        diagnosticsMessageDelegate("MqttClientPlugin", 3,
-                                                   "Pong Response Received Successfully.");
-                        break;
-                    case MqttV5::IMqttV5Client::Transaction::State::ShunkedPacket:
-                        diagnosticsMessageDelegate("MqttClientPlugin", 2, "ShunkedPacket.");
-                        break;
-                    default:
-                        break;
+                        (void)waiting.erase(position);
+                        (void)it->second->policies.erase(cmd.topic);
+                        subscribed = true;
                     }
                 }
+                SendCommandResult(cmd.sessionId, "UnSubscribeResult", cmd.topic, subscribed,
+                                  subscribed ? "" : "Not subscribed");
+                if (!last)
+                { return; }
             }
+            if (std::find(unsubscribeBatch.begin(), unsubscribeBatch.end(), cmd.topic) ==
+                unsubscribeBatch.end())
+            { unsubscribeBatch.push_back(cmd.topic); }
         }
 
-        void HandleSubscribeCommand(EndPointCommande cmd) {
-            auto transaction = mqttClient->Subscribe(
-                "broker.test", cmd.topic.c_str(), cmd.retainHandling, cmd.withAutoFeadBack, cmd.qos,
-                cmd.retainAsPublished, mqttConfiguration.props);
+        /**
+         * This method handles the given subscription and unsubscription
+         * commands, in order, and queues the SUBSCRIBE and UNSUBSCRIBE
+         * packets the brokers need to be sent, holding up to
+         * MAX_TOPICS_PER_PACKET topic filters each, on the connection
+         * the router picks for each topic filter.
+         * It's called by the worker thread with the mutex held.
+         *
+         * @param[in] commands
+         *      These are the commands to handle.
+         */
+        void PrepareCommands(const std::vector<EndPointCommande>& commands) {
+            std::vector<EndPointCommande> subscribeBatch;
+            std::vector<std::string> unsubscribeBatch;
+            for (const auto& cmd : commands)
+            {
+                switch (cmd.type)
+                {
+                case CommandeType::Subscribe: {
+                    PrepareSubscribeCommand(cmd, subscribeBatch);
+                }
+                break;
 
-            if (!transaction)
+                case CommandeType::Unsubscribe: {
+                    PrepareUnSubscribeCommand(cmd, unsubscribeBatch);
+                }
+                break;
+
+                default:
+                    break;
+                }
+            }
+            std::vector<BrokerPacket> packets(connections.size());
+            for (const auto& topic : unsubscribeBatch)
             {
-                std::lock_guard<std::mutex> g(mutex);
-                auto it = mqttPoints.find(cmd.sessionId);
-                if (it != mqttPoints.end() && it->second->ws)
-                {
-                    Json::Value resp(Json::Value::Type::Object);
-                    resp.Set("Type", "SubscribeResult");
-                    resp.Set("Topic", cmd.topic);
-                    resp.Set("Status", "Error");
-                    resp.Set("Message", "Subscribe() returned null");
-                    it->second->ws->SendText(resp.ToEncoding());
+                const auto connection = router.Route(topic);
+                auto& packet = packets[connection];
+                packet.type = CommandeType::Unsubscribe;
+                packet.topics.push_back(topic);
+                if (packet.topics.size() == MAX_TOPICS_PER_PACKET)
+                {
+                    connections[connection]->pendingPackets.push(std::move(packet));
+                    packet = BrokerPacket();
                 }
-                return;
             }
+            for (size_t i = 0; i < connections.size(); ++i)
+            {
+                if (!packets[i].topics.empty())
+                { connections[i]->pendingPackets.push(std::move(packets[i])); }
+                packets[i] = BrokerPacket();
+            }
+            for (const auto& cmd : subscribeBatch)
+            {
+                const auto connection = router.Route(cmd.topic);
+                auto& packet = packets[connection];
+                packet.type = CommandeType::Subscribe;
+                packet.commands.push_back(cmd);
+                if (packet.commands.size() == MAX_TOPICS_PER_PACKET)
+                {
+                    connections[connection]->pendingPackets.push(std::move(packet));
+                    packet = BrokerPacket();
+                }
+            }
+            for (size_t i = 0; i < connections.size(); ++i)
+            {
+                if (!packets[i].commands.empty())
+                { connections[i]->pendingPackets.push(std::move(packets[i])); }
+            }
+            PublishRoutingTable();
+        }
+
+        /**
+         * This method starts sending the given packet to the broker.
+         * It's called by the worker thread with the mutex held.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] i
+         *      This is the number of the connection on which to send the packet.
+         *
+         * @param[in] packet
+         *      This is the packet to send.
+         */
+        void SendPacket(std::unique_lock<std::mutex>& lock, size_t i, const BrokerPacket& packet) {
+            switch (packet.type)
+            {
+            case CommandeType::Subscribe: {
+                SubscribeAtBroker(lock, i, packet.commands, packet.retry);
+            }
+            break;
 
-            transaction->SetCompletionDelegate(
-                [this, cmd](std::vector<MqttV5::ReasonCode>& reasons)
+            case CommandeType::Unsubscribe: {
+                UnsubscribeAtBroker(lock, i, packet.topics);
+            }
+            break;
+
+            default:
+                break;
+            }
+        }
+
+        /**
+         * This method starts subscribing the client at the broker to the
+         * topic filters of the given commands, in a single SUBSCRIBE packet.
+         * The reason code the broker gives for each topic filter is then
+         * handed to the mqttPoints waiting for it.
+         * It's called by the worker thread with the mutex held.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] i
+         *      This is the number of the connection on which to subscribe.
+         *
+         * @param[in] batch
+         *      These are the commands whose topic filters to subscribe to.
+         *
+         * @param[in] retry
+         *      This indicates whether or not the topic filters are subscribed
+         *      to again because the reason codes the broker gave were lost.
+         */
+        void SubscribeAtBroker(std::unique_lock<std::mutex>& lock, size_t i,
+                               const std::vector<EndPointCommande>& batch, bool retry) {
+            const auto& connection = *connections[i];
+            const auto started = StartTransaction(
+                lock, i,
+                [&connection, &batch]
                 {
-                    std::lock_guard<std::mutex> g(mutex);
+                    TopicList<MqttV5::SubscribeTopic> topics;
+                    for (const auto& cmd : batch)
+                    {
+                        topics.Add(std::unique_ptr<MqttV5::SubscribeTopic>(
+                            new MqttV5::SubscribeTopic(cmd.topic, cmd.retainHandling,
+                                                       cmd.withAutoFeadBack, cmd.qos,
+                                                       cmd.retainAsPublished)));
+                    }
+                    return connection.mqttClient->Subscribe(connection.mqttConfiguration.name,
+                                                            topics.Head(),
+                                                            connection.mqttConfiguration.props);
+                },
+                [this, i, batch, retry](MqttV5::IMqttV5Client::Transaction::State state,
+                                        const std::vector<MqttV5::ReasonCode>& reasons)
+                {
+                    // The reason codes are lost if the broker answered before
+                    // the transaction was handed its delegate. Subscribing
+                    // again is harmless, and gets them.
+                    if ((state == MqttV5::IMqttV5Client::Transaction::State::Success) &&
+                        (reasons.size() < batch.size()))
+                    {
+                        if (!retry)
+                        {
+                            BrokerPacket packet;
+                            packet.type = CommandeType::Subscribe;
+                            packet.commands = batch;
+                            packet.retry = true;
+                            connections[i]->pendingPackets.push(std::move(packet));
+                            workerWakeCondition.notify_all();
+                            return;
+                        }
+                        CompleteSubscriptions(batch, {}, "Subscribe result lost");
 
-                    auto it = mqttPoints.find(cmd.sessionId);
-                    if (it == mqttPoints.end() || !it->second->ws)
+                        // The broker may have subscribed the client anyway.
+                        for (const auto& cmd : batch)
+                        {
+                            if (IsFilterInUse(cmd.topic))
+                            { continue; }
+                            EndPointCommande unsubscribe;
+                            unsubscribe.type = CommandeType::Unsubscribe;
+                            unsubscribe.sessionId = 0;
+                            unsubscribe.topic = cmd.topic;
+                            pendingCommandes.push(unsubscribe);
+                        }
+                        workerWakeCondition.notify_all();
                         return;
-                    bool ok = !reasons.empty() && reasons.back() < 0x80;
-                    if (ok)
-                    { it->second->topics.push_back(cmd.topic); }
-                    Json::Value resp(Json::Value::Type::Object);
-                    resp.Set("Type", "SubscribeResult");
-                    resp.Set("Topic", cmd.topic);
-                    resp.Set("Status", ok ? "Success" : "Error");
-                    it->second->ws->SendText(resp.ToEncoding());
+                    }
+                    CompleteSubscriptions(batch, reasons,
+                                          (state ==
+                                           MqttV5::IMqttV5Client::Transaction::State::Timeout)
+                                              ? "Subscribe timed out"
+                                              : "");
                 });
+            if (!started)
+            {
+                CompleteSubscriptions(batch, {}, "Subscribe() returned null");
+                PublishRoutingTable();
+            }
+        }
 
-            if (transaction->transactionState ==
-                MqttV5::IMqttV5Client::Transaction::State::WaitingForResult)
+        /**
+         * This method hands the outcome of subscribing the client
+         * at the broker to the mqttPoints waiting for it. Commands with
+         * a session ID of zero subscribe the client again after it
+         * reconnected, and unsubscribe the mqttPoints if that fails.
+         * It's called with the mutex held.
+         *
+         * @param[in] batch
+         *      These are the commands whose topic filters were subscribed to,
+         *      in the order they were given in the SUBSCRIBE packet.
+         *
+         * @param[in] reasons
+         *      These are the reason codes the broker gave for each topic filter.
+         *      Topic filters without one are considered to have failed.
+         *
+         * @param[in] reason
+         *      This explains why every subscription failed, if they did.
+         */
+        void CompleteSubscriptions(const std::vector<EndPointCommande>& batch,
+                                   const std::vector<MqttV5::ReasonCode>& reasons,
+                                   const std::string& reason) {
+            for (size_t i = 0; i < batch.size(); ++i)
             {
-                if (transaction->AwaitCompletion(
-                        std::chrono::milliseconds(mqttConfiguration.connectTimeOut)))
+                const auto& topic = batch[i].topic;
+                const auto ok = (i < reasons.size()) && (reasons[i] < 0x80);
+                if (batch[i].sessionId == 0)
                 {
-                    switch (transaction->transactionState)
-                    {
-                    case MqttV5::IMqttV5Client::Transaction::State::Success:
-                        diagnosticsMessageDelegate("MqttClientPlugin", 3,
-                                                   "Subscruption response occured Successfully.");
-                        break;
-                    case MqttV5::IMqttV5Client::Transaction::State::ShunkedPacket:
-                        diagnosticsMessageDelegate("MqttClientPlugin", 2, "ShunkedPacket.");
-                        break;
-                    default:
-                        break;
-                    }
+                    if (!ok)
+                    { DropSubscribers(topic, reason.empty() ? "Subscribe again failed" : reason); }
+                } else
+                {
+                    const auto waiting = std::move(pendingSubscribers[topic]);
+                    (void)pendingSubscribers.erase(topic);
+                    HandOverSubscription(batch[i], waiting, ok, reason);
+                }
+
+                // Let go of the subscription if everyone waiting for it left.
+                if (ok && !IsFilterInUse(topic))
+                {
+                    EndPointCommande unsubscribe;
+                    unsubscribe.type = CommandeType::Unsubscribe;
+                    unsubscribe.sessionId = 0;
+                    unsubscribe.topic = topic;
+                    pendingCommandes.push(unsubscribe);
+                    workerWakeCondition.notify_all();
                 }
             }
         }
 
-        void HandleUnSubscribeCommand(EndPointCommande cmd) {
-            MqttV5::UnsubscribeTopic topic(cmd.topic);
-
-            auto transcation = mqttClient->Unsubscribe(&topic);
-            if (!transcation)
+        /**
+         * This method hands the outcome of subscribing the client at the
+         * broker to the given topic filter to the mqttPoints waiting for it.
+         * It's called with the mutex held.
+         *
+         * @param[in] cmd
+         *      This is the command with which the client subscribed.
+         *
+         * @param[in] waiting
+         *      These are the session IDs of the mqttPoints waiting.
+         *
+         * @param[in] ok
+         *      This indicates whether or not the broker subscribed the client.
+         *
+         * @param[in] reason
+         *      This explains why the subscription failed, if it did.
+         */
+        void HandOverSubscription(const EndPointCommande& cmd,
+                                  const std::vector<unsigned int>& waiting, bool ok,
+                                  const std::string& reason) {
+            const auto& topic = cmd.topic;
+            for (const auto sessionId : waiting)
             {
-                std::lock_guard<std::mutex> g(mutex);
-                auto it = mqttPoints.find(cmd.sessionId);
-                if (it != mqttPoints.end() && it->second->ws)
-                {
-                    Json::Value resp(Json::Value::Type::Object);
-                    resp.Set("Type", "UnSubscribeResult");
-                    resp.Set("Topic", cmd.topic);
-                    resp.Set("Status", "Error");
-                    resp.Set("Message", "UnSubscribe() returned null");
-                    it->second->ws->SendText(resp.ToEncoding());
+                if (ok)
+                {
+                    AddSubscriber(sessionId, topic);
+                } else
+                {
+                    const auto mqttPoint = mqttPoints.find(sessionId);
+                    if (mqttPoint != mqttPoints.end())
+                    { (void)mqttPoint->second->policies.erase(topic); }
                 }
-                return;
+                SendCommandResult(sessionId, "SubscribeResult", topic, ok, reason);
+            }
+            if (ok && (filterSubscribers.find(topic) != filterSubscribers.end()))
+            {
+                auto& filterCommand = filterCommands[topic];
+                filterCommand = cmd;
+                filterCommand.sessionId = 0;
             }
+        }
 
-            transcation->SetCompletionDelegate(
-                [this, cmd](std::vector<MqttV5::ReasonCode>& reasons)
-                {
-                    std::lock_guard<std::mutex> g(mutex);
+        /**
+         * This method unsubscribes every mqttPoint from the given topic
+         * filter, once the client failed to subscribe to it again at the
+         * broker, and lets them know. It's called with the mutex held.
+         *
+         * @param[in] topic
+         *      This is the topic filter from which to unsubscribe the mqttPoints.
+         *
+         * @param[in] reason
+         *      This explains why the subscription was lost.
+         */
+        void DropSubscribers(const std::string& topic, const std::string& reason) {
+            const auto subscribers = filterSubscribers.find(topic);
+            if (subscribers == filterSubscribers.end())
+            { return; }
+            diagnosticsMessageDelegate(
+                "MqttClientPlugin", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                StringUtils::sprintf("lost the subscription to '%s': %s", topic.c_str(),
+                                     reason.c_str()));
+            const auto sessionIds = subscribers->second;
+            for (const auto sessionId : sessionIds)
+            {
+                const auto mqttPoint = mqttPoints.find(sessionId);
+                if (mqttPoint == mqttPoints.end())
+                { continue; }
+                (void)RemoveSubscriber(sessionId, *mqttPoint->second, topic);
+                SendCommandResult(sessionId, "SubscribeResult", topic, false, reason);
+            }
+        }
 
-                    auto it = mqttPoints.find(cmd.sessionId);
-                    if (it == mqttPoints.end() || !it->second->ws)
-                        return;
-                    bool ok = !reasons.empty() && reasons.back() < 0x80;
-                    if (ok)
-                    { it->second->topics.push_back(cmd.topic); }
-                    Json::Value resp(Json::Value::Type::Object);
-                    resp.Set("Type", "UnSubscribeResult");
-                    resp.Set("Topic", cmd.topic);
-                    resp.Set("Status", ok ? "Success" : "Error");
-                    it->second->ws->SendText(resp.ToEncoding());
+        /**
+         * This method starts unsubscribing the client at the broker from
+         * the given topic filters, in a single UNSUBSCRIBE packet, leaving
+         * out those which were subscribed to again since being queued.
+         * It's called by the worker thread with the mutex held.
+         *
+         * @param[in, out] lock
+         *      This is the lock the worker thread holds on the mutex.
+         *
+         * @param[in] i
+         *      This is the number of the connection on which to unsubscribe.
+         *
+         * @param[in] topics
+         *      These are the topic filters from which to unsubscribe.
+         */
+        void UnsubscribeAtBroker(std::unique_lock<std::mutex>& lock, size_t i,
+                                 const std::vector<std::string>& topics) {
+            std::vector<std::string> batch;
+            for (const auto& topic : topics)
+            {
+                if (!IsFilterInUse(topic))
+                { batch.push_back(topic); }
+            }
+            if (batch.empty())
+            { return; }
+            const auto& connection = *connections[i];
+            const auto started = StartTransaction(
+                lock, i,
+                [&connection, &batch]
+                {
+                    TopicList<MqttV5::UnsubscribeTopic> topics;
+                    for (const auto& topic : batch)
+                    {
+                        topics.Add(std::unique_ptr<MqttV5::UnsubscribeTopic>(
+                            new MqttV5::UnsubscribeTopic(topic)));
+                    }
+                    return connection.mqttClient->Unsubscribe(topics.Head());
+                },
+                [this, batch](MqttV5::IMqttV5Client::Transaction::State state,
+                              const std::vector<MqttV5::ReasonCode>& reasons)
+                {
+                    // Topic filters whose reason codes were lost, if the broker
+                    // answered before the transaction was handed its delegate,
+                    // are taken to be unsubscribed if the transaction succeeded.
+                    const auto succeeded =
+                        (state == MqttV5::IMqttV5Client::Transaction::State::Success);
+                    for (size_t i = 0; i < batch.size(); ++i)
+                    {
+                        if ((i < reasons.size()) ? (reasons[i] < 0x80) : succeeded)
+                        { continue; }
+                        diagnosticsMessageDelegate(
+                            "MqttClientPlugin", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                            StringUtils::sprintf("broker refused to unsubscribe from '%s'",
+                                                 batch[i].c_str()));
+                    }
                 });
+            if (!started)
+            {
+                diagnosticsMessageDelegate("MqttClientPlugin",
+                                           SystemUtils::DiagnosticsSender::Levels::ERROR,
+                                           "UnSubscribe() returned null");
+            }
         }
 
         void JoinServer(unsigned int sessionId, const Json::Value& message) {
@@ -692,7 +2000,7 @@ namespace
             response.Set("Type", "JoinChatRoomResponse");
             response.Set("Success", true);
             Json::Value subscriptions(Json::Value::Type::Array);
-            if (mqttClient && mqttConnected)
+            if (IsAnyConnected())
             {
                 for (auto& endPoint : mqttPoints)
                 {
@@ -706,13 +2014,13 @@ namespace
         }
 
         void PostSubscribeCommand(unsigned int sessionId, const Json::Value& message) {
-            if (!mqttClient)
+            if (connections.empty())
             {
                 const auto diagnosticSenderName =
                     StringUtils::sprintf("Session #%zu : UnSubscribtion", sessionId);
                 diagnosticsMessageDelegate(diagnosticSenderName,
                                            SystemUtils::DiagnosticsSender::Levels::ERROR,
-                                           "mqtt client object is null");
+                                           "no broker is configured");
                 return;
             }
 
@@ -727,12 +2035,32 @@ namespace
                 } else if (q == 2)
                 { qos = MqttV5::QoSDelivery::ExactlyOne; }
             }
+            auto policy = OutboundQueue::SlowConsumerPolicy::DropOldest;
+            if (message.Has("Policy"))
+            {
+                const std::string policyName = message["Policy"];
+                if (policyName == "conflate")
+                {
+                    policy = OutboundQueue::SlowConsumerPolicy::Conflate;
+                } else if (policyName == "disconnect")
+                {
+                    policy = OutboundQueue::SlowConsumerPolicy::Disconnect;
+                } else if (policyName != "drop-oldest")
+                {
+                    diagnosticsMessageDelegate(
+                        StringUtils::sprintf("Session #%zu : Subscribtion", sessionId),
+                        SystemUtils::DiagnosticsSender::Levels::WARNING,
+                        StringUtils::sprintf("unknown slow consumer policy '%s'; dropping oldest",
+                                             policyName.c_str()));
+                }
+            }
 
             EndPointCommande cmd;
             cmd.type = CommandeType::Subscribe;
             cmd.sessionId = sessionId;
             cmd.topic = topic;
             cmd.qos = qos;
+            cmd.policy = policy;
 
             pendingCommandes.push(cmd);
             subscribeNewTopic = true;
@@ -740,13 +2068,13 @@ namespace
         }
 
         void PostUnSubscribeCommand(unsigned int sessionId, const Json::Value& message) {
-            if (!mqttClient)
+            if (connections.empty())
             {
                 const auto diagnosticSenderName =
                     StringUtils::sprintf("Session #%zu : UnSubscribtion", sessionId);
                 diagnosticsMessageDelegate(diagnosticSenderName,
                                            SystemUtils::DiagnosticsSender::Levels::ERROR,
-                                           "mqtt client object is null");
+                                           "no broker is configured");
                 return;
             }
 
@@ -780,7 +2108,19 @@ namespace
             { return; }
             endPoint->second->ws->Close(code, reason);
             endPoint->second->connected = false;
+            const auto topics = endPoint->second->topics;
+            for (const auto& topic : topics)
+            {
+                if (!RemoveSubscriber(sessionId, *endPoint->second, topic))
+                { continue; }
+                EndPointCommande unsubscribe;
+                unsubscribe.type = CommandeType::Unsubscribe;
+                unsubscribe.sessionId = 0;
+                unsubscribe.topic = topic;
+                pendingCommandes.push(unsubscribe);
+            }
             mqttPoints.erase(endPoint);
+            PublishRoutingTable();
             endPointHaveClosed = true;
             workerWakeCondition.notify_all();
         }
@@ -828,6 +2168,38 @@ namespace
             mqttPoint->ws = std::make_unique<WebSocket::WebSocket>();
             mqttPoints.emplace(sessionId, mqttPoint);
             const auto diagnosticSenderName = StringUtils::sprintf("Session #%zu", sessionId);
+
+            // The queue is owned by the mqttPoint, so it may refer to it.
+            const auto mqttPointRaw = mqttPoint.get();
+            mqttPoint->outbox.reset(new OutboundQueue(
+                outboundQueueLimit, outboundQueueBytes,
+                [mqttPointRaw](const std::string& message)
+                { mqttPointRaw->ws->SendText(message); },
+                [this, mqttPointRaw, diagnosticSenderName]
+                {
+                    diagnosticsMessageDelegate(diagnosticSenderName,
+                                               SystemUtils::DiagnosticsSender::Levels::WARNING,
+                                               "Disconnecting mqttPoint too slow to take messages");
+                    mqttPointRaw->ws->Close(SLOW_CONSUMER_CLOSE_CODE, "Too slow");
+                }));
+
+            // Sending text only buffers it in the WebSocket, so the mqttPoint
+            // is pinged after each run of messages, and answering the ping
+            // acknowledges receiving them, as pongs come back in order.
+            mqttPoint->outbox->SetWindow(
+                outboundWindowBytes, [mqttPointRaw](size_t mark)
+                { mqttPointRaw->ws->Ping(StringUtils::sprintf("%zu", mark)); });
+            const std::weak_ptr<MqttPoint> mqttPointWeak(mqttPoint);
+            mqttPoint->ws->SetPongDelegate(
+                [this, mqttPointWeak](const std::string& data)
+                {
+                    const auto mqttPoint = mqttPointWeak.lock();
+                    if (!mqttPoint)
+                    { return; }
+                    const auto mark = (size_t)strtoull(data.c_str(), NULL, 10);
+                    if (mqttPoint->outbox->Acknowledge(mark))
+                    { ScheduleFlush(mqttPoint); }
+                });
             mqttPoint->diagnosticSenderName = diagnosticSenderName;
             mqttPoint->wsDiagnosticsUnsubscribeDelegate = mqttPoint->ws->SubscribeToDiagnostics(
                 [this, diagnosticSenderName](std::string senderName, size_t level,
@@ -860,28 +2232,35 @@ namespace
         msg.Set("Type", "Publish");
         msg.Set("Topic", topicStr);
         msg.Set("Payload", std::string(reinterpret_cast<const char*>(payload.data), payload.size));
-        const auto encoded = msg.ToEncoding();
-        std::lock_guard<std::mutex> lock(broker->mutex);
-        for (auto& it : broker->mqttPoints)
+        const auto encoded = std::make_shared<const std::string>(msg.ToEncoding());
+        const auto routingTable = std::atomic_load(&broker->routingTable);
+        if (connection >= routingTable->connections.size())
+        { return; }
+        const auto& subscriptions = routingTable->connections[connection];
+        subscriptions.subscriptions.Match(topic.data, topic.size, matchingSessionIds);
+        subscriptions.conflatingSubscriptions.Match(topic.data, topic.size, conflatingSessionIds);
+        subscriptions.disconnectingSubscriptions.Match(topic.data, topic.size,
+                                                       disconnectingSessionIds);
+        for (const auto sessionId : matchingSessionIds)
         {
-            auto& endPoint = it.second;
-            if (!endPoint || !endPoint->connected || !endPoint->ws)
+            const auto it = routingTable->mqttPoints.find(sessionId);
+            if (it == routingTable->mqttPoints.end())
+            { continue; }
+            const auto& endPoint = it->second;
+            if (!endPoint->connected || !endPoint->outbox)
             { continue; }
 
-            // Check if a WS has a subscriber that match the topic
-            bool match = false;
-            for (const auto& filter : endPoint->topics)
+            // The strictest policy applies when several subscriptions match.
+            auto policy = OutboundQueue::SlowConsumerPolicy::DropOldest;
+            if (std::binary_search(disconnectingSessionIds.begin(), disconnectingSessionIds.end(),
+                                   sessionId))
             {
-                if (topicMatchesfilter(filter, topicStr))
-                {
-                    match = true;
-                    break;
-                }
-            }
-
-            if (!match)
-            { continue; }
-            endPoint->ws->SendText(encoded);
+                policy = OutboundQueue::SlowConsumerPolicy::Disconnect;
+            } else if (std::binary_search(conflatingSessionIds.begin(),
+                                          conflatingSessionIds.end(), sessionId))
+            { policy = OutboundQueue::SlowConsumerPolicy::Conflate; }
+            (void)endPoint->outbox->Push(topicStr, encoded, policy);
+            broker->ScheduleFlush(endPoint);
         }
     }
 
@@ -891,8 +2270,9 @@ namespace
 
         {
             std::lock_guard<std::mutex> lock(broker->mutex);
-            broker->mqttConnected = false;
-            broker->initialConnectPending = true;
+            auto& brokerConnection = *broker->connections[connection];
+            brokerConnection.mqttConnected = false;
+            brokerConnection.initialConnectPending = true;
         }
         broker->workerWakeCondition.notify_all();
         return true;
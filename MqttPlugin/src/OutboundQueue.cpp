@@ -0,0 +1,298 @@
+/**
+ * @file OutboundQueue.cpp
+ *
+ * This module contains the implementation of the OutboundQueue class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include "OutboundQueue.hpp"
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace
+{
+    /**
+     * This is one message waiting to be sent.
+     */
+    struct Entry
+    {
+        /**
+         * This is the topic on which the message was published.
+         */
+        std::string topic;
+
+        /**
+         * This is the message to send.
+         */
+        OutboundQueue::Message message;
+
+        /**
+         * This indicates whether or not a later message
+         * for the same topic may replace this one.
+         */
+        bool conflated = false;
+
+        /**
+         * This indicates whether or not another message for the same
+         * topic was queued after this one, so that a later message
+         * replacing this one must be sent after that one.
+         */
+        bool followed = false;
+    };
+}  // namespace
+
+struct OutboundQueue::Impl
+{
+    // Properties
+
+    /**
+     * This synchronizes access to the queue.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * These are the messages waiting to be sent, oldest first.
+     */
+    std::list<Entry> entries;
+
+    /**
+     * These are the messages waiting to be sent which a later
+     * message for the same topic may replace, keyed by topic.
+     */
+    std::map<std::string, std::list<Entry>::iterator> conflatedEntries;
+
+    /**
+     * This is the number of bytes held by the messages waiting to be sent.
+     */
+    size_t bytes = 0;
+
+    /**
+     * This is the maximum number of messages to hold in the queue.
+     */
+    size_t messageLimit = 1;
+
+    /**
+     * This is the maximum number of bytes the messages
+     * held in the queue may add up to.
+     */
+    size_t byteLimit = 1;
+
+    /**
+     * This is the function to call to send one message to the mqttPoint.
+     */
+    SendDelegate sendDelegate;
+
+    /**
+     * This is the function to call to disconnect the mqttPoint.
+     */
+    DisconnectDelegate disconnectDelegate;
+
+    /**
+     * This is the maximum number of bytes sent which the mqttPoint may
+     * not have acknowledged, or zero if there's no limit.
+     */
+    size_t windowBytes = 0;
+
+    /**
+     * This is the function to call after sending messages,
+     * to have the mqttPoint acknowledge once it received them.
+     */
+    MarkDelegate markDelegate;
+
+    /**
+     * This is the number of bytes sent to the mqttPoint.
+     */
+    size_t sentBytes = 0;
+
+    /**
+     * This is the number of bytes sent which the mqttPoint
+     * acknowledged receiving.
+     */
+    size_t acknowledgedBytes = 0;
+
+    /**
+     * This indicates whether or not a thread is sending
+     * the messages in the queue.
+     */
+    bool sending = false;
+
+    /**
+     * This indicates whether or not the queue overflowed under
+     * the policy of disconnecting the mqttPoint.
+     */
+    bool overflowed = false;
+
+    /**
+     * This indicates whether or not the mqttPoint was disconnected.
+     */
+    bool disconnected = false;
+
+    /**
+     * This is the number of messages dropped because the queue was full.
+     */
+    size_t dropped = 0;
+
+    // Methods
+
+    /**
+     * This method takes the oldest message out of the queue.
+     */
+    void PopFront() {
+        const auto& front = entries.front();
+        if (front.conflated)
+        { (void)conflatedEntries.erase(front.topic); }
+        bytes -= front.message->length();
+        entries.pop_front();
+    }
+
+    /**
+     * This method indicates whether or not the queue holds more
+     * messages, or more bytes, than it may.
+     *
+     * @return
+     *      An indication of whether or not the queue
+     *      is over its limits is returned.
+     */
+    bool IsOverLimits() const {
+        return ((entries.size() > messageLimit) || (bytes > byteLimit));
+    }
+
+    /**
+     * This method indicates whether or not the mqttPoint has
+     * as many bytes it hasn't acknowledged as the window allows.
+     *
+     * @return
+     *      An indication of whether or not the window is full is returned.
+     */
+    bool IsWindowFull() const {
+        return ((windowBytes != 0) && (sentBytes - acknowledgedBytes >= windowBytes));
+    }
+};
+
+OutboundQueue::~OutboundQueue() noexcept = default;
+
+OutboundQueue::OutboundQueue(size_t messageLimit, size_t byteLimit, SendDelegate sendDelegate,
+                             DisconnectDelegate disconnectDelegate)
+    : impl_(new Impl()) {
+    impl_->messageLimit = std::max(messageLimit, (size_t)1);
+    impl_->byteLimit = std::max(byteLimit, (size_t)1);
+    impl_->sendDelegate = sendDelegate;
+    impl_->disconnectDelegate = disconnectDelegate;
+}
+
+bool OutboundQueue::Push(const std::string& topic, Message message, SlowConsumerPolicy policy) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (impl_->overflowed)
+    { return false; }
+
+    // Replace the message still waiting for the same topic, if any.
+    // If other messages for the topic were queued after it, it's dropped
+    // instead, and the new message queued last, so that the latest
+    // message of the topic is still the last one sent.
+    const auto conflatedEntry = impl_->conflatedEntries.find(topic);
+    if (conflatedEntry != impl_->conflatedEntries.end())
+    {
+        auto& entry = *conflatedEntry->second;
+        if (policy != SlowConsumerPolicy::Conflate)
+        {
+            entry.followed = true;
+        } else if (!entry.followed)
+        {
+            impl_->bytes -= entry.message->length();
+            impl_->bytes += message->length();
+            entry.message = std::move(message);
+            ++impl_->dropped;
+            return true;
+        } else
+        {
+            impl_->bytes -= entry.message->length();
+            (void)impl_->entries.erase(conflatedEntry->second);
+            (void)impl_->conflatedEntries.erase(conflatedEntry);
+            ++impl_->dropped;
+        }
+    }
+
+    if (policy == SlowConsumerPolicy::Disconnect)
+    {
+        if ((impl_->entries.size() + 1 > impl_->messageLimit) ||
+            (impl_->bytes + message->length() > impl_->byteLimit))
+        {
+            impl_->dropped += impl_->entries.size() + 1;
+            impl_->entries.clear();
+            impl_->conflatedEntries.clear();
+            impl_->bytes = 0;
+            impl_->overflowed = true;
+            return false;
+        }
+    }
+    Entry entry;
+    entry.topic = topic;
+    entry.conflated = (policy == SlowConsumerPolicy::Conflate);
+    impl_->bytes += message->length();
+    entry.message = std::move(message);
+    impl_->entries.push_back(std::move(entry));
+    if (impl_->entries.back().conflated)
+    { impl_->conflatedEntries[topic] = std::prev(impl_->entries.end()); }
+    while (impl_->IsOverLimits() && (impl_->entries.size() > 1))
+    {
+        impl_->PopFront();
+        ++impl_->dropped;
+    }
+    return true;
+}
+
+void OutboundQueue::SetWindow(size_t windowBytes, MarkDelegate markDelegate) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    impl_->windowBytes = windowBytes;
+    impl_->markDelegate = markDelegate;
+}
+
+bool OutboundQueue::Acknowledge(size_t mark) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if ((mark > impl_->acknowledgedBytes) && (mark <= impl_->sentBytes))
+    { impl_->acknowledgedBytes = mark; }
+    return !impl_->entries.empty();
+}
+
+void OutboundQueue::Flush() {
+    std::unique_lock<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (impl_->sending)
+    { return; }
+    impl_->sending = true;
+    const auto sentBytes = impl_->sentBytes;
+    for (;;)
+    {
+        if (impl_->overflowed && !impl_->disconnected)
+        {
+            impl_->disconnected = true;
+            lock.unlock();
+            impl_->disconnectDelegate();
+            lock.lock();
+        }
+        if (impl_->entries.empty() || impl_->IsWindowFull())
+        { break; }
+        const auto message = impl_->entries.front().message;
+        impl_->PopFront();
+        impl_->sentBytes += message->length();
+        lock.unlock();
+        impl_->sendDelegate(*message);
+        lock.lock();
+    }
+    if ((impl_->sentBytes != sentBytes) && impl_->markDelegate)
+    {
+        const auto mark = impl_->sentBytes;
+        lock.unlock();
+        impl_->markDelegate(mark);
+        lock.lock();
+    }
+    impl_->sending = false;
+}
+
+size_t OutboundQueue::GetDroppedCount() const {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    return impl_->dropped;
+}
@@ -0,0 +1,212 @@
+#ifndef MQTT_PLUGIN_OUTBOUND_QUEUE_HPP
+#define MQTT_PLUGIN_OUTBOUND_QUEUE_HPP
+
+/**
+ * @file OutboundQueue.hpp
+ *
+ * This module declares the OutboundQueue class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * This class holds the messages waiting to be sent to one mqttPoint.
+ * Messages are encoded once and shared between the queues of all the
+ * mqttPoints they're sent to.
+ *
+ * Messages are pushed by the threads receiving them from the brokers,
+ * and sent later, by calling Flush from another thread. Whichever thread
+ * flushes the queue first sends all the messages queued, including those
+ * pushed while it's sending, while other threads flushing the same queue
+ * return immediately.
+ *
+ * Both the number of messages queued and the number of bytes they hold
+ * are bounded. Each message is pushed with the policy of the subscription
+ * it's sent for, which decides what happens when the queue is full.
+ *
+ * Sending a message only hands it over to be delivered, so the queue
+ * may also be given a window: the number of bytes sent which the
+ * mqttPoint may not have received yet. Once the window is full, messages
+ * stay in the queue, under its limits and policies, until the mqttPoint
+ * acknowledges receiving the bytes sent up to a mark the queue asked
+ * it to acknowledge.
+ */
+class OutboundQueue
+{
+    // Types
+public:
+    /**
+     * This is the type of message held in the queue.
+     */
+    typedef std::shared_ptr<const std::string> Message;
+
+    /**
+     * These are the ways to deal with a mqttPoint which doesn't take
+     * messages as fast as they're sent to it.
+     */
+    enum class SlowConsumerPolicy
+    {
+        /**
+         * Drop the oldest messages queued to make room for the new one.
+         */
+        DropOldest,
+
+        /**
+         * Drop all messages queued and disconnect the mqttPoint.
+         */
+        Disconnect,
+
+        /**
+         * Replace the message queued for the same topic, if any, so that
+         * only the latest message of each topic waits to be sent. Once
+         * the queue is full anyway, drop the oldest messages queued.
+         */
+        Conflate,
+    };
+
+    /**
+     * This is the type of function called to send one message to the mqttPoint.
+     *
+     * @param[in] message
+     *      This is the message to send.
+     */
+    typedef std::function<void(const std::string& message)> SendDelegate;
+
+    /**
+     * This is the type of function called to disconnect the mqttPoint.
+     */
+    typedef std::function<void()> DisconnectDelegate;
+
+    /**
+     * This is the type of function called, after sending messages,
+     * to have the mqttPoint acknowledge once it received them.
+     *
+     * @param[in] mark
+     *      This is the number of bytes sent so far, to be given
+     *      back to Acknowledge once the mqttPoint received them.
+     */
+    typedef std::function<void(size_t mark)> MarkDelegate;
+
+    // Lifecycle Methods
+public:
+    ~OutboundQueue() noexcept;
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue(OutboundQueue&&) noexcept = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(OutboundQueue&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] messageLimit
+     *      This is the maximum number of messages to hold in the queue.
+     *
+     * @param[in] byteLimit
+     *      This is the maximum number of bytes the messages held
+     *      in the queue may add up to. A single message larger than
+     *      this is still queued, once all others are dropped.
+     *
+     * @param[in] sendDelegate
+     *      This is the function to call to send one message to the mqttPoint.
+     *
+     * @param[in] disconnectDelegate
+     *      This is the function to call to disconnect the mqttPoint.
+     */
+    OutboundQueue(size_t messageLimit, size_t byteLimit, SendDelegate sendDelegate,
+                  DisconnectDelegate disconnectDelegate);
+
+    /**
+     * This method adds the given message to the end of the queue,
+     * or in place of the message queued for the same topic,
+     * if the given policy is to conflate messages.
+     *
+     * @param[in] topic
+     *      This is the topic on which the message was published.
+     *
+     * @param[in] message
+     *      This is the message to add.
+     *
+     * @param[in] policy
+     *      This is how to deal with the queue being full.
+     *
+     * @return
+     *      An indication of whether or not the mqttPoint is still taking
+     *      messages is returned. It isn't once the queue overflowed
+     *      under the policy of disconnecting the mqttPoint.
+     */
+    bool Push(const std::string& topic, Message message, SlowConsumerPolicy policy);
+
+    /**
+     * This method limits the number of bytes sent which the mqttPoint
+     * hasn't acknowledged receiving yet.
+     *
+     * @param[in] windowBytes
+     *      This is the maximum number of bytes sent which the mqttPoint
+     *      may not have acknowledged. Once it's reached, no more messages
+     *      are sent until the mqttPoint acknowledges some. A message is
+     *      always sent once every one sent before it was acknowledged.
+     *      Zero means there's no limit.
+     *
+     * @param[in] markDelegate
+     *      This is the function to call after sending messages,
+     *      to have the mqttPoint acknowledge once it received them.
+     */
+    void SetWindow(size_t windowBytes, MarkDelegate markDelegate);
+
+    /**
+     * This method records that the mqttPoint received the bytes sent
+     * up to the given mark.
+     *
+     * @param[in] mark
+     *      This is the mark given to the function called to have
+     *      the mqttPoint acknowledge receiving the messages sent.
+     *
+     * @return
+     *      An indication of whether or not messages are waiting
+     *      to be sent, so that the queue needs flushing, is returned.
+     */
+    bool Acknowledge(size_t mark);
+
+    /**
+     * This method sends the messages in the queue, as far as the
+     * window allows, unless another thread is already doing so,
+     * and disconnects the mqttPoint if the queue overflowed
+     * under the policy of doing so.
+     *
+     * This must not be called while holding a lock that
+     * the functions given to the constructor take.
+     */
+    void Flush();
+
+    /**
+     * This method returns the number of messages dropped, either
+     * because the queue was full or because they were conflated.
+     *
+     * @return
+     *      The number of messages dropped is returned.
+     */
+    size_t GetDroppedCount() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* MQTT_PLUGIN_OUTBOUND_QUEUE_HPP */
@@ -0,0 +1,378 @@
+/**
+ * @file TopicFilterTrie.cpp
+ *
+ * This module contains the implementation of the TopicFilterTrie class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include "TopicFilterTrie.hpp"
+#include <algorithm>
+
+namespace
+{
+    /**
+     * This is the character separating the levels of topics
+     * and topic filters.
+     */
+    constexpr char LEVEL_SEPARATOR = '/';
+
+    /**
+     * This is the topic filter level matching any one level of a topic.
+     */
+    constexpr char SINGLE_LEVEL_WILDCARD = '+';
+
+    /**
+     * This is the topic filter level matching any number of levels
+     * of a topic, including none.
+     */
+    constexpr char MULTI_LEVEL_WILDCARD = '#';
+
+    /**
+     * This is one level of the topic filters held in the trie.
+     */
+    struct Node
+    {
+        /**
+         * This is the level of the topic filters matched by this node.
+         */
+        std::string level;
+
+        /**
+         * These are the nodes for the levels following this one,
+         * other than the single-level wildcard, sorted by level.
+         */
+        std::vector<std::unique_ptr<Node>> children;
+
+        /**
+         * This is the node for the single-level wildcard following
+         * this level, or nullptr if no filter has one here.
+         */
+        std::unique_ptr<Node> anyLevel;
+
+        /**
+         * These are the sessions subscribed to the topic filter ending
+         * with this level, sorted by session ID.
+         */
+        std::vector<unsigned int> sessionIds;
+
+        /**
+         * These are the sessions subscribed to the topic filter ending
+         * with this level followed by the multi-level wildcard,
+         * sorted by session ID.
+         */
+        std::vector<unsigned int> remainingLevelsSessionIds;
+
+        /**
+         * This method indicates whether or not the node can be let go,
+         * because no topic filter goes through it anymore.
+         *
+         * @return
+         *      An indication of whether or not the node
+         *      can be let go is returned.
+         */
+        bool IsEmpty() const {
+            return (children.empty() && (anyLevel == nullptr) && sessionIds.empty() &&
+                    remainingLevelsSessionIds.empty());
+        }
+    };
+
+    /**
+     * This makes a copy of the given node, along with
+     * all the nodes under it.
+     *
+     * @param[in] node
+     *      This is the node to copy.
+     *
+     * @return
+     *      The copy of the node is returned.
+     */
+    std::unique_ptr<Node> CloneNode(const Node& node) {
+        std::unique_ptr<Node> clone(new Node());
+        clone->level = node.level;
+        clone->children.reserve(node.children.size());
+        for (const auto& child : node.children)
+        { clone->children.push_back(CloneNode(*child)); }
+        if (node.anyLevel != nullptr)
+        { clone->anyLevel = CloneNode(*node.anyLevel); }
+        clone->sessionIds = node.sessionIds;
+        clone->remainingLevelsSessionIds = node.remainingLevelsSessionIds;
+        return clone;
+    }
+
+    /**
+     * This returns the position in the given node's children at which
+     * the child with the given level is, or would be.
+     *
+     * @param[in] node
+     *      This is the node whose children to search.
+     *
+     * @param[in] level
+     *      This points to the level to find.
+     *
+     * @param[in] length
+     *      This is the length of the level to find.
+     *
+     * @return
+     *      The position of the child is returned.
+     */
+    std::vector<std::unique_ptr<Node>>::const_iterator FindChild(const Node& node,
+                                                                 const char* level,
+                                                                 size_t length) {
+        return std::lower_bound(node.children.begin(), node.children.end(), level,
+                                [length](const std::unique_ptr<Node>& child, const char* level)
+                                { return (child->level.compare(0, child->level.length(), level,
+                                                               length) < 0); });
+    }
+
+    /**
+     * This adds the given session ID to the given sorted list,
+     * unless it's already in it.
+     *
+     * @param[in, out] sessionIds
+     *      This is the list to which to add the session ID.
+     *
+     * @param[in] sessionId
+     *      This is the session ID to add.
+     */
+    void InsertSessionId(std::vector<unsigned int>& sessionIds, unsigned int sessionId) {
+        const auto position = std::lower_bound(sessionIds.begin(), sessionIds.end(), sessionId);
+        if ((position == sessionIds.end()) || (*position != sessionId))
+        { (void)sessionIds.insert(position, sessionId); }
+    }
+
+    /**
+     * This takes the given session ID out of the given sorted list.
+     *
+     * @param[in, out] sessionIds
+     *      This is the list from which to take the session ID.
+     *
+     * @param[in] sessionId
+     *      This is the session ID to take out.
+     *
+     * @return
+     *      An indication of whether or not the session ID
+     *      was in the list is returned.
+     */
+    bool EraseSessionId(std::vector<unsigned int>& sessionIds, unsigned int sessionId) {
+        const auto position = std::lower_bound(sessionIds.begin(), sessionIds.end(), sessionId);
+        if ((position == sessionIds.end()) || (*position != sessionId))
+        { return false; }
+        (void)sessionIds.erase(position);
+        return true;
+    }
+
+    /**
+     * This checks that the given topic filter is well formed, with
+     * wildcards taking up whole levels, and the multi-level wildcard
+     * only as the last level.
+     *
+     * @param[in] filter
+     *      This is the topic filter to check.
+     *
+     * @return
+     *      An indication of whether or not the topic filter
+     *      is well formed is returned.
+     */
+    bool IsValidFilter(const std::string& filter) {
+        if (filter.empty())
+        { return false; }
+        for (size_t i = 0; i < filter.length(); ++i)
+        {
+            if ((filter[i] != SINGLE_LEVEL_WILDCARD) && (filter[i] != MULTI_LEVEL_WILDCARD))
+            { continue; }
+            if ((i > 0) && (filter[i - 1] != LEVEL_SEPARATOR))
+            { return false; }
+            if (filter[i] == MULTI_LEVEL_WILDCARD)
+            {
+                if (i + 1 != filter.length())
+                { return false; }
+            } else if ((i + 1 < filter.length()) && (filter[i + 1] != LEVEL_SEPARATOR))
+            { return false; }
+        }
+        return true;
+    }
+
+    /**
+     * This adds to the given list the sessions subscribed to topic filters
+     * held under the given node which match the rest of the given topic.
+     *
+     * @param[in] node
+     *      This is the node matching the levels of the topic
+     *      before the given position.
+     *
+     * @param[in] topic
+     *      This points to the topic to match.
+     *
+     * @param[in] length
+     *      This is the length of the topic.
+     *
+     * @param[in] position
+     *      This is the position in the topic of the next level to match.
+     *
+     * @param[in] finished
+     *      This indicates whether or not every level
+     *      of the topic has been matched.
+     *
+     * @param[in, out] sessionIds
+     *      This is the list to which to add the sessions found.
+     */
+    void Collect(const Node& node, const char* topic, size_t length, size_t position,
+                 bool finished, std::vector<unsigned int>& sessionIds) {
+        const auto isSystemTopic = ((position == 0) && (length > 0) && (topic[0] == '$'));
+        if (!isSystemTopic)
+        {
+            sessionIds.insert(sessionIds.end(), node.remainingLevelsSessionIds.begin(),
+                              node.remainingLevelsSessionIds.end());
+        }
+        if (finished)
+        {
+            sessionIds.insert(sessionIds.end(), node.sessionIds.begin(), node.sessionIds.end());
+            return;
+        }
+        auto levelEnd = position;
+        while ((levelEnd < length) && (topic[levelEnd] != LEVEL_SEPARATOR))
+        { ++levelEnd; }
+        const auto levelLength = levelEnd - position;
+        const auto child = FindChild(node, topic + position, levelLength);
+        if ((child != node.children.end()) &&
+            ((*child)->level.compare(0, (*child)->level.length(), topic + position,
+                                     levelLength) == 0))
+        { Collect(**child, topic, length, levelEnd + 1, (levelEnd == length), sessionIds); }
+        if ((node.anyLevel != nullptr) && !isSystemTopic)
+        {
+            Collect(*node.anyLevel, topic, length, levelEnd + 1, (levelEnd == length),
+                    sessionIds);
+        }
+    }
+}  // namespace
+
+struct TopicFilterTrie::Impl
+{
+    // Properties
+
+    /**
+     * This is the node before the first level of every topic filter.
+     */
+    std::unique_ptr<Node> root = std::unique_ptr<Node>(new Node());
+};
+
+TopicFilterTrie::~TopicFilterTrie() noexcept = default;
+
+TopicFilterTrie::TopicFilterTrie(const TopicFilterTrie& other) : impl_(new Impl()) {
+    impl_->root = CloneNode(*other.impl_->root);
+}
+
+TopicFilterTrie::TopicFilterTrie(TopicFilterTrie&&) noexcept = default;
+TopicFilterTrie& TopicFilterTrie::operator=(const TopicFilterTrie& other) {
+    if (this != &other)
+    { impl_->root = CloneNode(*other.impl_->root); }
+    return *this;
+}
+
+TopicFilterTrie& TopicFilterTrie::operator=(TopicFilterTrie&&) noexcept = default;
+
+TopicFilterTrie::TopicFilterTrie() : impl_(new Impl()) {}
+
+bool TopicFilterTrie::Add(const std::string& filter, unsigned int sessionId) {
+    if (!IsValidFilter(filter))
+    { return false; }
+    auto node = impl_->root.get();
+    size_t position = 0;
+    for (;;)
+    {
+        auto levelEnd = filter.find(LEVEL_SEPARATOR, position);
+        if (levelEnd == std::string::npos)
+        { levelEnd = filter.length(); }
+        const auto level = filter.substr(position, levelEnd - position);
+        if (level[0] == MULTI_LEVEL_WILDCARD)
+        {
+            InsertSessionId(node->remainingLevelsSessionIds, sessionId);
+            return true;
+        }
+        if (level[0] == SINGLE_LEVEL_WILDCARD)
+        {
+            if (node->anyLevel == nullptr)
+            { node->anyLevel.reset(new Node()); }
+            node = node->anyLevel.get();
+        } else
+        {
+            auto child = FindChild(*node, level.data(), level.length());
+            if ((child == node->children.end()) || ((*child)->level != level))
+            {
+                std::unique_ptr<Node> newChild(new Node());
+                newChild->level = level;
+                child = node->children.insert(child, std::move(newChild));
+            }
+            node = child->get();
+        }
+        if (levelEnd == filter.length())
+        { break; }
+        position = levelEnd + 1;
+    }
+    InsertSessionId(node->sessionIds, sessionId);
+    return true;
+}
+
+bool TopicFilterTrie::Remove(const std::string& filter, unsigned int sessionId) {
+    if (!IsValidFilter(filter))
+    { return false; }
+    std::vector<Node*> path(1, impl_->root.get());
+    size_t position = 0;
+    bool removed = false;
+    for (;;)
+    {
+        const auto node = path.back();
+        auto levelEnd = filter.find(LEVEL_SEPARATOR, position);
+        if (levelEnd == std::string::npos)
+        { levelEnd = filter.length(); }
+        const auto level = filter.substr(position, levelEnd - position);
+        if (level[0] == MULTI_LEVEL_WILDCARD)
+        {
+            removed = EraseSessionId(node->remainingLevelsSessionIds, sessionId);
+            break;
+        }
+        Node* next = nullptr;
+        if (level[0] == SINGLE_LEVEL_WILDCARD)
+        {
+            next = node->anyLevel.get();
+        } else
+        {
+            const auto child = FindChild(*node, level.data(), level.length());
+            if ((child != node->children.end()) && ((*child)->level == level))
+            { next = child->get(); }
+        }
+        if (next == nullptr)
+        { return false; }
+        path.push_back(next);
+        if (levelEnd == filter.length())
+        {
+            removed = EraseSessionId(next->sessionIds, sessionId);
+            break;
+        }
+        position = levelEnd + 1;
+    }
+
+    // Let go of the nodes no other topic filter goes through.
+    for (auto i = path.size() - 1; (i > 0) && path[i]->IsEmpty(); --i)
+    {
+        const auto parent = path[i - 1];
+        if (parent->anyLevel.get() == path[i])
+        {
+            parent->anyLevel = nullptr;
+        } else
+        {
+            const auto child = FindChild(*parent, path[i]->level.data(), path[i]->level.length());
+            (void)parent->children.erase(child);
+        }
+    }
+    return removed;
+}
+
+void TopicFilterTrie::Match(const char* topic, size_t length,
+                            std::vector<unsigned int>& sessionIds) const {
+    sessionIds.clear();
+    Collect(*impl_->root, topic, length, 0, false, sessionIds);
+    std::sort(sessionIds.begin(), sessionIds.end());
+    sessionIds.erase(std::unique(sessionIds.begin(), sessionIds.end()), sessionIds.end());
+}
@@ -0,0 +1,111 @@
+#ifndef MQTT_PLUGIN_TOPIC_FILTER_TRIE_HPP
+#define MQTT_PLUGIN_TOPIC_FILTER_TRIE_HPP
+
+/**
+ * @file TopicFilterTrie.hpp
+ *
+ * This module declares the TopicFilterTrie class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds the MQTT topic filters which sessions subscribed to,
+ * in a tree with one level of the filters per level of the tree, so that
+ * the sessions subscribed to filters matching a topic are found by walking
+ * down the levels of the topic, rather than by matching the topic against
+ * every filter.
+ *
+ * Filters may hold the single-level wildcard "+" and, as their last
+ * level, the multi-level wildcard "#". As the MQTT specification requires,
+ * topics whose first level starts with "$" are only matched by filters
+ * whose first level isn't a wildcard.
+ *
+ * Copying the trie copies all its topic filters, so that a copy can be
+ * changed and then shared, unchanged from then on, between threads.
+ */
+class TopicFilterTrie
+{
+    // Lifecycle Methods
+public:
+    ~TopicFilterTrie() noexcept;
+    TopicFilterTrie(const TopicFilterTrie& other);
+    TopicFilterTrie(TopicFilterTrie&&) noexcept;
+    TopicFilterTrie& operator=(const TopicFilterTrie& other);
+    TopicFilterTrie& operator=(TopicFilterTrie&&) noexcept;
+
+    // Public methods
+public:
+    /**
+     * This is the default constructor.
+     */
+    TopicFilterTrie();
+
+    /**
+     * This method subscribes the given session to the given topic filter.
+     *
+     * @param[in] filter
+     *      This is the topic filter to which to subscribe the session.
+     *
+     * @param[in] sessionId
+     *      This is the session ID of the session to subscribe.
+     *
+     * @return
+     *      An indication of whether or not the topic filter
+     *      is valid is returned.
+     */
+    bool Add(const std::string& filter, unsigned int sessionId);
+
+    /**
+     * This method unsubscribes the given session from the given topic filter.
+     *
+     * @param[in] filter
+     *      This is the topic filter from which to unsubscribe the session.
+     *
+     * @param[in] sessionId
+     *      This is the session ID of the session to unsubscribe.
+     *
+     * @return
+     *      An indication of whether or not the session
+     *      was subscribed to the topic filter is returned.
+     */
+    bool Remove(const std::string& filter, unsigned int sessionId);
+
+    /**
+     * This method finds the sessions subscribed to any topic filter
+     * matching the given topic. Nothing is allocated once the given
+     * vector has grown to hold the sessions found.
+     *
+     * @param[in] topic
+     *      This points to the topic to match.
+     *
+     * @param[in] length
+     *      This is the length of the topic.
+     *
+     * @param[out] sessionIds
+     *      This is where to store the session IDs of the sessions found,
+     *      in increasing order and without duplicates.
+     */
+    void Match(const char* topic, size_t length, std::vector<unsigned int>& sessionIds) const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* MQTT_PLUGIN_TOPIC_FILTER_TRIE_HPP */
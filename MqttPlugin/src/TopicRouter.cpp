@@ -0,0 +1,166 @@
+/**
+ * @file TopicRouter.cpp
+ *
+ * This module contains the implementation of the TopicRouter class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include "TopicRouter.hpp"
+#include <algorithm>
+#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /**
+     * This is the number of points each connection has on a hash ring,
+     * so that topic filters are spread evenly between connections.
+     */
+    constexpr size_t POINTS_PER_CONNECTION = 64;
+
+    /**
+     * This computes the 32-bit FNV-1a hash of the given string, mixed
+     * further so that strings differing only in their last characters,
+     * such as the keys of the points of a connection, spread evenly.
+     *
+     * @param[in] key
+     *      This is the string to hash.
+     *
+     * @return
+     *      The hash of the string is returned.
+     */
+    uint32_t Hash(const std::string& key) {
+        uint32_t hash = 2166136261u;
+        for (const auto c : key)
+        {
+            hash ^= (uint8_t)c;
+            hash *= 16777619u;
+        }
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    /**
+     * This is a hash ring on which connections are placed, so that
+     * each topic filter goes to the connection of the first point
+     * of the ring at or after the hash of the topic filter.
+     */
+    struct HashRing
+    {
+        /**
+         * These are the points of the ring, along with the connection
+         * to which each belongs, sorted by point.
+         */
+        std::vector<std::pair<uint32_t, size_t>> points;
+
+        /**
+         * This method places the given connection on the ring.
+         *
+         * @param[in] key
+         *      This uniquely identifies the connection,
+         *      whatever the order connections are added.
+         *
+         * @param[in] connection
+         *      This is the number of the connection.
+         */
+        void Add(const std::string& key, size_t connection) {
+            for (size_t i = 0; i < POINTS_PER_CONNECTION; ++i)
+            { points.emplace_back(Hash(key + "#" + std::to_string(i)), connection); }
+            std::sort(points.begin(), points.end());
+        }
+
+        /**
+         * This method returns the connection to which
+         * the given topic filter goes.
+         *
+         * @param[in] filter
+         *      This is the topic filter to place.
+         *
+         * @return
+         *      The number of the connection is returned.
+         */
+        size_t Find(const std::string& filter) const {
+            if (points.empty())
+            { return 0; }
+            const auto hash = Hash(filter);
+            auto point = std::lower_bound(points.begin(), points.end(),
+                                          std::make_pair(hash, (size_t)0));
+            if (point == points.end())
+            { point = points.begin(); }
+            return point->second;
+        }
+    };
+}  // namespace
+
+struct TopicRouter::Impl
+{
+    // Properties
+
+    /**
+     * These are the hash rings of the connections
+     * of each broker, keyed by broker name.
+     */
+    std::map<std::string, HashRing> brokers;
+
+    /**
+     * This is the hash ring of the connections of every broker.
+     */
+    HashRing anyBroker;
+
+    /**
+     * This is the number of connections added so far.
+     */
+    size_t connections = 0;
+
+    /**
+     * These are the names of the brokers to which topic filters
+     * starting with each prefix go, keyed by prefix.
+     */
+    std::map<std::string, std::string> routes;
+};
+
+TopicRouter::~TopicRouter() noexcept = default;
+TopicRouter::TopicRouter(TopicRouter&&) noexcept = default;
+TopicRouter& TopicRouter::operator=(TopicRouter&&) noexcept = default;
+
+TopicRouter::TopicRouter() : impl_(new Impl()) {}
+
+bool TopicRouter::AddBroker(const std::string& name, size_t connections) {
+    if ((connections == 0) || (impl_->brokers.find(name) != impl_->brokers.end()))
+    { return false; }
+    auto& ring = impl_->brokers[name];
+    for (size_t i = 0; i < connections; ++i)
+    {
+        const auto key = name + "/" + std::to_string(i);
+        ring.Add(key, impl_->connections);
+        impl_->anyBroker.Add(key, impl_->connections);
+        ++impl_->connections;
+    }
+    return true;
+}
+
+bool TopicRouter::AddRoute(const std::string& prefix, const std::string& broker) {
+    if (impl_->brokers.find(broker) == impl_->brokers.end())
+    { return false; }
+    impl_->routes[prefix] = broker;
+    return true;
+}
+
+size_t TopicRouter::Route(const std::string& filter) const {
+    // Prefixes of the filter sort before it, so the longest one
+    // is found by walking back from where the filter would be.
+    for (auto route = impl_->routes.upper_bound(filter); route != impl_->routes.begin();)
+    {
+        --route;
+        if (filter.compare(0, route->first.length(), route->first) == 0)
+        { return impl_->brokers.find(route->second)->second.Find(filter); }
+    }
+    return impl_->anyBroker.Find(filter);
+}
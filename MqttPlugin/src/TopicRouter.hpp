@@ -0,0 +1,105 @@
+#ifndef MQTT_PLUGIN_TOPIC_ROUTER_HPP
+#define MQTT_PLUGIN_TOPIC_ROUTER_HPP
+
+/**
+ * @file TopicRouter.hpp
+ *
+ * This module declares the TopicRouter class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+
+/**
+ * This class picks which of the connections to the brokers subscribes
+ * to each topic filter.
+ *
+ * Connections are numbered in the order their brokers are added, each
+ * broker holding a contiguous range of them. A topic filter starting with
+ * the prefix of a route goes to the broker of the longest such prefix.
+ * Any other topic filter may go to any broker. Among the connections
+ * a topic filter may go to, one is picked by consistent hashing, so that
+ * a topic filter always goes to the same connection, and adding
+ * connections only moves a share of the topic filters.
+ */
+class TopicRouter
+{
+    // Lifecycle Methods
+public:
+    ~TopicRouter() noexcept;
+    TopicRouter(const TopicRouter&) = delete;
+    TopicRouter(TopicRouter&&) noexcept;
+    TopicRouter& operator=(const TopicRouter&) = delete;
+    TopicRouter& operator=(TopicRouter&&) noexcept;
+
+    // Public methods
+public:
+    /**
+     * This is the default constructor.
+     */
+    TopicRouter();
+
+    /**
+     * This method adds a broker, along with its connections, which are
+     * numbered after those of the brokers added before it.
+     *
+     * @param[in] name
+     *      This is the name of the broker, by which routes refer to it.
+     *
+     * @param[in] connections
+     *      This is the number of connections to the broker.
+     *
+     * @return
+     *      An indication of whether or not the broker was added
+     *      is returned. It isn't if another broker has the same name,
+     *      or it has no connections.
+     */
+    bool AddBroker(const std::string& name, size_t connections);
+
+    /**
+     * This method sends topic filters starting with the given prefix
+     * to the given broker.
+     *
+     * @param[in] prefix
+     *      This is the start of the topic filters to route.
+     *
+     * @param[in] broker
+     *      This is the name of the broker to which to route them.
+     *
+     * @return
+     *      An indication of whether or not the route was added
+     *      is returned. It isn't if no broker has the given name.
+     */
+    bool AddRoute(const std::string& prefix, const std::string& broker);
+
+    /**
+     * This method returns the connection which subscribes
+     * to the given topic filter.
+     *
+     * @param[in] filter
+     *      This is the topic filter to route.
+     *
+     * @return
+     *      The number of the connection is returned.
+     */
+    size_t Route(const std::string& filter) const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* MQTT_PLUGIN_TOPIC_ROUTER_HPP */
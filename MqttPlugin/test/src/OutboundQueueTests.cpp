@@ -0,0 +1,160 @@
+/**
+ * @file OutboundQueueTests.cpp
+ *
+ * This module contains unit tests of the
+ * OutboundQueue class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <gtest/gtest.h>
+#include <OutboundQueue.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /**
+     * This makes a message to queue.
+     *
+     * @param[in] content
+     *      This is the content of the message.
+     *
+     * @return
+     *      The message is returned.
+     */
+    OutboundQueue::Message MakeMessage(const std::string& content) {
+        return std::make_shared<const std::string>(content);
+    }
+}  // namespace
+
+struct OutboundQueueTests : public ::testing::Test
+{
+    // Properties
+
+    /**
+     * These are the messages sent by the unit under test.
+     */
+    std::vector<std::string> messagesSent;
+
+    /**
+     * This indicates whether or not the unit under test
+     * disconnected the mqttPoint.
+     */
+    bool disconnected = false;
+
+    /**
+     * This is the unit under test, holding at most 3 messages,
+     * adding up to at most 100 bytes.
+     */
+    OutboundQueue queue{3, 100, [this](const std::string& message)
+                        { messagesSent.push_back(message); }, [this] { disconnected = true; }};
+};
+
+TEST_F(OutboundQueueTests, SendMessagesInOrder) {
+    EXPECT_TRUE(queue.Push("a", MakeMessage("1"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    EXPECT_TRUE(queue.Push("b", MakeMessage("2"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"1", "2"}), messagesSent);
+    messagesSent.clear();
+    queue.Flush();
+    EXPECT_TRUE(messagesSent.empty());
+    EXPECT_EQ(0, queue.GetDroppedCount());
+}
+
+TEST_F(OutboundQueueTests, DropOldestMessagesWhenFull) {
+    for (size_t i = 0; i < 5; ++i)
+    {
+        EXPECT_TRUE(queue.Push("a", MakeMessage(std::to_string(i)),
+                               OutboundQueue::SlowConsumerPolicy::DropOldest));
+    }
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"2", "3", "4"}), messagesSent);
+    EXPECT_EQ(2, queue.GetDroppedCount());
+    EXPECT_FALSE(disconnected);
+}
+
+TEST_F(OutboundQueueTests, DropOldestMessagesPastByteLimit) {
+    EXPECT_TRUE(queue.Push("a", MakeMessage(std::string(60, 'a')),
+                           OutboundQueue::SlowConsumerPolicy::DropOldest));
+    EXPECT_TRUE(queue.Push("b", MakeMessage(std::string(60, 'b')),
+                           OutboundQueue::SlowConsumerPolicy::DropOldest));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{std::string(60, 'b')}), messagesSent);
+    EXPECT_EQ(1, queue.GetDroppedCount());
+}
+
+TEST_F(OutboundQueueTests, ConflateMessagesOfSameTopic) {
+    for (size_t i = 0; i < 10; ++i)
+    {
+        EXPECT_TRUE(queue.Push("a", MakeMessage("a" + std::to_string(i)),
+                               OutboundQueue::SlowConsumerPolicy::Conflate));
+    }
+    EXPECT_TRUE(queue.Push("b", MakeMessage("b0"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"a9", "b0"}), messagesSent);
+    EXPECT_FALSE(disconnected);
+}
+
+TEST_F(OutboundQueueTests, ConflateBehindLaterMessageOfSameTopic) {
+    EXPECT_TRUE(queue.Push("a", MakeMessage("1"), OutboundQueue::SlowConsumerPolicy::Conflate));
+    EXPECT_TRUE(queue.Push("a", MakeMessage("2"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    EXPECT_TRUE(queue.Push("a", MakeMessage("3"), OutboundQueue::SlowConsumerPolicy::Conflate));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"2", "3"}), messagesSent);
+    EXPECT_EQ(1, queue.GetDroppedCount());
+}
+
+TEST_F(OutboundQueueTests, DisconnectOnOverflow) {
+    for (size_t i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(
+            queue.Push("a", MakeMessage("a"), OutboundQueue::SlowConsumerPolicy::Disconnect));
+    }
+    EXPECT_FALSE(queue.Push("a", MakeMessage("a"), OutboundQueue::SlowConsumerPolicy::Disconnect));
+    EXPECT_FALSE(queue.Push("b", MakeMessage("b"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    EXPECT_FALSE(disconnected);
+    queue.Flush();
+    EXPECT_TRUE(disconnected);
+    EXPECT_TRUE(messagesSent.empty());
+}
+
+TEST_F(OutboundQueueTests, HoldMessagesPastWindowUntilAcknowledged) {
+    std::vector<size_t> marks;
+    queue.SetWindow(2, [&marks](size_t mark) { marks.push_back(mark); });
+    EXPECT_TRUE(queue.Push("a", MakeMessage("1"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    EXPECT_TRUE(queue.Push("b", MakeMessage("2"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    EXPECT_TRUE(queue.Push("c", MakeMessage("3"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"1", "2"}), messagesSent);
+    EXPECT_EQ((std::vector<size_t>{2}), marks);
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"1", "2"}), messagesSent);
+    EXPECT_EQ((std::vector<size_t>{2}), marks);
+    EXPECT_TRUE(queue.Acknowledge(2));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"1", "2", "3"}), messagesSent);
+    EXPECT_EQ((std::vector<size_t>{2, 3}), marks);
+    EXPECT_FALSE(queue.Acknowledge(3));
+}
+
+TEST_F(OutboundQueueTests, ApplyPolicyToMessagesHeldPastWindow) {
+    queue.SetWindow(1, [](size_t) {});
+    EXPECT_TRUE(queue.Push("a", MakeMessage("1"), OutboundQueue::SlowConsumerPolicy::DropOldest));
+    queue.Flush();
+    for (size_t i = 2; i < 7; ++i)
+    {
+        EXPECT_TRUE(queue.Push("a", MakeMessage(std::to_string(i)),
+                               OutboundQueue::SlowConsumerPolicy::DropOldest));
+        queue.Flush();
+    }
+    EXPECT_EQ((std::vector<std::string>{"1"}), messagesSent);
+    EXPECT_EQ(2, queue.GetDroppedCount());
+    EXPECT_TRUE(queue.Acknowledge(7));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"1"}), messagesSent);
+    EXPECT_TRUE(queue.Acknowledge(1));
+    queue.Flush();
+    EXPECT_EQ((std::vector<std::string>{"1", "4"}), messagesSent);
+}
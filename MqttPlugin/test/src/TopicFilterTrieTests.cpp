@@ -0,0 +1,122 @@
+/**
+ * @file TopicFilterTrieTests.cpp
+ *
+ * This module contains unit tests of the
+ * TopicFilterTrie class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <gtest/gtest.h>
+#include <TopicFilterTrie.hpp>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /**
+     * This returns the sessions subscribed to topic filters
+     * matching the given topic.
+     *
+     * @param[in] trie
+     *      This holds the topic filters.
+     *
+     * @param[in] topic
+     *      This is the topic to match.
+     *
+     * @return
+     *      The session IDs of the sessions found are returned.
+     */
+    std::vector<unsigned int> Match(const TopicFilterTrie& trie, const std::string& topic) {
+        std::vector<unsigned int> sessionIds;
+        trie.Match(topic.data(), topic.length(), sessionIds);
+        return sessionIds;
+    }
+}  // namespace
+
+TEST(TopicFilterTrieTests, MatchExactTopic) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("site/temp", 1));
+    EXPECT_EQ((std::vector<unsigned int>{1}), Match(trie, "site/temp"));
+    EXPECT_TRUE(Match(trie, "site").empty());
+    EXPECT_TRUE(Match(trie, "site/temp/room").empty());
+    EXPECT_TRUE(Match(trie, "site/hum").empty());
+}
+
+TEST(TopicFilterTrieTests, MatchSingleLevelWildcard) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("site/+", 1));
+    EXPECT_TRUE(trie.Add("+/+/room", 2));
+    EXPECT_EQ((std::vector<unsigned int>{1}), Match(trie, "site/temp"));
+    EXPECT_EQ((std::vector<unsigned int>{1}), Match(trie, "site/"));
+    EXPECT_TRUE(Match(trie, "site").empty());
+    EXPECT_EQ((std::vector<unsigned int>{2}), Match(trie, "site/temp/room"));
+    EXPECT_TRUE(Match(trie, "site/temp/hall").empty());
+}
+
+TEST(TopicFilterTrieTests, MatchMultiLevelWildcardIncludingParentLevel) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("site/#", 1));
+    EXPECT_TRUE(trie.Add("#", 2));
+    EXPECT_EQ((std::vector<unsigned int>{1, 2}), Match(trie, "site"));
+    EXPECT_EQ((std::vector<unsigned int>{1, 2}), Match(trie, "site/temp"));
+    EXPECT_EQ((std::vector<unsigned int>{1, 2}), Match(trie, "site/temp/room"));
+    EXPECT_EQ((std::vector<unsigned int>{2}), Match(trie, "other"));
+}
+
+TEST(TopicFilterTrieTests, RejectInvalidFilters) {
+    TopicFilterTrie trie;
+    EXPECT_FALSE(trie.Add("site/temp#", 1));
+    EXPECT_FALSE(trie.Add("site/#/room", 1));
+    EXPECT_FALSE(trie.Add("site/te+", 1));
+    EXPECT_TRUE(Match(trie, "site/temp#").empty());
+}
+
+TEST(TopicFilterTrieTests, KeepDollarTopicsFromLeadingWildcards) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("#", 1));
+    EXPECT_TRUE(trie.Add("+/info", 2));
+    EXPECT_TRUE(trie.Add("$SYS/info", 3));
+    EXPECT_TRUE(trie.Add("$SYS/#", 4));
+    EXPECT_EQ((std::vector<unsigned int>{3, 4}), Match(trie, "$SYS/info"));
+    EXPECT_EQ((std::vector<unsigned int>{1, 2}), Match(trie, "site/info"));
+}
+
+TEST(TopicFilterTrieTests, MatchEachSessionOnce) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("site/temp", 2));
+    EXPECT_TRUE(trie.Add("site/+", 2));
+    EXPECT_TRUE(trie.Add("site/#", 1));
+    EXPECT_TRUE(trie.Add("site/temp", 1));
+    EXPECT_EQ((std::vector<unsigned int>{1, 2}), Match(trie, "site/temp"));
+}
+
+TEST(TopicFilterTrieTests, RemoveSubscriptions) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("site/temp", 1));
+    EXPECT_TRUE(trie.Add("site/temp", 2));
+    EXPECT_TRUE(trie.Add("site/+", 3));
+    EXPECT_TRUE(trie.Remove("site/temp", 1));
+    EXPECT_FALSE(trie.Remove("site/temp", 1));
+    EXPECT_FALSE(trie.Remove("other/temp", 2));
+    EXPECT_EQ((std::vector<unsigned int>{2, 3}), Match(trie, "site/temp"));
+
+    // Once the last subscription is removed, the branches left empty are
+    // pruned, and the same filters may be added again.
+    EXPECT_TRUE(trie.Remove("site/temp", 2));
+    EXPECT_TRUE(trie.Remove("site/+", 3));
+    EXPECT_TRUE(Match(trie, "site/temp").empty());
+    EXPECT_FALSE(trie.Remove("site/+", 3));
+    EXPECT_TRUE(trie.Add("site/temp", 4));
+    EXPECT_EQ((std::vector<unsigned int>{4}), Match(trie, "site/temp"));
+}
+
+TEST(TopicFilterTrieTests, CopyIsIndependent) {
+    TopicFilterTrie trie;
+    EXPECT_TRUE(trie.Add("site/#", 1));
+    auto copy = trie;
+    EXPECT_TRUE(copy.Add("site/temp", 2));
+    EXPECT_TRUE(copy.Remove("site/#", 1));
+    EXPECT_EQ((std::vector<unsigned int>{1}), Match(trie, "site/temp"));
+    EXPECT_EQ((std::vector<unsigned int>{2}), Match(copy, "site/temp"));
+}
@@ -0,0 +1,95 @@
+/**
+ * @file TopicRouterTests.cpp
+ *
+ * This module contains unit tests of the
+ * TopicRouter class.
+ *
+ * © 2025 by Hatem Nabli
+ */
+
+#include <gtest/gtest.h>
+#include <TopicRouter.hpp>
+#include <string>
+#include <vector>
+
+TEST(TopicRouterTests, RouteEverythingToOnlyConnection) {
+    TopicRouter router;
+    EXPECT_EQ(0, router.Route("site/temp"));
+    ASSERT_TRUE(router.AddBroker("main", 1));
+    EXPECT_EQ(0, router.Route("site/temp"));
+    EXPECT_EQ(0, router.Route("#"));
+}
+
+TEST(TopicRouterTests, RejectBadBrokersAndRoutes) {
+    TopicRouter router;
+    EXPECT_TRUE(router.AddBroker("main", 2));
+    EXPECT_FALSE(router.AddBroker("main", 1));
+    EXPECT_FALSE(router.AddBroker("empty", 0));
+    EXPECT_TRUE(router.AddRoute("site/", "main"));
+    EXPECT_FALSE(router.AddRoute("site/", "missing"));
+}
+
+TEST(TopicRouterTests, RouteToBrokerOfLongestPrefix) {
+    TopicRouter router;
+    ASSERT_TRUE(router.AddBroker("a", 2));
+    ASSERT_TRUE(router.AddBroker("b", 3));
+    ASSERT_TRUE(router.AddRoute("site/", "a"));
+    ASSERT_TRUE(router.AddRoute("site/b/", "b"));
+    for (size_t i = 0; i < 100; ++i)
+    {
+        const auto suffix = std::to_string(i);
+        EXPECT_LT(router.Route("site/" + suffix), 2);
+        const auto connection = router.Route("site/b/" + suffix);
+        EXPECT_GE(connection, 2);
+        EXPECT_LT(connection, 5);
+    }
+}
+
+TEST(TopicRouterTests, RouteSameFilterToSameConnection) {
+    TopicRouter router;
+    ASSERT_TRUE(router.AddBroker("a", 4));
+    for (size_t i = 0; i < 100; ++i)
+    {
+        const auto filter = "site/" + std::to_string(i) + "/#";
+        EXPECT_EQ(router.Route(filter), router.Route(filter));
+    }
+}
+
+TEST(TopicRouterTests, SpreadFiltersOverConnections) {
+    TopicRouter router;
+    ASSERT_TRUE(router.AddBroker("a", 2));
+    ASSERT_TRUE(router.AddBroker("b", 3));
+    std::vector<size_t> filtersPerConnection(5);
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        const auto connection = router.Route("site/" + std::to_string(i));
+        ASSERT_LT(connection, filtersPerConnection.size());
+        ++filtersPerConnection[connection];
+    }
+    for (const auto filters : filtersPerConnection)
+    {
+        EXPECT_GT(filters, 1000);
+        EXPECT_LT(filters, 3000);
+    }
+}
+
+TEST(TopicRouterTests, AddingConnectionsMovesOnlyShareOfFilters) {
+    TopicRouter before;
+    ASSERT_TRUE(before.AddBroker("a", 4));
+    TopicRouter after;
+    ASSERT_TRUE(after.AddBroker("a", 4));
+    ASSERT_TRUE(after.AddBroker("b", 1));
+    size_t moved = 0;
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        const auto filter = "site/" + std::to_string(i);
+        const auto connection = after.Route(filter);
+        if (connection != before.Route(filter))
+        {
+            EXPECT_EQ(4, connection);
+            ++moved;
+        }
+    }
+    EXPECT_GT(moved, 1000);
+    EXPECT_LT(moved, 3000);
+}
@@ -0,0 +1,215 @@
+/**
+ * @file StaticContentPluginBenchmarks.cpp
+ *
+ * This module contains benchmarks measuring the throughput of the
+ * resource handler of the StaticContentPlugin, called in-process
+ * with synthetic requests.
+ *
+ * Each benchmark reports requests per second (items_per_second),
+ * bytes of response body per second (bytes_per_second), and the
+ * number of heap allocations made per request (allocs/request).
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <benchmark/benchmark.h>
+#include <StringUtils/StringUtils.hpp>
+#include <SystemUtils/File.hpp>
+#include <WebServer/PluginEntryPoint.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#    define API __declspec(dllimport)
+#else /* POSIX */
+#    define API
+#endif /* _WIN32 / POSIX */
+extern "C" API void LoadPlugin(
+    Http::IServer* server, Json::Value configuration,
+    SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessagedelegate,
+    std::function<void()>& unloadDelegate);
+
+namespace
+{
+    /**
+     * This counts the heap allocations made by the program.
+     */
+    std::atomic<uint64_t> allocations(0);
+
+    /**
+     * These are the sizes of the files served, in bytes.
+     */
+    const std::vector<int64_t> FILE_SIZES = {
+        1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 100 * 1024 * 1024,
+    };
+
+    /**
+     * This is a server which only records the resource delegate
+     * registered by the plug-in.
+     */
+    struct MockServer : public Http::IServer
+    {
+        // Properties
+
+        /**
+         * This is the delegate that the plug-in has registered
+         * to be called to handle resource requests.
+         */
+        ResourceDelegate registredResourceDelegate;
+
+        // IServer
+    public:
+        virtual std::string GetConfigurationItem(const std::string& key) override { return ""; }
+        virtual void SetConfigurationItem(const std::string& key,
+                                          const std::string& value) override {}
+        virtual SystemUtils::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+            SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+            size_t minLevel = 0) override {
+            return []() {};
+        }
+        virtual UnregistrationDelegate RegisterResource(
+            const std::vector<std::string>& resourceSubspacePath,
+            ResourceDelegate resourceDelegate) override {
+            registredResourceDelegate = resourceDelegate;
+            return []() {};
+        }
+    };
+
+    /**
+     * This returns the path of the directory holding the files served.
+     *
+     * @return
+     *      The path of the directory holding the files served is returned.
+     */
+    std::string GetBenchAreaPath() {
+        return SystemUtils::File::GetExeParentDirectory() + "/BenchArea";
+    }
+
+    /**
+     * This writes a file of the given size, along with a gzip sidecar
+     * a quarter of its size, unless they already exist.
+     *
+     * @param[in] size
+     *      This is the size of the file to write, in bytes.
+     *
+     * @return
+     *      The name of the file is returned.
+     */
+    std::string MakeFile(size_t size) {
+        const auto name = StringUtils::sprintf("file%zu.js", size);
+        const auto path = GetBenchAreaPath() + "/" + name;
+        const std::pair<std::string, size_t> files[] = {{path, size}, {path + ".gz", size / 4}};
+        for (const auto& file : files)
+        {
+            SystemUtils::File output(file.first);
+            if (output.IsExisting() && (output.GetSize() == file.second))
+            { continue; }
+            std::string content(file.second, ' ');
+            for (size_t i = 0; i < content.size(); ++i)
+            { content[i] = (char)('a' + (i * 7919) % 26); }
+            (void)output.OpenReadWrite();
+            (void)output.SetSize(0);
+            (void)output.Write(content.data(), content.size());
+            output.Close();
+        }
+        return name;
+    }
+
+    /**
+     * This benchmarks requests for one file, with the file size and
+     * request kind given by the benchmark arguments:
+     *
+     * - range(0): size of the file, in bytes.
+     * - range(1): 1 if the content cache may hold the file (hits after
+     *   the first request), 0 if caching is disabled (every request misses).
+     * - range(2): 1 if requests are conditional on the current entity tag
+     *   (304 responses), 0 if not (200 responses).
+     * - range(3): 1 if requests accept gzip, 0 if not.
+     *
+     * @param[in, out] state
+     *      This is the state of the benchmark.
+     */
+    void ServeFile(benchmark::State& state) {
+        const auto size = (size_t)state.range(0);
+        const auto cached = (state.range(1) != 0);
+        const auto conditional = (state.range(2) != 0);
+        const auto gzip = (state.range(3) != 0);
+        (void)SystemUtils::File::CreateDirectory(GetBenchAreaPath());
+        const auto name = MakeFile(size);
+        MockServer server;
+        std::function<void()> unloadDelegate;
+        Json::Value configuration(Json::Value::Type::Object);
+        configuration.Set("space", "/");
+        configuration.Set("root", GetBenchAreaPath());
+        configuration.Set("cache-budget", cached ? (int)(2 * size + 1024 * 1024) : 0);
+        LoadPlugin(
+            &server, configuration,
+            [](std::string senderName, size_t level, std::string message)
+            { fprintf(stderr, "[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+            unloadDelegate);
+        if (unloadDelegate == nullptr)
+        {
+            state.SkipWithError("unable to load the plug-in");
+            return;
+        }
+        const auto request = std::make_shared<Http::IServer::Request>();
+        request->target.SetPath({name});
+        if (gzip)
+        { request->headers.SetHeader("Accept-Encoding", "gzip"); }
+
+        // Warm up, and learn the entity tag to make conditional requests.
+        auto response = server.registredResourceDelegate(request, nullptr, "");
+        if (conditional)
+        { request->headers.SetHeader("If-None-Match", response->headers.GetHeaderValue("ETag")); }
+        const unsigned int expectedStatus = (conditional ? 304 : 200);
+        size_t bytes = 0;
+        const auto allocationsBefore = allocations.load();
+        for (auto _ : state)
+        {
+            response = server.registredResourceDelegate(request, nullptr, "");
+            bytes += response->body.length();
+            benchmark::DoNotOptimize(response);
+        }
+        const auto allocationsMade = allocations.load() - allocationsBefore;
+        if (response->statusCode != expectedStatus)
+        { state.SkipWithError("unexpected response status"); }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed((int64_t)bytes);
+        state.counters["allocs/request"] = benchmark::Counter(
+            (double)allocationsMade, benchmark::Counter::kAvgIterations);
+        unloadDelegate();
+    }
+}  // namespace
+
+/**
+ * This counts heap allocations, so that benchmarks can report
+ * how many are made per request.
+ */
+void* operator new(size_t size) {
+    ++allocations;
+    const auto memory = malloc((size == 0) ? 1 : size);
+    if (memory == nullptr)
+    { throw std::bad_alloc(); }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+BENCHMARK(ServeFile)
+    ->ArgNames({"size", "cached", "conditional", "gzip"})
+    ->ArgsProduct({FILE_SIZES, {0, 1}, {0, 1}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
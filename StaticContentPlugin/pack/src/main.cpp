@@ -0,0 +1,174 @@
+/**
+ * @file main.cpp
+ *
+ * This module holds the main() function, which is the entrypoint
+ * to the MakeAssetPack program. It builds an asset pack, to be served
+ * by the StaticContentPlugin, out of the files of a directory.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SystemUtils/File.hpp>
+#include <string>
+#include <vector>
+#include "AssetPack.hpp"
+#include "ContentType.hpp"
+#include "FileMapping.hpp"
+#include "FileVersion.hpp"
+
+namespace
+{
+    /**
+     * This function reads the whole content of the file at the given path.
+     *
+     * @param[in] path
+     *      This is the path of the file to read.
+     *
+     * @param[out] content
+     *      This is where to store the content of the file.
+     *
+     * @return
+     *      An indication of whether or not the file was read is returned.
+     */
+    bool ReadContent(const std::string& path, std::string& content) {
+        FileMapping mapping;
+        if (!mapping.Open(path))
+        { return false; }
+        content.assign(mapping.GetData(), mapping.GetSize());
+        return true;
+    }
+
+    /**
+     * This function determines whether or not the file at the given path
+     * holds a precompressed representation of another file being packed.
+     *
+     * @param[in] path
+     *      This is the path of the file to check.
+     *
+     * @return
+     *      An indication of whether or not the file holds a precompressed
+     *      representation of another file is returned.
+     */
+    bool IsSidecar(const std::string& path) {
+        for (const auto& sidecar : SIDECARS)
+        {
+            const std::string extension(sidecar.extension);
+            FileVersion version;
+            if ((path.length() > extension.length()) &&
+                (path.compare(path.length() - extension.length(), extension.length(),
+                              extension) == 0) &&
+                version.Read(path.substr(0, path.length() - extension.length())))
+            { return true; }
+        }
+        return false;
+    }
+
+    /**
+     * This function adds the files found under the given directory,
+     * and its subdirectories, to the given files to pack.
+     *
+     * @param[in] directory
+     *      This is the path of the directory whose files to add.
+     *
+     * @param[in] prefix
+     *      This is the path of the directory relative to the pack,
+     *      ending with a forward slash unless it is empty.
+     *
+     * @param[in, out] sources
+     *      These are the files to pack.
+     *
+     * @return
+     *      An indication of whether or not all the files
+     *      were added is returned.
+     */
+    bool AddDirectory(const std::string& directory, const std::string& prefix,
+                      std::vector<AssetPack::Source>& sources) {
+        std::vector<std::string> entries;
+        SystemUtils::File::ListDirectory(directory, entries);
+        for (const auto& entry : entries)
+        {
+            const auto name = entry.substr(entry.find_last_of("/\\") + 1);
+            if ((name == ".") || (name == ".."))
+            { continue; }
+            const auto path = directory + "/" + name;
+            FileVersion version;
+            if (!version.Read(path))
+            {
+                fprintf(stderr, "error: unable to read '%s'\n", path.c_str());
+                return false;
+            }
+            if (version.isDirectory)
+            {
+                if (!AddDirectory(path, prefix + name + "/", sources))
+                { return false; }
+                continue;
+            }
+            if (IsSidecar(path))
+            { continue; }
+            AssetPack::Source source;
+            source.path = prefix + name;
+            bool compressible;
+            source.contentType = GetContentType(path, compressible);
+            source.lastModified = version.lastModified;
+            if (!ReadContent(path, source.content))
+            {
+                fprintf(stderr, "error: unable to read '%s'\n", path.c_str());
+                return false;
+            }
+            for (const auto& sidecar : SIDECARS)
+            {
+                FileVersion variantVersion;
+                AssetPack::Source::Variant variant;
+                variant.encoding = sidecar.encoding;
+                if (compressible && variantVersion.Read(path + sidecar.extension) &&
+                    (variantVersion.lastModified >= version.lastModified) &&
+                    ReadContent(path + sidecar.extension, variant.content))
+                { source.variants.push_back(std::move(variant)); }
+            }
+            sources.push_back(std::move(source));
+        }
+        return true;
+    }
+}  // namespace
+
+/**
+ * This function is the entrypoint of the program. It packs the
+ * files of the directory given as the first argument into the pack
+ * given as the second argument. The pack is written next to its final
+ * location and then moved over it, so that a server serving the pack
+ * switches to the new version at once.
+ *
+ * @param[in] argc
+ *      This is the number of command-line arguments to the program.
+ *
+ * @param[in] argv
+ *      This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: MakeAssetPack DIRECTORY PACK\n");
+        return EXIT_FAILURE;
+    }
+    const std::string directory(argv[1]);
+    const std::string packPath(argv[2]);
+    std::vector<AssetPack::Source> sources;
+    if (!AddDirectory(directory, "", sources))
+    { return EXIT_FAILURE; }
+    const auto newPackPath = packPath + ".new";
+    if (!AssetPack::Write(newPackPath, sources))
+    {
+        fprintf(stderr, "error: unable to write '%s'\n", newPackPath.c_str());
+        return EXIT_FAILURE;
+    }
+    SystemUtils::File newPack(newPackPath);
+    if (!newPack.Move(packPath))
+    {
+        fprintf(stderr, "error: unable to replace '%s'\n", packPath.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("Packed %zu files into '%s'\n", sources.size(), packPath.c_str());
+    return EXIT_SUCCESS;
+}
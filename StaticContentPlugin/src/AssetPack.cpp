@@ -0,0 +1,384 @@
+/**
+ * @file AssetPack.cpp
+ *
+ * This module contains the implementation of the AssetPack
+ * and LiveAssetPack classes.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "AssetPack.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <SystemUtils/DirectoryMonitor.hpp>
+#include <SystemUtils/File.hpp>
+#include <mutex>
+#include <unordered_map>
+#include "ContentHash.hpp"
+#include "FileMapping.hpp"
+#include "FileVersion.hpp"
+
+namespace
+{
+    /**
+     * This is the signature at the start of every pack.
+     */
+    constexpr char MAGIC[8] = {'A', 'S', 'S', 'E', 'T', 'P', 'K', '1'};
+
+    /**
+     * This is the size of the pack header, in bytes.
+     */
+    constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 2 * 8;
+
+    /**
+     * This is the size of each record of the file table, in bytes.
+     */
+    constexpr size_t FILE_RECORD_SIZE = 11 * 8;
+
+    /**
+     * This is the size of each record of the representation table, in bytes.
+     */
+    constexpr size_t VARIANT_RECORD_SIZE = 6 * 8;
+
+    /**
+     * This reads a 64-bit little-endian number from the given data.
+     *
+     * @param[in] data
+     *      This is the data from which to read the number.
+     *
+     * @return
+     *      The number read is returned.
+     */
+    uint64_t ReadNumber(const char* data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i)
+        { value = (value << 8) | (uint8_t)data[i]; }
+        return value;
+    }
+
+    /**
+     * This appends a 64-bit little-endian number to the given data.
+     *
+     * @param[in, out] data
+     *      This is the data to which to append the number.
+     *
+     * @param[in] value
+     *      This is the number to append.
+     */
+    void WriteNumber(std::string& data, uint64_t value) {
+        for (int i = 0; i < 8; ++i)
+        {
+            data.push_back((char)(value & 0xFF));
+            value >>= 8;
+        }
+    }
+
+    /**
+     * This reads the location of a string or content from a table record,
+     * making sure it lies within the pack.
+     *
+     * @param[in] mapping
+     *      This holds the content of the pack.
+     *
+     * @param[in] field
+     *      This is the location in the record of the offset,
+     *      followed by the length.
+     *
+     * @param[out] content
+     *      This is where to store the location read.
+     *
+     * @return
+     *      An indication of whether or not the location
+     *      lies within the pack is returned.
+     */
+    bool ReadContent(const FileMapping& mapping, const char* field, AssetPack::Content& content) {
+        const auto offset = ReadNumber(field);
+        const auto length = ReadNumber(field + 8);
+        if ((offset > mapping.GetSize()) || (length > mapping.GetSize() - offset))
+        { return false; }
+        content.data = mapping.GetData() + offset;
+        content.size = (size_t)length;
+        return true;
+    }
+
+    /**
+     * This reads a string from a table record, making sure
+     * it lies within the pack.
+     *
+     * @param[in] mapping
+     *      This holds the content of the pack.
+     *
+     * @param[in] field
+     *      This is the location in the record of the offset,
+     *      followed by the length.
+     *
+     * @param[out] value
+     *      This is where to store the string read.
+     *
+     * @return
+     *      An indication of whether or not the string
+     *      lies within the pack is returned.
+     */
+    bool ReadString(const FileMapping& mapping, const char* field, std::string& value) {
+        AssetPack::Content content;
+        if (!ReadContent(mapping, field, content))
+        { return false; }
+        value.assign(content.data, content.size);
+        return true;
+    }
+
+    /**
+     * This builds the pack content while keeping track of where
+     * the strings and content referred to by the tables go.
+     */
+    struct PackBuilder
+    {
+        /**
+         * This holds the header and tables of the pack.
+         */
+        std::string tables;
+
+        /**
+         * This holds the strings and content referred to by the tables.
+         */
+        std::string blobs;
+
+        /**
+         * This is the size the tables will have once complete.
+         */
+        size_t tablesSize = 0;
+
+        /**
+         * This appends the location of the given blob to the tables,
+         * and the blob itself to the blobs.
+         *
+         * @param[in] blob
+         *      This is the string or content to add.
+         */
+        void AddBlob(const std::string& blob) {
+            WriteNumber(tables, tablesSize + blobs.length());
+            WriteNumber(tables, blob.length());
+            blobs += blob;
+        }
+    };
+}  // namespace
+
+struct AssetPack::Impl
+{
+    // Properties
+
+    /**
+     * This holds the content of the pack.
+     */
+    FileMapping mapping;
+
+    /**
+     * These are the files held in the pack, keyed by path.
+     */
+    std::unordered_map<std::string, File> files;
+};
+
+AssetPack::~AssetPack() noexcept = default;
+
+AssetPack::AssetPack() : impl_(new Impl()) {}
+
+bool AssetPack::Open(const std::string& path, const std::string& root) {
+    impl_->files.clear();
+    auto& mapping = impl_->mapping;
+    if (!mapping.Open(path))
+    { return false; }
+    const auto data = mapping.GetData();
+    const auto size = mapping.GetSize();
+    if ((size < HEADER_SIZE) || (memcmp(data, MAGIC, sizeof(MAGIC)) != 0))
+    { return false; }
+    const auto numFiles = ReadNumber(data + sizeof(MAGIC));
+    const auto numVariants = ReadNumber(data + sizeof(MAGIC) + 8);
+    if ((numFiles > (size - HEADER_SIZE) / FILE_RECORD_SIZE) ||
+        (numVariants >
+         (size - HEADER_SIZE - numFiles * FILE_RECORD_SIZE) / VARIANT_RECORD_SIZE))
+    { return false; }
+    const auto variantRecords = data + HEADER_SIZE + numFiles * FILE_RECORD_SIZE;
+    impl_->files.reserve((size_t)numFiles);
+    for (uint64_t i = 0; i < numFiles; ++i)
+    {
+        const auto record = data + HEADER_SIZE + i * FILE_RECORD_SIZE;
+        std::string filePath;
+        File file;
+        if (!ReadString(mapping, record, filePath) ||
+            !ReadString(mapping, record + 16, file.entry.contentType) ||
+            !ReadString(mapping, record + 32, file.entry.etag) ||
+            !ReadContent(mapping, record + 48, file.content))
+        { return false; }
+        file.entry.lastModified = (time_t)ReadNumber(record + 64);
+        const auto firstVariant = ReadNumber(record + 72);
+        const auto fileVariants = ReadNumber(record + 80);
+        if ((firstVariant > numVariants) || (fileVariants > numVariants - firstVariant))
+        { return false; }
+        for (uint64_t j = firstVariant; j < firstVariant + fileVariants; ++j)
+        {
+            const auto variantRecord = variantRecords + j * VARIANT_RECORD_SIZE;
+            ContentCache::Entry::Variant variant;
+            Content variantContent;
+            if (!ReadString(mapping, variantRecord, variant.encoding) ||
+                !ReadString(mapping, variantRecord + 16, variant.etag) ||
+                !ReadContent(mapping, variantRecord + 32, variantContent))
+            { return false; }
+            file.entry.variants.push_back(std::move(variant));
+            file.variantContents.push_back(variantContent);
+        }
+        impl_->files[root + "/" + filePath] = std::move(file);
+    }
+    return true;
+}
+
+auto AssetPack::Find(const std::string& path) const -> const File* {
+    const auto file = impl_->files.find(path);
+    if (file == impl_->files.end())
+    { return nullptr; }
+    return &file->second;
+}
+
+bool AssetPack::Write(const std::string& path, const std::vector<Source>& sources) {
+    PackBuilder builder;
+    size_t numVariants = 0;
+    for (const auto& source : sources)
+    { numVariants += source.variants.size(); }
+    builder.tablesSize =
+        HEADER_SIZE + sources.size() * FILE_RECORD_SIZE + numVariants * VARIANT_RECORD_SIZE;
+    builder.tables.append(MAGIC, sizeof(MAGIC));
+    WriteNumber(builder.tables, sources.size());
+    WriteNumber(builder.tables, numVariants);
+    size_t firstVariant = 0;
+    for (const auto& source : sources)
+    {
+        builder.AddBlob(source.path);
+        builder.AddBlob(source.contentType);
+        builder.AddBlob(ComputeEntityTag(source.content.data(), source.content.length()));
+        builder.AddBlob(source.content);
+        WriteNumber(builder.tables, (uint64_t)source.lastModified);
+        WriteNumber(builder.tables, firstVariant);
+        WriteNumber(builder.tables, source.variants.size());
+        firstVariant += source.variants.size();
+    }
+    for (const auto& source : sources)
+    {
+        for (const auto& variant : source.variants)
+        {
+            builder.AddBlob(variant.encoding);
+            builder.AddBlob(GetVariantEntityTag(
+                ComputeEntityTag(variant.content.data(), variant.content.length()),
+                variant.encoding));
+            builder.AddBlob(variant.content);
+        }
+    }
+    SystemUtils::File file(path);
+    if (!file.OpenReadWrite() || !file.SetSize(0))
+    { return false; }
+    const auto written = (file.Write(builder.tables.data(), builder.tables.length()) +
+                          file.Write(builder.blobs.data(), builder.blobs.length()));
+    file.Close();
+    return (written == builder.tables.length() + builder.blobs.length());
+}
+
+struct LiveAssetPack::Impl
+{
+    // Properties
+
+    /**
+     * This is the path of the pack.
+     */
+    std::string path;
+
+    /**
+     * This is the path prepended to the path of each file
+     * held in the pack, to form the path by which it is found.
+     */
+    std::string root;
+
+    /**
+     * This synchronizes access to the current version of the pack.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * This is the most recent version of the pack.
+     */
+    std::shared_ptr<const AssetPack> pack;
+
+    /**
+     * This identifies the version of the pack file which was opened.
+     */
+    FileVersion version;
+
+    /**
+     * This watches the directory holding the pack.
+     */
+    SystemUtils::DirectoryMonitor monitor;
+
+    // Methods
+
+    /**
+     * This method opens the pack again if it has been replaced.
+     *
+     * @return
+     *      An indication of whether or not a version of the pack
+     *      is open is returned.
+     */
+    bool Reload() {
+        FileVersion newVersion;
+        if (!newVersion.Read(path))
+        { return (Get() != nullptr); }
+        {
+            std::lock_guard<decltype(mutex)> lock(mutex);
+            if ((pack != nullptr) && (newVersion == version))
+            { return true; }
+        }
+
+        // If the new pack can't be opened, it may not be completely
+        // written yet; keep serving the previous one.
+        const auto newPack = std::make_shared<AssetPack>();
+        if (!newPack->Open(path, root))
+        { return (Get() != nullptr); }
+        std::lock_guard<decltype(mutex)> lock(mutex);
+        pack = newPack;
+        version = newVersion;
+        return true;
+    }
+
+    /**
+     * This method returns the most recent version of the pack.
+     *
+     * @return
+     *      The most recent version of the pack is returned.
+     */
+    std::shared_ptr<const AssetPack> Get() const {
+        std::lock_guard<decltype(mutex)> lock(mutex);
+        return pack;
+    }
+};
+
+LiveAssetPack::~LiveAssetPack() noexcept {
+    Stop();
+}
+
+LiveAssetPack::LiveAssetPack(const std::string& path, const std::string& root)
+    : impl_(new Impl()) {
+    impl_->path = path;
+    impl_->root = root;
+}
+
+bool LiveAssetPack::Start() {
+    const auto impl = impl_.get();
+    const auto directory = impl_->path.substr(0, impl_->path.find_last_of("/\\"));
+    const auto watching = impl_->monitor.Start([impl] { (void)impl->Reload(); }, directory);
+    (void)impl_->Reload();
+    return watching;
+}
+
+void LiveAssetPack::Stop() {
+    impl_->monitor.Stop();
+}
+
+std::shared_ptr<const AssetPack> LiveAssetPack::Get() const {
+    return impl_->Get();
+}
@@ -0,0 +1,282 @@
+#ifndef STATIC_CONTENT_PLUGIN_ASSET_PACK_HPP
+#define STATIC_CONTENT_PLUGIN_ASSET_PACK_HPP
+
+/**
+ * @file AssetPack.hpp
+ *
+ * This module declares the AssetPack and LiveAssetPack classes.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <time.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ContentCache.hpp"
+
+/**
+ * This class gives access to the files stored in an asset pack: a single
+ * file holding the content of many files, along with a table giving the
+ * path, media type, entity tag and location of each of them, and of any
+ * precompressed representations of them.
+ *
+ * The pack is mapped into memory once, read-only, and the content of the
+ * files it holds is served straight out of the mapping.
+ *
+ * The layout of a pack is as follows, with all numbers stored as 64-bit
+ * little-endian unsigned integers, and all offsets counted from the
+ * start of the pack:
+ *
+ * - header: the 8 bytes "ASSETPK1", the number of files,
+ *   and the number of precompressed representations.
+ * - file table, one record per file: offset and length of the path,
+ *   of the media type, and of the entity tag, offset and length of the
+ *   content, last modification time, index of the first precompressed
+ *   representation in the representation table, and number of them.
+ * - representation table, one record per precompressed representation:
+ *   offset and length of the content coding, of the entity tag, and
+ *   of the content.
+ * - the strings and content referred to by the tables.
+ */
+class AssetPack
+{
+    // Types
+public:
+    /**
+     * This locates content held in the pack.
+     */
+    struct Content
+    {
+        /**
+         * This is the start of the content.
+         */
+        const char* data = nullptr;
+
+        /**
+         * This is the number of bytes of content.
+         */
+        size_t size = 0;
+    };
+
+    /**
+     * This describes one file held in the pack.
+     */
+    struct File
+    {
+        /**
+         * This holds the media type, entity tag and modification time
+         * of the file, along with the content coding and entity tag
+         * of its precompressed representations. The content itself
+         * is not copied into it.
+         */
+        ContentCache::Entry entry;
+
+        /**
+         * This locates the content of the file.
+         */
+        Content content;
+
+        /**
+         * These locate the content of the precompressed representations
+         * of the file, in the same order as in the entry.
+         */
+        std::vector<Content> variantContents;
+    };
+
+    /**
+     * This holds one file to store in a pack.
+     */
+    struct Source
+    {
+        /**
+         * This holds one precompressed representation of the file.
+         */
+        struct Variant
+        {
+            /**
+             * This is the content coding of the representation.
+             */
+            std::string encoding;
+
+            /**
+             * This is the precompressed content.
+             */
+            std::string content;
+        };
+
+        /**
+         * This is the path of the file, relative to the pack,
+         * with segments separated by forward slashes.
+         */
+        std::string path;
+
+        /**
+         * This is the media type of the file.
+         */
+        std::string contentType;
+
+        /**
+         * This is the time the file was last modified,
+         * in seconds since the UNIX epoch.
+         */
+        time_t lastModified = 0;
+
+        /**
+         * This is the content of the file.
+         */
+        std::string content;
+
+        /**
+         * These are the precompressed representations of the file,
+         * in order of preference.
+         */
+        std::vector<Variant> variants;
+    };
+
+    // Lifecycle Methods
+public:
+    ~AssetPack() noexcept;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack(AssetPack&&) noexcept = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+    AssetPack& operator=(AssetPack&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the default constructor.
+     */
+    AssetPack();
+
+    /**
+     * This method maps the pack at the given path into memory
+     * and indexes the files it holds.
+     *
+     * @param[in] path
+     *      This is the path of the pack to open.
+     *
+     * @param[in] root
+     *      This is the path prepended to the path of each file
+     *      held in the pack, to form the path by which it is found.
+     *
+     * @return
+     *      An indication of whether or not the pack was opened
+     *      is returned. It is not if it can't be mapped or is malformed.
+     */
+    bool Open(const std::string& path, const std::string& root);
+
+    /**
+     * This method looks up the file at the given path in the pack.
+     *
+     * @param[in] path
+     *      This is the path of the file to look up.
+     *
+     * @return
+     *      The file is returned, or nullptr if the pack doesn't hold it.
+     */
+    const File* Find(const std::string& path) const;
+
+    /**
+     * This function writes a pack holding the given files.
+     *
+     * @param[in] path
+     *      This is the path of the pack to write.
+     *
+     * @param[in] sources
+     *      These are the files to store in the pack.
+     *
+     * @return
+     *      An indication of whether or not the pack was written
+     *      is returned.
+     */
+    static bool Write(const std::string& path, const std::vector<Source>& sources);
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+/**
+ * This class keeps the most recent version of an asset pack open,
+ * watching the directory holding it and opening the pack again whenever
+ * it is replaced. Requests being served from the previous version keep
+ * it mapped until they're done with it, so replacing the pack (by renaming
+ * a new one over it) switches all its files to the new version at once.
+ */
+class LiveAssetPack
+{
+    // Lifecycle Methods
+public:
+    ~LiveAssetPack() noexcept;
+    LiveAssetPack(const LiveAssetPack&) = delete;
+    LiveAssetPack(LiveAssetPack&&) noexcept = delete;
+    LiveAssetPack& operator=(const LiveAssetPack&) = delete;
+    LiveAssetPack& operator=(LiveAssetPack&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] path
+     *      This is the path of the pack.
+     *
+     * @param[in] root
+     *      This is the path prepended to the path of each file
+     *      held in the pack, to form the path by which it is found.
+     */
+    LiveAssetPack(const std::string& path, const std::string& root);
+
+    /**
+     * This method opens the pack and starts watching for it
+     * to be replaced. Whether or not the pack was opened
+     * is found out by calling Get.
+     *
+     * @return
+     *      An indication of whether or not the pack is being
+     *      watched is returned. If it isn't, the pack is never
+     *      opened again once replaced.
+     */
+    bool Start();
+
+    /**
+     * This method stops watching for the pack to be replaced.
+     */
+    void Stop();
+
+    /**
+     * This method returns the most recent version of the pack.
+     *
+     * @return
+     *      The most recent version of the pack is returned.
+     */
+    std::shared_ptr<const AssetPack> Get() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* STATIC_CONTENT_PLUGIN_ASSET_PACK_HPP */
@@ -0,0 +1,346 @@
+/**
+ * @file ContentCache.cpp
+ *
+ * This module contains the implementation of the ContentCache class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "ContentCache.hpp"
+#include <SystemUtils/DirectoryMonitor.hpp>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    /**
+     * This is the number of bytes accounted for each cache entry
+     * on top of its content, to cover the bookkeeping.
+     */
+    constexpr size_t ENTRY_OVERHEAD = 128;
+
+    /**
+     * This is the maximum number of files remembered as missing.
+     */
+    constexpr size_t MISSING_CAPACITY = 4096;
+
+    /**
+     * This holds the monitor watching one directory.
+     */
+    struct Watcher
+    {
+        /**
+         * This is the monitor watching the directory.
+         */
+        std::unique_ptr<SystemUtils::DirectoryMonitor> monitor;
+
+        /**
+         * This is the position of the directory in the order
+         * in which directories were last looked up.
+         */
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    /**
+     * This holds one file whose content is cached.
+     */
+    struct Record
+    {
+        /**
+         * This is the cached content of the file.
+         */
+        std::shared_ptr<const ContentCache::Entry> entry;
+
+        /**
+         * This is the path of the directory containing the file.
+         */
+        std::string directory;
+
+        /**
+         * This is the number of bytes accounted to the entry.
+         */
+        size_t size = 0;
+
+        /**
+         * This is the position of the entry in the order
+         * in which entries were last used.
+         */
+        std::list<std::string>::iterator lruPosition;
+    };
+
+    /**
+     * This computes the number of bytes to account for the given entry.
+     *
+     * @param[in] path
+     *      This is the path of the file whose content is cached.
+     *
+     * @param[in] entry
+     *      This is the cached content of the file.
+     *
+     * @return
+     *      The number of bytes to account for the entry is returned.
+     */
+    size_t EntrySize(const std::string& path, const ContentCache::Entry& entry) {
+        auto size = (ENTRY_OVERHEAD + path.length() + entry.body.length() +
+                     entry.contentType.length() + entry.etag.length());
+        for (const auto& variant : entry.variants)
+        {
+            size += (ENTRY_OVERHEAD + variant.encoding.length() + variant.body.length() +
+                     variant.etag.length());
+        }
+        return size;
+    }
+}  // namespace
+
+struct ContentCache::Impl
+{
+    // Properties
+
+    /**
+     * This synchronizes access to the cached content.
+     */
+    std::mutex mutex;
+
+    /**
+     * This is the maximum number of bytes the cache may hold.
+     */
+    size_t budget = 0;
+
+    /**
+     * This is the number of bytes currently held in the cache.
+     */
+    size_t size = 0;
+
+    /**
+     * This is incremented every time cached content is invalidated.
+     */
+    uint64_t generation = 0;
+
+    /**
+     * These are the cached files, keyed by path.
+     */
+    std::unordered_map<std::string, Record> records;
+
+    /**
+     * These are the paths of the cached files, from the most
+     * recently used to the least recently used.
+     */
+    std::list<std::string> lru;
+
+    /**
+     * These are the paths of the files known not to exist, along with
+     * the path of the watched directory in which they would appear.
+     */
+    std::unordered_map<std::string, std::string> missing;
+
+    /**
+     * This synchronizes access to the directory monitors.
+     */
+    std::mutex monitorsMutex;
+
+    /**
+     * These are the monitors watching the directories
+     * holding cached files, keyed by directory path.
+     */
+    std::map<std::string, Watcher> monitors;
+
+    /**
+     * These are the paths of the directories watched, from the most
+     * recently looked up to the least recently looked up.
+     */
+    std::list<std::string> monitorsLru;
+
+    /**
+     * This is the maximum number of directories to watch at a time.
+     */
+    size_t monitorCapacity = 1;
+
+    // Methods
+
+    /**
+     * This method removes the given record from the cache.
+     *
+     * @param[in] record
+     *      This is the record to remove.
+     *
+     * @return
+     *      The record following the removed one is returned.
+     */
+    decltype(records)::iterator Remove(decltype(records)::iterator record) {
+        size -= record->second.size;
+        lru.erase(record->second.lruPosition);
+        return records.erase(record);
+    }
+
+    /**
+     * This method removes least recently used records until
+     * the given number of bytes fits within the budget.
+     *
+     * @param[in] needed
+     *      This is the number of bytes which need to fit.
+     */
+    void MakeRoom(size_t needed) {
+        while (!lru.empty() && (size + needed > budget))
+        { (void)Remove(records.find(lru.back())); }
+    }
+
+    /**
+     * This method drops all content cached from the given directory.
+     *
+     * @param[in] directory
+     *      This is the path of the directory whose content to drop.
+     */
+    void Invalidate(const std::string& directory) {
+        std::lock_guard<decltype(mutex)> lock(mutex);
+        ++generation;
+        for (auto record = records.begin(); record != records.end();)
+        {
+            if (record->second.directory == directory)
+            {
+                record = Remove(record);
+            } else
+            { ++record; }
+        }
+        for (auto missingFile = missing.begin(); missingFile != missing.end();)
+        {
+            if (missingFile->second == directory)
+            {
+                missingFile = missing.erase(missingFile);
+            } else
+            { ++missingFile; }
+        }
+    }
+};
+
+ContentCache::~ContentCache() noexcept {
+    Stop();
+}
+
+ContentCache::ContentCache(size_t budget, size_t monitorCapacity) : impl_(new Impl()) {
+    impl_->budget = budget;
+    impl_->monitorCapacity = std::max(monitorCapacity, (size_t)1);
+}
+
+size_t ContentCache::GetBudget() const {
+    return impl_->budget;
+}
+
+size_t ContentCache::GetSize() const {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    return impl_->size;
+}
+
+std::shared_ptr<const ContentCache::Entry> ContentCache::Find(const std::string& path) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    const auto record = impl_->records.find(path);
+    if (record == impl_->records.end())
+    { return nullptr; }
+    impl_->lru.splice(impl_->lru.begin(), impl_->lru, record->second.lruPosition);
+    return record->second.entry;
+}
+
+uint64_t ContentCache::GetGeneration() const {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    return impl_->generation;
+}
+
+bool ContentCache::Watch(const std::string& directory) {
+    if (impl_->budget == 0)
+    { return false; }
+    std::lock_guard<decltype(impl_->monitorsMutex)> lock(impl_->monitorsMutex);
+    const auto existing = impl_->monitors.find(directory);
+    if (existing != impl_->monitors.end())
+    {
+        impl_->monitorsLru.splice(impl_->monitorsLru.begin(), impl_->monitorsLru,
+                                  existing->second.lruPosition);
+        return true;
+    }
+    auto monitor = std::unique_ptr<SystemUtils::DirectoryMonitor>(
+        new SystemUtils::DirectoryMonitor());
+    const auto impl = impl_.get();
+    if (!monitor->Start([impl, directory] { impl->Invalidate(directory); }, directory))
+    { return false; }
+
+    // Make room by no longer watching the directory least recently
+    // looked up, dropping what was cached from it, since changes
+    // to it would go unnoticed from now on.
+    while (impl_->monitors.size() >= impl_->monitorCapacity)
+    {
+        const auto evicted = impl_->monitors.find(impl_->monitorsLru.back());
+        evicted->second.monitor->Stop();
+        impl_->Invalidate(evicted->first);
+        impl_->monitorsLru.pop_back();
+        (void)impl_->monitors.erase(evicted);
+    }
+    impl_->monitorsLru.push_front(directory);
+    auto& watcher = impl_->monitors[directory];
+    watcher.monitor = std::move(monitor);
+    watcher.lruPosition = impl_->monitorsLru.begin();
+    return true;
+}
+
+bool ContentCache::Insert(const std::string& path, const std::string& directory,
+                          std::shared_ptr<const Entry> entry, uint64_t generation) {
+    const auto size = EntrySize(path, *entry);
+    if (size > impl_->budget)
+    { return false; }
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (generation != impl_->generation)
+    { return false; }
+    const auto existing = impl_->records.find(path);
+    if (existing != impl_->records.end())
+    { (void)impl_->Remove(existing); }
+    impl_->MakeRoom(size);
+    impl_->lru.push_front(path);
+    auto& record = impl_->records[path];
+    record.entry = std::move(entry);
+    record.directory = directory;
+    record.size = size;
+    record.lruPosition = impl_->lru.begin();
+    impl_->size += size;
+    return true;
+}
+
+bool ContentCache::IsMissing(const std::string& path) const {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    return (impl_->missing.find(path) != impl_->missing.end());
+}
+
+bool ContentCache::InsertMissing(const std::string& path, const std::string& directory,
+                                 uint64_t generation) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if (generation != impl_->generation)
+    { return false; }
+    if (impl_->missing.size() >= MISSING_CAPACITY)
+    { (void)impl_->missing.erase(impl_->missing.begin()); }
+    impl_->missing[path] = directory;
+    return true;
+}
+
+void ContentCache::Invalidate(const std::string& directory) {
+    impl_->Invalidate(directory);
+}
+
+void ContentCache::Clear() {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    ++impl_->generation;
+    impl_->records.clear();
+    impl_->lru.clear();
+    impl_->missing.clear();
+    impl_->size = 0;
+}
+
+void ContentCache::Stop() {
+    decltype(impl_->monitors) monitors;
+    {
+        std::lock_guard<decltype(impl_->monitorsMutex)> lock(impl_->monitorsMutex);
+        monitors.swap(impl_->monitors);
+        impl_->monitorsLru.clear();
+    }
+    for (auto& monitor : monitors)
+    { monitor.second.monitor->Stop(); }
+    Clear();
+}
@@ -0,0 +1,268 @@
+#ifndef STATIC_CONTENT_PLUGIN_CONTENT_CACHE_HPP
+#define STATIC_CONTENT_PLUGIN_CONTENT_CACHE_HPP
+
+/**
+ * @file ContentCache.hpp
+ *
+ * This module declares the ContentCache class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds the content of the files most recently served
+ * from one resource space, so that serving them again costs no
+ * file system access. The cache is bounded by a byte budget, with
+ * the least recently used entries evicted first. Each directory
+ * holding cached files is watched, and the entries of a directory
+ * are dropped whenever anything in it changes. The number of
+ * directories watched is bounded too: once it's reached, the directory
+ * least recently looked up stops being watched, and the entries
+ * cached from it are dropped.
+ */
+class ContentCache
+{
+    // Types
+public:
+    /**
+     * This holds everything needed to respond with one cached file.
+     */
+    struct Entry
+    {
+        /**
+         * This holds one precompressed representation of the file.
+         */
+        struct Variant
+        {
+            /**
+             * This is the value to give for the "Content-Encoding" header.
+             */
+            std::string encoding;
+
+            /**
+             * This is the compressed content of the file.
+             */
+            std::string body;
+
+            /**
+             * This is the entity tag of the compressed content.
+             */
+            std::string etag;
+        };
+
+        /**
+         * This is the content of the file.
+         */
+        std::string body;
+
+        /**
+         * This is the value to give for the "Content-Type" header.
+         */
+        std::string contentType;
+
+        /**
+         * This is the entity tag of the file content.
+         */
+        std::string etag;
+
+        /**
+         * This is the time the file was last modified,
+         * in seconds since the UNIX epoch.
+         */
+        time_t lastModified = 0;
+
+        /**
+         * This indicates whether or not the content is text
+         * which would benefit from being compressed.
+         */
+        bool compressible = false;
+
+        /**
+         * These are the precompressed representations of the file,
+         * in order of preference.
+         */
+        std::vector<Variant> variants;
+    };
+
+    // Lifecycle Methods
+public:
+    ~ContentCache() noexcept;
+    ContentCache(const ContentCache&) = delete;
+    ContentCache(ContentCache&&) noexcept = delete;
+    ContentCache& operator=(const ContentCache&) = delete;
+    ContentCache& operator=(ContentCache&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] budget
+     *      This is the maximum number of bytes the cache may hold.
+     *      A budget of zero disables the cache.
+     *
+     * @param[in] monitorCapacity
+     *      This is the maximum number of directories to watch at a time.
+     */
+    explicit ContentCache(size_t budget, size_t monitorCapacity = 256);
+
+    /**
+     * This method returns the maximum number of bytes the cache may hold.
+     *
+     * @return
+     *      The maximum number of bytes the cache may hold is returned.
+     */
+    size_t GetBudget() const;
+
+    /**
+     * This method returns the number of bytes currently held
+     * in the cache.
+     *
+     * @return
+     *      The number of bytes currently held in the cache is returned.
+     */
+    size_t GetSize() const;
+
+    /**
+     * This method looks up the cached content of the file
+     * at the given path, marking it as the most recently used.
+     *
+     * @param[in] path
+     *      This is the path of the file to look up.
+     *
+     * @return
+     *      The cached content of the file is returned,
+     *      or nullptr if the file is not cached.
+     */
+    std::shared_ptr<const Entry> Find(const std::string& path);
+
+    /**
+     * This method returns the current generation of the cache, which
+     * changes every time cached content is invalidated. It should be
+     * sampled before reading a file from the file system, and given back
+     * when the content is inserted, so that content which may have changed
+     * while being read is never cached.
+     *
+     * @return
+     *      The current generation of the cache is returned.
+     */
+    uint64_t GetGeneration() const;
+
+    /**
+     * This method makes sure the given directory is watched for changes,
+     * so that content cached from it can be invalidated. It should be
+     * called before reading a file from the directory.
+     *
+     * @param[in] directory
+     *      This is the path of the directory to watch.
+     *
+     * @return
+     *      An indication of whether or not the directory is being watched
+     *      is returned. Content from a directory which cannot be watched
+     *      must not be cached. Content cached from it may still be dropped
+     *      later, if it stops being watched to make room for others.
+     */
+    bool Watch(const std::string& directory);
+
+    /**
+     * This method adds the given content to the cache, evicting the
+     * least recently used entries as needed to stay within the budget.
+     *
+     * @param[in] path
+     *      This is the path of the file whose content is given.
+     *
+     * @param[in] directory
+     *      This is the path of the directory containing the file.
+     *
+     * @param[in] entry
+     *      This is the content to cache.
+     *
+     * @param[in] generation
+     *      This is the generation of the cache sampled before the
+     *      content was read from the file system.
+     *
+     * @return
+     *      An indication of whether or not the content was cached
+     *      is returned.
+     */
+    bool Insert(const std::string& path, const std::string& directory,
+                std::shared_ptr<const Entry> entry, uint64_t generation);
+
+    /**
+     * This method determines whether or not the file at the given path
+     * is known not to exist.
+     *
+     * @param[in] path
+     *      This is the path of the file to look up.
+     *
+     * @return
+     *      An indication of whether or not the file is known
+     *      not to exist is returned.
+     */
+    bool IsMissing(const std::string& path) const;
+
+    /**
+     * This method remembers that the file at the given path does not
+     * exist, until the given directory changes.
+     *
+     * @param[in] path
+     *      This is the path of the file which does not exist.
+     *
+     * @param[in] directory
+     *      This is the path of the watched directory in which
+     *      the file would appear.
+     *
+     * @param[in] generation
+     *      This is the generation of the cache sampled before
+     *      the file was looked for in the file system.
+     *
+     * @return
+     *      An indication of whether or not the missing file
+     *      was remembered is returned.
+     */
+    bool InsertMissing(const std::string& path, const std::string& directory,
+                       uint64_t generation);
+
+    /**
+     * This method drops all content cached from the given directory,
+     * and forgets about files known to be missing from it.
+     *
+     * @param[in] directory
+     *      This is the path of the directory whose content to drop.
+     */
+    void Invalidate(const std::string& directory);
+
+    /**
+     * This method drops all cached content.
+     */
+    void Clear();
+
+    /**
+     * This method stops watching all directories for changes
+     * and drops all cached content.
+     */
+    void Stop();
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* STATIC_CONTENT_PLUGIN_CONTENT_CACHE_HPP */
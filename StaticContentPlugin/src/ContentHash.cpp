@@ -0,0 +1,168 @@
+/**
+ * @file ContentHash.cpp
+ *
+ * This module contains the implementation of the functions used
+ * to compute strong entity tags for file content.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "ContentHash.hpp"
+#include <inttypes.h>
+#include <string.h>
+#include <StringUtils/StringUtils.hpp>
+
+namespace
+{
+    /**
+     * These are the prime numbers used by XXH64.
+     */
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    /**
+     * This rotates the bits of the given value to the left.
+     *
+     * @param[in] value
+     *      This is the value whose bits to rotate.
+     *
+     * @param[in] bits
+     *      This is the number of bits by which to rotate.
+     *
+     * @return
+     *      The rotated value is returned.
+     */
+    inline uint64_t RotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    /**
+     * This reads a little-endian 64-bit value from the given data.
+     *
+     * @param[in] data
+     *      This is the data from which to read the value.
+     *
+     * @return
+     *      The value read is returned.
+     */
+    inline uint64_t Read64(const uint8_t* data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i)
+        { value = (value << 8) | data[i]; }
+        return value;
+    }
+
+    /**
+     * This reads a little-endian 32-bit value from the given data.
+     *
+     * @param[in] data
+     *      This is the data from which to read the value.
+     *
+     * @return
+     *      The value read is returned.
+     */
+    inline uint64_t Read32(const uint8_t* data) {
+        return ((uint64_t)data[0] | ((uint64_t)data[1] << 8) | ((uint64_t)data[2] << 16) |
+                ((uint64_t)data[3] << 24));
+    }
+
+    /**
+     * This mixes one 64-bit lane of input into the given accumulator.
+     *
+     * @param[in] accumulator
+     *      This is the accumulator into which to mix the input.
+     *
+     * @param[in] input
+     *      This is the input to mix.
+     *
+     * @return
+     *      The updated accumulator is returned.
+     */
+    inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+        accumulator += input * PRIME2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * PRIME1;
+    }
+
+    /**
+     * This merges one accumulator into the hash being computed.
+     *
+     * @param[in] hash
+     *      This is the hash being computed.
+     *
+     * @param[in] accumulator
+     *      This is the accumulator to merge.
+     *
+     * @return
+     *      The updated hash is returned.
+     */
+    inline uint64_t MergeRound(uint64_t hash, uint64_t accumulator) {
+        hash ^= Round(0, accumulator);
+        return hash * PRIME1 + PRIME4;
+    }
+}  // namespace
+
+uint64_t ComputeContentHash(const void* data, size_t size, uint64_t seed) {
+    auto input = (const uint8_t*)data;
+    const auto end = input + size;
+    uint64_t hash;
+    if (size >= 32)
+    {
+        const auto limit = end - 32;
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        do
+        {
+            v1 = Round(v1, Read64(input));
+            v2 = Round(v2, Read64(input + 8));
+            v3 = Round(v3, Read64(input + 16));
+            v4 = Round(v4, Read64(input + 24));
+            input += 32;
+        } while (input <= limit);
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else
+    { hash = seed + PRIME5; }
+    hash += (uint64_t)size;
+    while (input + 8 <= end)
+    {
+        hash ^= Round(0, Read64(input));
+        hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+        input += 8;
+    }
+    if (input + 4 <= end)
+    {
+        hash ^= Read32(input) * PRIME1;
+        hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+        input += 4;
+    }
+    while (input < end)
+    {
+        hash ^= (*input) * PRIME5;
+        hash = RotateLeft(hash, 11) * PRIME1;
+        ++input;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::string ComputeEntityTag(const void* data, size_t size) {
+    return StringUtils::sprintf("\"%016" PRIx64 "%08" PRIx64 "\"",
+                                ComputeContentHash(data, size), (uint64_t)size);
+}
+
+std::string GetVariantEntityTag(const std::string& etag, const std::string& encoding) {
+    return etag.substr(0, etag.length() - 1) + "-" + encoding + "\"";
+}
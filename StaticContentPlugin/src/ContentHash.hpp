@@ -0,0 +1,64 @@
+#ifndef STATIC_CONTENT_PLUGIN_CONTENT_HASH_HPP
+#define STATIC_CONTENT_PLUGIN_CONTENT_HASH_HPP
+
+/**
+ * @file ContentHash.hpp
+ *
+ * This module declares the functions used to compute
+ * strong entity tags for file content.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * This function computes the 64-bit xxHash (XXH64) of the given data.
+ *
+ * @param[in] data
+ *      This is the data to hash.
+ *
+ * @param[in] size
+ *      This is the number of bytes of data to hash.
+ *
+ * @param[in] seed
+ *      This is the value used to seed the hash.
+ *
+ * @return
+ *      The hash of the given data is returned.
+ */
+uint64_t ComputeContentHash(const void* data, size_t size, uint64_t seed = 0);
+
+/**
+ * This function computes a strong entity tag for the given content,
+ * formatted as a quoted string ready to be used in an "ETag" header.
+ *
+ * @param[in] data
+ *      This is the content whose entity tag to compute.
+ *
+ * @param[in] size
+ *      This is the number of bytes of content.
+ *
+ * @return
+ *      The entity tag of the given content is returned.
+ */
+std::string ComputeEntityTag(const void* data, size_t size);
+
+/**
+ * This function derives the entity tag of a precompressed
+ * representation of a file from the entity tag of its content.
+ *
+ * @param[in] etag
+ *      This is the entity tag of the precompressed content.
+ *
+ * @param[in] encoding
+ *      This is the content coding of the representation.
+ *
+ * @return
+ *      The entity tag of the representation is returned.
+ */
+std::string GetVariantEntityTag(const std::string& etag, const std::string& encoding);
+
+#endif /* STATIC_CONTENT_PLUGIN_CONTENT_HASH_HPP */
@@ -0,0 +1,39 @@
+/**
+ * @file ContentType.cpp
+ *
+ * This module contains the implementation of the function used
+ * to determine the media type of the files served.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "ContentType.hpp"
+#include <string.h>
+
+std::string GetContentType(const std::string& path, bool& compressible) {
+    static const struct
+    {
+        const char* extension;
+        const char* contentType;
+        bool compressible;
+    } contentTypes[] = {
+        {".html", "text/html", true},
+        {".js", "application/javascript", true},
+        {".css", "text/css", true},
+        {".txt", "text/plain", true},
+        {".ico", "image/x-icon", false},
+    };
+    for (const auto& contentType : contentTypes)
+    {
+        const size_t extensionLength = strlen(contentType.extension);
+        if ((path.length() >= extensionLength) &&
+            (path.compare(path.length() - extensionLength, extensionLength,
+                          contentType.extension) == 0))
+        {
+            compressible = contentType.compressible;
+            return contentType.contentType;
+        }
+    }
+    compressible = false;
+    return "text/plain";
+}
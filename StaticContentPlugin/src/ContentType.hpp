@@ -0,0 +1,46 @@
+#ifndef STATIC_CONTENT_PLUGIN_CONTENT_TYPE_HPP
+#define STATIC_CONTENT_PLUGIN_CONTENT_TYPE_HPP
+
+/**
+ * @file ContentType.hpp
+ *
+ * This module declares the function used to determine
+ * the media type of the files served, and the content codings
+ * of their precompressed representations.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <string>
+
+/**
+ * This function determines the media type of the file
+ * at the given path, based on its extension.
+ *
+ * @param[in] path
+ *      This is the path of the file whose media type to determine.
+ *
+ * @param[out] compressible
+ *      This is set to indicate whether or not the content of the
+ *      file is text which would benefit from being compressed.
+ *
+ * @return
+ *      The value to give for the "Content-Type" header is returned.
+ */
+std::string GetContentType(const std::string& path, bool& compressible);
+
+/**
+ * These are the content codings for which precompressed files
+ * are looked for next to the files served, in order of preference,
+ * along with the extension of the precompressed files.
+ */
+constexpr struct
+{
+    const char* encoding;
+    const char* extension;
+} SIDECARS[] = {
+    {"br", ".br"},
+    {"gzip", ".gz"},
+};
+
+#endif /* STATIC_CONTENT_PLUGIN_CONTENT_TYPE_HPP */
@@ -0,0 +1,124 @@
+/**
+ * @file FileMapping.cpp
+ *
+ * This module contains the implementation of the FileMapping class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "FileMapping.hpp"
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <Windows.h>
+#else /* POSIX */
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif /* _WIN32 / POSIX */
+
+struct FileMapping::Impl
+{
+    // Properties
+
+    /**
+     * This is the start of the mapped content of the file.
+     */
+    const char* data = nullptr;
+
+    /**
+     * This is the size of the mapped file, in bytes.
+     */
+    size_t size = 0;
+
+    /**
+     * This indicates whether or not the file is mapped.
+     */
+    bool open = false;
+};
+
+FileMapping::~FileMapping() noexcept {
+    Close();
+}
+
+FileMapping::FileMapping() : impl_(new Impl()) {}
+
+bool FileMapping::Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                  NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    { return false; }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        (void)CloseHandle(file);
+        return false;
+    }
+    impl_->size = (size_t)size.QuadPart;
+    if (impl_->size > 0)
+    {
+        const auto mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL)
+        {
+            impl_->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            (void)CloseHandle(mapping);
+        }
+    }
+    (void)CloseHandle(file);
+#else /* POSIX */
+    const auto file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+    { return false; }
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        (void)close(file);
+        return false;
+    }
+    impl_->size = (size_t)status.st_size;
+    if (impl_->size > 0)
+    {
+        const auto data = mmap(NULL, impl_->size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            (void)madvise(data, impl_->size, MADV_SEQUENTIAL);
+            impl_->data = (const char*)data;
+        }
+    }
+    (void)close(file);
+#endif /* _WIN32 / POSIX */
+    if ((impl_->size > 0) && (impl_->data == nullptr))
+    {
+        impl_->size = 0;
+        return false;
+    }
+    impl_->open = true;
+    return true;
+}
+
+void FileMapping::Close() {
+    if (!impl_->open)
+    { return; }
+    if (impl_->data != nullptr)
+    {
+#ifdef _WIN32
+        (void)UnmapViewOfFile(impl_->data);
+#else /* POSIX */
+        (void)munmap((void*)impl_->data, impl_->size);
+#endif /* _WIN32 / POSIX */
+    }
+    impl_->data = nullptr;
+    impl_->size = 0;
+    impl_->open = false;
+}
+
+const char* FileMapping::GetData() const {
+    return impl_->data;
+}
+
+size_t FileMapping::GetSize() const {
+    return impl_->size;
+}
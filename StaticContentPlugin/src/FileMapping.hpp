@@ -0,0 +1,89 @@
+#ifndef STATIC_CONTENT_PLUGIN_FILE_MAPPING_HPP
+#define STATIC_CONTENT_PLUGIN_FILE_MAPPING_HPP
+
+/**
+ * @file FileMapping.hpp
+ *
+ * This module declares the FileMapping class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+
+/**
+ * This class maps the whole content of a file into memory, read-only,
+ * so that it can be served without first being copied into a buffer.
+ * Pages of the file are brought in by the operating system as they are
+ * touched, and can be reclaimed at any time since they are backed by
+ * the file itself.
+ */
+class FileMapping
+{
+    // Lifecycle Methods
+public:
+    ~FileMapping() noexcept;
+    FileMapping(const FileMapping&) = delete;
+    FileMapping(FileMapping&&) noexcept = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
+    FileMapping& operator=(FileMapping&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the default constructor.
+     */
+    FileMapping();
+
+    /**
+     * This method maps the file at the given path into memory.
+     *
+     * @param[in] path
+     *      This is the path of the file to map.
+     *
+     * @return
+     *      An indication of whether or not the file was mapped
+     *      is returned.
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * This method unmaps the file, if it was mapped.
+     */
+    void Close();
+
+    /**
+     * This method returns the mapped content of the file.
+     *
+     * @return
+     *      The mapped content of the file is returned. This is nullptr
+     *      if the file is not mapped or is empty.
+     */
+    const char* GetData() const;
+
+    /**
+     * This method returns the size of the mapped file.
+     *
+     * @return
+     *      The size of the mapped file, in bytes, is returned.
+     */
+    size_t GetSize() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* STATIC_CONTENT_PLUGIN_FILE_MAPPING_HPP */
@@ -0,0 +1,116 @@
+/**
+ * @file FileVersion.cpp
+ *
+ * This module contains the implementation of the FileVersion structure
+ * and the EntityTagTable class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "FileVersion.hpp"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <mutex>
+#include <unordered_map>
+
+bool FileVersion::Read(const std::string& path) {
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_stat64(path.c_str(), &status) != 0)
+    { return false; }
+    isDirectory = ((status.st_mode & _S_IFDIR) != 0);
+    lastModifiedNanoseconds = 0;
+#else /* POSIX */
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    { return false; }
+    isDirectory = S_ISDIR(status.st_mode);
+#    ifdef __APPLE__
+    lastModifiedNanoseconds = status.st_mtimespec.tv_nsec;
+#    else
+    lastModifiedNanoseconds = status.st_mtim.tv_nsec;
+#    endif
+#endif /* _WIN32 / POSIX */
+    size = (uint64_t)status.st_size;
+    lastModified = (time_t)status.st_mtime;
+    inode = (uint64_t)status.st_ino;
+    return true;
+}
+
+bool FileVersion::operator==(const FileVersion& other) const {
+    return ((isDirectory == other.isDirectory) && (size == other.size) &&
+            (lastModified == other.lastModified) &&
+            (lastModifiedNanoseconds == other.lastModifiedNanoseconds) && (inode == other.inode));
+}
+
+bool FileVersion::operator!=(const FileVersion& other) const {
+    return !(*this == other);
+}
+
+struct EntityTagTable::Impl
+{
+    // Types
+
+    /**
+     * This holds the entity tag computed for one version of a file.
+     */
+    struct Record
+    {
+        /**
+         * This is the version of the file from which
+         * the entity tag was computed.
+         */
+        FileVersion version;
+
+        /**
+         * This is the entity tag of the file.
+         */
+        std::string etag;
+    };
+
+    // Properties
+
+    /**
+     * This synchronizes access to the records.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * This is the maximum number of files to remember.
+     */
+    size_t capacity = 0;
+
+    /**
+     * These are the entity tags remembered, keyed by file path.
+     */
+    std::unordered_map<std::string, Record> records;
+};
+
+EntityTagTable::~EntityTagTable() noexcept = default;
+
+EntityTagTable::EntityTagTable(size_t capacity) : impl_(new Impl()) {
+    impl_->capacity = capacity;
+}
+
+std::string EntityTagTable::Find(const std::string& path, const FileVersion& version) const {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    const auto record = impl_->records.find(path);
+    if ((record == impl_->records.end()) || (record->second.version != version))
+    { return ""; }
+    return record->second.etag;
+}
+
+void EntityTagTable::Remember(const std::string& path, const FileVersion& version,
+                              const std::string& etag) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    if ((impl_->records.size() >= impl_->capacity) &&
+        (impl_->records.find(path) == impl_->records.end()))
+    {
+        if (impl_->capacity == 0)
+        { return; }
+        (void)impl_->records.erase(impl_->records.begin());
+    }
+    auto& record = impl_->records[path];
+    record.version = version;
+    record.etag = etag;
+}
@@ -0,0 +1,166 @@
+#ifndef STATIC_CONTENT_PLUGIN_FILE_VERSION_HPP
+#define STATIC_CONTENT_PLUGIN_FILE_VERSION_HPP
+
+/**
+ * @file FileVersion.hpp
+ *
+ * This module declares the FileVersion structure
+ * and the EntityTagTable class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <memory>
+#include <string>
+
+/**
+ * This identifies one version of a file, from the metadata
+ * the file system keeps about it.
+ */
+struct FileVersion
+{
+    // Properties
+
+    /**
+     * This indicates whether or not the path designates a directory.
+     */
+    bool isDirectory = false;
+
+    /**
+     * This is the size of the file, in bytes.
+     */
+    uint64_t size = 0;
+
+    /**
+     * This is the time the file was last modified,
+     * in seconds since the UNIX epoch.
+     */
+    time_t lastModified = 0;
+
+    /**
+     * This is the sub-second part of the time the file
+     * was last modified, in nanoseconds.
+     */
+    long lastModifiedNanoseconds = 0;
+
+    /**
+     * This identifies the file within its file system.
+     */
+    uint64_t inode = 0;
+
+    // Methods
+
+    /**
+     * This method reads the version of the file at the given path.
+     *
+     * @param[in] path
+     *      This is the path of the file whose version to read.
+     *
+     * @return
+     *      An indication of whether or not the file exists
+     *      is returned.
+     */
+    bool Read(const std::string& path);
+
+    /**
+     * This is the equality comparison operator.
+     *
+     * @param[in] other
+     *      This is the other version to compare with this one.
+     *
+     * @return
+     *      An indication of whether or not the two versions
+     *      are the same is returned.
+     */
+    bool operator==(const FileVersion& other) const;
+
+    /**
+     * This is the inequality comparison operator.
+     *
+     * @param[in] other
+     *      This is the other version to compare with this one.
+     *
+     * @return
+     *      An indication of whether or not the two versions
+     *      are different is returned.
+     */
+    bool operator!=(const FileVersion& other) const;
+};
+
+/**
+ * This class remembers the entity tags computed for the files served,
+ * along with the version of each file for which they were computed,
+ * so that the content of a file only needs to be hashed the first time
+ * each version of it is seen.
+ */
+class EntityTagTable
+{
+    // Lifecycle Methods
+public:
+    ~EntityTagTable() noexcept;
+    EntityTagTable(const EntityTagTable&) = delete;
+    EntityTagTable(EntityTagTable&&) noexcept = delete;
+    EntityTagTable& operator=(const EntityTagTable&) = delete;
+    EntityTagTable& operator=(EntityTagTable&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] capacity
+     *      This is the maximum number of files to remember.
+     */
+    explicit EntityTagTable(size_t capacity);
+
+    /**
+     * This method looks up the entity tag computed for the given version
+     * of the file at the given path.
+     *
+     * @param[in] path
+     *      This is the path of the file whose entity tag to look up.
+     *
+     * @param[in] version
+     *      This is the current version of the file.
+     *
+     * @return
+     *      The entity tag of the given version of the file is returned,
+     *      or an empty string if it is not known.
+     */
+    std::string Find(const std::string& path, const FileVersion& version) const;
+
+    /**
+     * This method remembers the entity tag computed for the given version
+     * of the file at the given path.
+     *
+     * @param[in] path
+     *      This is the path of the file whose entity tag to remember.
+     *
+     * @param[in] version
+     *      This is the version of the file from which the
+     *      entity tag was computed.
+     *
+     * @param[in] etag
+     *      This is the entity tag to remember.
+     */
+    void Remember(const std::string& path, const FileVersion& version, const std::string& etag);
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* STATIC_CONTENT_PLUGIN_FILE_VERSION_HPP */
@@ -0,0 +1,136 @@
+/**
+ * @file PathResolver.cpp
+ *
+ * This module contains the implementation of the PathResolver class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include "PathResolver.hpp"
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    /**
+     * This computes hash values for sequences of path segments,
+     * so that they can be used as keys without being joined first.
+     */
+    struct SegmentsHash
+    {
+        size_t operator()(const std::vector<std::string>& segments) const {
+            std::hash<std::string> segmentHash;
+            size_t hash = segments.size();
+            for (const auto& segment : segments)
+            { hash ^= segmentHash(segment) + 0x9e3779b9 + (hash << 6) + (hash >> 2); }
+            return hash;
+        }
+    };
+
+    /**
+     * This determines whether or not the given path segment could
+     * designate something other than a single entry of a directory,
+     * once decoded from the request target.
+     *
+     * @param[in] segment
+     *      This is the path segment to check.
+     *
+     * @return
+     *      An indication of whether or not the segment
+     *      is unsafe is returned.
+     */
+    bool IsUnsafeSegment(const std::string& segment) {
+        return (segment.find_first_of(std::string("/\\:\0", 4)) != std::string::npos);
+    }
+}  // namespace
+
+struct PathResolver::Impl
+{
+    // Properties
+
+    /**
+     * This synchronizes access to the resolutions.
+     */
+    std::mutex mutex;
+
+    /**
+     * This is the path of the directory under which
+     * resources are resolved.
+     */
+    std::string root;
+
+    /**
+     * This is the maximum number of resolutions to remember.
+     */
+    size_t capacity = 0;
+
+    /**
+     * These are the resolutions remembered, keyed by path segments.
+     */
+    std::unordered_map<std::vector<std::string>, std::shared_ptr<const std::string>, SegmentsHash>
+        resolutions;
+
+    // Methods
+
+    /**
+     * This method builds the path of the file designated by the given
+     * path segments, normalising dot segments along the way.
+     *
+     * @param[in] segments
+     *      These are the path segments of the requested resource.
+     *
+     * @return
+     *      The path of the file is returned, or nullptr if the
+     *      segments can't designate a file under the root directory.
+     */
+    std::shared_ptr<const std::string> Build(const std::vector<std::string>& segments) {
+        std::vector<const std::string*> normalized;
+        normalized.reserve(segments.size());
+        for (const auto& segment : segments)
+        {
+            if (IsUnsafeSegment(segment))
+            { return nullptr; }
+            if (segment == "..")
+            {
+                // Going up from the root directory stays in it,
+                // as with RFC 3986 dot-segment removal.
+                if (!normalized.empty())
+                { normalized.pop_back(); }
+            } else if (!segment.empty() && (segment != "."))
+            { normalized.push_back(&segment); }
+        }
+        auto path = std::make_shared<std::string>(root);
+        for (const auto segment : normalized)
+        {
+            path->push_back('/');
+            path->append(*segment);
+        }
+        return path;
+    }
+};
+
+PathResolver::~PathResolver() noexcept = default;
+
+PathResolver::PathResolver(const std::string& root, size_t capacity) : impl_(new Impl()) {
+    impl_->root = root;
+    impl_->capacity = capacity;
+}
+
+std::shared_ptr<const std::string> PathResolver::Resolve(
+    const std::vector<std::string>& segments) {
+    std::lock_guard<decltype(impl_->mutex)> lock(impl_->mutex);
+    const auto resolution = impl_->resolutions.find(segments);
+    if (resolution != impl_->resolutions.end())
+    { return resolution->second; }
+    const auto path = impl_->Build(segments);
+    if (path == nullptr)
+    { return nullptr; }
+    if (impl_->resolutions.size() >= impl_->capacity)
+    {
+        if (impl_->capacity == 0)
+        { return path; }
+        (void)impl_->resolutions.erase(impl_->resolutions.begin());
+    }
+    impl_->resolutions[segments] = path;
+    return path;
+}
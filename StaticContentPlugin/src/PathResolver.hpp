@@ -0,0 +1,79 @@
+#ifndef STATIC_CONTENT_PLUGIN_PATH_RESOLVER_HPP
+#define STATIC_CONTENT_PLUGIN_PATH_RESOLVER_HPP
+
+/**
+ * @file PathResolver.hpp
+ *
+ * This module declares the PathResolver class.
+ *
+ * © 2024 by Hatem Nabli
+ */
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * This class resolves the path segments of requested resources into
+ * the paths of the files to serve under a root directory, remembering
+ * the most recent resolutions so that repeated requests for the same
+ * resource don't need to build the path again.
+ *
+ * Dot segments are normalised during resolution, and ".." segments
+ * can never lead outside of the root directory.
+ */
+class PathResolver
+{
+    // Lifecycle Methods
+public:
+    ~PathResolver() noexcept;
+    PathResolver(const PathResolver&) = delete;
+    PathResolver(PathResolver&&) noexcept = delete;
+    PathResolver& operator=(const PathResolver&) = delete;
+    PathResolver& operator=(PathResolver&&) noexcept = delete;
+
+    // Public methods
+public:
+    /**
+     * This is the constructor of the class.
+     *
+     * @param[in] root
+     *      This is the path of the directory under which
+     *      resources are resolved.
+     *
+     * @param[in] capacity
+     *      This is the maximum number of resolutions to remember.
+     */
+    PathResolver(const std::string& root, size_t capacity);
+
+    /**
+     * This method resolves the given path segments of a requested
+     * resource into the path of the file to serve.
+     *
+     * @param[in] segments
+     *      These are the path segments of the requested resource,
+     *      relative to the root directory.
+     *
+     * @return
+     *      The path of the file to serve is returned, or nullptr if
+     *      the segments can't designate a file under the root directory.
+     */
+    std::shared_ptr<const std::string> Resolve(const std::vector<std::string>& segments);
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance. It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::unique_ptr<struct Impl> impl_;
+};
+
+#endif /* STATIC_CONTENT_PLUGIN_PATH_RESOLVER_HPP */
@@ -7,13 +7,27 @@
  * © 2024 by Hatem Nabli
  */
 
+#include <ctype.h>
 #include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <Http/IServer.hpp>
 #include <Json/Json.hpp>
 #include <StringUtils/StringUtils.hpp>
 #include <SystemUtils/File.hpp>
 #include <WebServer/PluginEntryPoint.hpp>
+#include <algorithm>
 #include <functional>
+#include <memory>
+#include <vector>
+#include "AssetPack.hpp"
+#include "ContentCache.hpp"
+#include "ContentHash.hpp"
+#include "ContentType.hpp"
+#include "FileVersion.hpp"
+#include "PathResolver.hpp"
 
 #ifdef _WIN32
 #    define API __declspec(dllexport)
@@ -23,6 +37,96 @@
 
 namespace
 {
+    /**
+     * This is the default maximum number of bytes of file content
+     * to keep cached in memory for each resource space.
+     */
+    constexpr size_t DEFAULT_CACHE_BUDGET = 32 * 1024 * 1024;
+
+    /**
+     * This is the default maximum number of directories to watch
+     * for changes at a time in each resource space. Each takes
+     * a thread and a watch of the operating system.
+     */
+    constexpr size_t DEFAULT_WATCH_LIMIT = 256;
+
+    /**
+     * This is the maximum number of files for which to remember
+     * the entity tag in each resource space.
+     */
+    constexpr size_t ENTITY_TAG_TABLE_CAPACITY = 4096;
+
+    /**
+     * This is the maximum number of resource paths for which to remember
+     * the file they resolve to in each resource space.
+     */
+    constexpr size_t PATH_RESOLVER_CAPACITY = 4096;
+
+    /**
+     * This is the body of the response given for files which don't exist.
+     */
+    constexpr const char* NOT_FOUND_BODY = "File not found.";
+
+    /**
+     * This is the maximum number of ranges honored in a single request.
+     * Requests asking for more are answered with the whole file.
+     */
+    constexpr size_t MAX_RANGES = 16;
+
+    /**
+     * This is the lifetime, in seconds, given to files whose name
+     * carries a fingerprint of their content (one year).
+     */
+    constexpr int IMMUTABLE_MAX_AGE = 365 * 24 * 60 * 60;
+
+    /**
+     * This is the minimum number of hexadecimal digits a part of
+     * a file name must have to be considered a content fingerprint.
+     */
+    constexpr size_t MIN_FINGERPRINT_LENGTH = 6;
+
+    /**
+     * This describes how clients may cache the files served
+     * from one resource space.
+     */
+    struct CachePolicy
+    {
+        /**
+         * This is the lifetime, in seconds, given to files, or
+         * a negative number if no lifetime should be given.
+         */
+        int maxAge = -1;
+
+        /**
+         * This indicates whether or not files whose name carries
+         * a fingerprint of their content are given a one-year lifetime
+         * and marked as immutable.
+         */
+        bool immutable = false;
+
+        /**
+         * These are the names of the files which clients
+         * must always revalidate before using a cached copy.
+         */
+        std::vector<std::string> noCache = {"index.html"};
+    };
+
+    /**
+     * This identifies one range of bytes of a file, inclusively.
+     */
+    struct ByteRange
+    {
+        /**
+         * This is the offset of the first byte of the range.
+         */
+        size_t first = 0;
+
+        /**
+         * This is the offset of the last byte of the range.
+         */
+        size_t last = 0;
+    };
+
     /**
      * This represents one space of server resources and how they
      * should be mapped to the file system.
@@ -39,6 +143,35 @@ namespace
          */
         std::string root;
 
+        /**
+         * This holds the content of the files most recently served
+         * from the resource space.
+         */
+        std::shared_ptr<ContentCache> cache;
+
+        /**
+         * This describes how clients may cache the files served
+         * from the resource space.
+         */
+        CachePolicy cachePolicy;
+
+        /**
+         * This holds the entity tags computed for the files served
+         * from the resource space.
+         */
+        std::shared_ptr<EntityTagTable> etags;
+
+        /**
+         * This resolves requested resources into the files to serve.
+         */
+        std::shared_ptr<PathResolver> resolver;
+
+        /**
+         * If the files of the resource space are served from an
+         * asset pack rather than from a directory, this holds the pack.
+         */
+        std::shared_ptr<LiveAssetPack> pack;
+
         /**
          * This is the function to call in order to unregister
          * the plug-in as handling this server resource space.
@@ -84,20 +217,1006 @@ namespace
         (void)spaceMapping.space.erase(spaceMapping.space.begin());
 
         // Detrmine where to locate the static content.
-        if (!configuration.Has("root"))
+        if (configuration.Has("pack"))
+        {
+            spaceMapping.root = (std::string)configuration["pack"];
+        } else if (configuration.Has("root"))
+        {
+            spaceMapping.root = (std::string)configuration["root"];
+        } else
         {
             diagnosticMessageDelegate("", SystemUtils::DiagnosticsSender::Levels::ERROR,
                                       "no 'root' URI in confuguration");
             return false;
         }
-        spaceMapping.root = (std::string)configuration["root"];
         if (!SystemUtils::File::IsAbsolutePath(spaceMapping.root))
         {
             spaceMapping.root =
                 SystemUtils::File::GetExeParentDirectory() + "/" + spaceMapping.root;
         }
+
+        // Determine how much content may be cached in memory.
+        size_t cacheBudget = DEFAULT_CACHE_BUDGET;
+        if (configuration.Has("cache-budget"))
+        {
+            const auto configuredCacheBudget = (int)configuration["cache-budget"];
+            cacheBudget = (configuredCacheBudget > 0) ? (size_t)configuredCacheBudget : 0;
+        }
+
+        // Determine how many directories may be watched for changes.
+        size_t watchLimit = DEFAULT_WATCH_LIMIT;
+        if (configuration.Has("watch-limit"))
+        {
+            const auto configuredWatchLimit = (int)configuration["watch-limit"];
+            watchLimit = (configuredWatchLimit > 0) ? (size_t)configuredWatchLimit : 1;
+        }
+        spaceMapping.cache = std::make_shared<ContentCache>(cacheBudget, watchLimit);
+        spaceMapping.etags = std::make_shared<EntityTagTable>(ENTITY_TAG_TABLE_CAPACITY);
+        spaceMapping.resolver =
+            std::make_shared<PathResolver>(spaceMapping.root, PATH_RESOLVER_CAPACITY);
+        if (configuration.Has("pack"))
+        {
+            spaceMapping.pack =
+                std::make_shared<LiveAssetPack>(spaceMapping.root, spaceMapping.root);
+        }
+
+        // Determine how clients may cache the files served.
+        if (configuration.Has("cache-control"))
+        {
+            const auto cacheControl = configuration["cache-control"];
+            if (cacheControl.GetType() != Json::Value::Type::Object)
+            {
+                diagnosticMessageDelegate("", SystemUtils::DiagnosticsSender::Levels::ERROR,
+                                          "'cache-control' in configuration is not an object");
+                return false;
+            }
+            auto& cachePolicy = spaceMapping.cachePolicy;
+            if (cacheControl.Has("max-age"))
+            { cachePolicy.maxAge = std::max((int)cacheControl["max-age"], 0); }
+            if (cacheControl.Has("immutable"))
+            { cachePolicy.immutable = (bool)cacheControl["immutable"]; }
+            if (cacheControl.Has("no-cache"))
+            {
+                const auto noCache = cacheControl["no-cache"];
+                if (noCache.GetType() != Json::Value::Type::Array)
+                {
+                    diagnosticMessageDelegate(
+                        "", SystemUtils::DiagnosticsSender::Levels::ERROR,
+                        "'no-cache' in 'cache-control' configuration is not an array");
+                    return false;
+                }
+                cachePolicy.noCache.clear();
+                for (size_t i = 0; i < noCache.GetSize(); ++i)
+                { cachePolicy.noCache.push_back((std::string)noCache[i]); }
+            }
+        }
         return true;
     }
+
+    /**
+     * This function formats the given time as an HTTP-date
+     * (RFC 7231 section 7.1.1.1).
+     *
+     * @param[in] time
+     *      This is the time to format, in seconds since the UNIX epoch.
+     *
+     * @return
+     *      The formatted time is returned.
+     */
+    std::string FormatHttpDate(time_t time) {
+        static const char* const days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        static const char* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                             "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        struct tm fields;
+#ifdef _WIN32
+        (void)gmtime_s(&fields, &time);
+#else /* POSIX */
+        (void)gmtime_r(&time, &fields);
+#endif /* _WIN32 / POSIX */
+        return StringUtils::sprintf("%s, %02d %s %04d %02d:%02d:%02d GMT", days[fields.tm_wday],
+                                    fields.tm_mday, months[fields.tm_mon], fields.tm_year + 1900,
+                                    fields.tm_hour, fields.tm_min, fields.tm_sec);
+    }
+
+    /**
+     * This function parses the given HTTP-date, in the preferred
+     * IMF-fixdate format (RFC 7231 section 7.1.1.1).
+     *
+     * @param[in] date
+     *      This is the date to parse.
+     *
+     * @param[out] time
+     *      This is where to store the parsed time,
+     *      in seconds since the UNIX epoch.
+     *
+     * @return
+     *      An indication of whether or not the date
+     *      was successfully parsed is returned.
+     */
+    bool ParseHttpDate(const std::string& date, time_t& time) {
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        char month[4];
+        int day, year, hour, minute, second;
+        if (sscanf(date.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d GMT", &day, month, &year, &hour,
+                   &minute, &second) != 6)
+        { return false; }
+        const auto monthName = strstr(months, month);
+        if ((monthName == NULL) || (((monthName - months) % 3) != 0))
+        { return false; }
+
+        // Count days since the epoch in the proleptic Gregorian
+        // calendar, with years starting in March.
+        const int monthIndex = (int)((monthName - months) / 3) + 1;
+        const int y = year - ((monthIndex <= 2) ? 1 : 0);
+        const int era = ((y >= 0) ? y : (y - 399)) / 400;
+        const int yearOfEra = y - era * 400;
+        const int dayOfYear = (153 * (monthIndex + ((monthIndex > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+        const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        const int64_t days = (int64_t)era * 146097 + dayOfEra - 719468;
+        time = (time_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+        return true;
+    }
+
+    /**
+     * This function determines whether or not the given entity tag
+     * is listed in the given "If-None-Match" header value.
+     *
+     * @param[in] ifNoneMatch
+     *      This is the value of the "If-None-Match" header of the request.
+     *
+     * @param[in] etag
+     *      This is the entity tag of the representation requested.
+     *
+     * @return
+     *      An indication of whether or not the entity tag
+     *      is listed is returned.
+     */
+    bool IsEntityTagListed(const std::string& ifNoneMatch, const std::string& etag) {
+        size_t elementStart = 0;
+        while (elementStart < ifNoneMatch.length())
+        {
+            auto elementEnd = ifNoneMatch.find(',', elementStart);
+            if (elementEnd == std::string::npos)
+            { elementEnd = ifNoneMatch.length(); }
+            auto tagStart = ifNoneMatch.find_first_not_of(" \t", elementStart);
+            if (tagStart == std::string::npos)
+            { break; }
+            if (tagStart >= elementEnd)
+            {
+                elementStart = elementEnd + 1;
+                continue;
+            }
+            const auto tagEnd = ifNoneMatch.find_last_not_of(" \t", elementEnd - 1) + 1;
+            if ((tagStart < tagEnd) && (ifNoneMatch[tagStart] == '*'))
+            { return true; }
+
+            // If-None-Match uses the weak comparison function.
+            if (ifNoneMatch.compare(tagStart, 2, "W/") == 0)
+            { tagStart += 2; }
+            if ((tagStart < tagEnd) && (tagEnd - tagStart == etag.length()) &&
+                (ifNoneMatch.compare(tagStart, etag.length(), etag) == 0))
+            { return true; }
+            elementStart = elementEnd + 1;
+        }
+        return false;
+    }
+
+    /**
+     * This function determines whether or not the client already holds
+     * the current representation of the requested file, according to the
+     * conditional headers of the request (RFC 7232 section 6).
+     *
+     * @param[in] request
+     *      This is the request for the file.
+     *
+     * @param[in] etag
+     *      This is the entity tag of the representation requested.
+     *
+     * @param[in] lastModified
+     *      This is the time the file was last modified.
+     *
+     * @return
+     *      An indication of whether or not the client already holds
+     *      the current representation is returned.
+     */
+    bool IsNotModified(const Http::IServer::Request& request, const std::string& etag,
+                       time_t lastModified) {
+        if (request.headers.HasHeader("If-None-Match"))
+        { return IsEntityTagListed(request.headers.GetHeaderValue("If-None-Match"), etag); }
+        time_t ifModifiedSince;
+        return (request.headers.HasHeader("If-Modified-Since") &&
+                ParseHttpDate(request.headers.GetHeaderValue("If-Modified-Since"),
+                              ifModifiedSince) &&
+                (lastModified <= ifModifiedSince));
+    }
+
+    /**
+     * This function fills in the given response to report
+     * a failure to serve the requested file.
+     *
+     * @param[in, out] response
+     *      This is the response to fill in.
+     *
+     * @param[in] statusCode
+     *      This is the status code to report.
+     *
+     * @param[in] status
+     *      This is the reason phrase to report.
+     *
+     * @param[in] body
+     *      This is the message to give in the body of the response.
+     */
+    void Fail(Http::Client::Response& response, unsigned int statusCode, const std::string& status,
+              const std::string& body) {
+        response.statusCode = statusCode;
+        response.status = status;
+        response.headers.AddHeader("Content-Type", "text/plain");
+        response.body = body;
+    }
+
+    /**
+     * This function determines how much the client prefers the given
+     * content coding, according to the given "Accept-Encoding" header value.
+     *
+     * @param[in] acceptEncoding
+     *      This is the value of the "Accept-Encoding" header of the request.
+     *
+     * @param[in] encoding
+     *      This is the content coding whose quality to determine.
+     *
+     * @return
+     *      The quality value the client gives to the content coding,
+     *      between 0 and 1, is returned. If the client mentions neither
+     *      the content coding nor "*", a negative value is returned.
+     */
+    double GetEncodingQuality(const std::string& acceptEncoding, const std::string& encoding) {
+        double wildcardQuality = -1.0;
+        size_t elementStart = 0;
+        while (elementStart < acceptEncoding.length())
+        {
+            auto elementEnd = acceptEncoding.find(',', elementStart);
+            if (elementEnd == std::string::npos)
+            { elementEnd = acceptEncoding.length(); }
+            auto nameStart = acceptEncoding.find_first_not_of(" \t", elementStart);
+            auto nameEnd = acceptEncoding.find_first_of(" \t;", nameStart);
+            if ((nameEnd == std::string::npos) || (nameEnd > elementEnd))
+            { nameEnd = elementEnd; }
+            double quality = 1.0;
+            const auto parameters = acceptEncoding.find(';', nameStart);
+            if (parameters < elementEnd)
+            {
+                const auto q = acceptEncoding.find("q=", parameters);
+                if (q < elementEnd)
+                { quality = strtod(acceptEncoding.c_str() + q + 2, NULL); }
+            }
+            if ((nameEnd - nameStart == encoding.length()) &&
+                std::equal(encoding.begin(), encoding.end(), acceptEncoding.begin() + nameStart,
+                           [](char a, char b) { return tolower(a) == tolower(b); }))
+            { return quality; }
+            if ((nameEnd == nameStart + 1) && (acceptEncoding[nameStart] == '*'))
+            { wildcardQuality = quality; }
+            elementStart = elementEnd + 1;
+        }
+        return wildcardQuality;
+    }
+
+    /**
+     * This function selects which representation of a file to serve,
+     * based on the "Accept-Encoding" header of the request.
+     *
+     * @param[in] request
+     *      This is the request for the file.
+     *
+     * @param[in] variants
+     *      These are the precompressed representations of the file,
+     *      in order of preference.
+     *
+     * @return
+     *      The precompressed representation to serve is returned,
+     *      or nullptr if the file should be served as is.
+     */
+    const ContentCache::Entry::Variant* SelectVariant(
+        const Http::IServer::Request& request,
+        const std::vector<ContentCache::Entry::Variant>& variants) {
+        if (variants.empty() || !request.headers.HasHeader("Accept-Encoding"))
+        { return nullptr; }
+        const auto acceptEncoding = request.headers.GetHeaderValue("Accept-Encoding");
+        auto identityQuality = GetEncodingQuality(acceptEncoding, "identity");
+        if (identityQuality < 0.0)
+        { identityQuality = 1.0; }
+        const ContentCache::Entry::Variant* selectedVariant = nullptr;
+        double selectedQuality = 0.0;
+        for (const auto& variant : variants)
+        {
+            const auto quality = GetEncodingQuality(acceptEncoding, variant.encoding);
+            if (quality > selectedQuality)
+            {
+                selectedVariant = &variant;
+                selectedQuality = quality;
+            }
+        }
+        return (selectedQuality >= identityQuality) ? selectedVariant : nullptr;
+    }
+
+    /**
+     * This function sorts the given byte ranges and merges
+     * those which overlap or are adjacent.
+     *
+     * @param[in, out] ranges
+     *      These are the byte ranges to merge.
+     */
+    void MergeRanges(std::vector<ByteRange>& ranges) {
+        if (ranges.size() < 2)
+        { return; }
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const ByteRange& a, const ByteRange& b) { return (a.first < b.first); });
+        size_t merged = 0;
+        for (size_t i = 1; i < ranges.size(); ++i)
+        {
+            if (ranges[i].first <= ranges[merged].last + 1)
+            {
+                ranges[merged].last = std::max(ranges[merged].last, ranges[i].last);
+            } else
+            { ranges[++merged] = ranges[i]; }
+        }
+        ranges.resize(merged + 1);
+    }
+
+    /**
+     * This function parses the given "Range" header value
+     * (RFC 7233 section 3.1) against a file of the given size.
+     *
+     * @param[in] range
+     *      This is the value of the "Range" header of the request.
+     *
+     * @param[in] size
+     *      This is the size of the file, in bytes.
+     *
+     * @param[out] ranges
+     *      This is where to store the satisfiable ranges requested,
+     *      clipped to the size of the file, in order, with ranges which
+     *      overlap or are adjacent merged, so that no byte is served
+     *      more than once. It is left empty if none of the ranges
+     *      requested is satisfiable.
+     *
+     * @return
+     *      An indication of whether or not the header should be
+     *      honored is returned. It is not if it is malformed,
+     *      uses a unit other than bytes, or asks for too many ranges.
+     */
+    bool ParseRanges(const std::string& range, size_t size, std::vector<ByteRange>& ranges) {
+        if (range.compare(0, 6, "bytes=") != 0)
+        { return false; }
+        size_t elementStart = 6;
+        size_t numRanges = 0;
+        while (elementStart < range.length())
+        {
+            auto elementEnd = range.find(',', elementStart);
+            if (elementEnd == std::string::npos)
+            { elementEnd = range.length(); }
+            const auto element = range.substr(elementStart, elementEnd - elementStart);
+            elementStart = elementEnd + 1;
+            const auto specStart = element.find_first_not_of(" \t");
+            if (specStart == std::string::npos)
+            { continue; }
+            if (++numRanges > MAX_RANGES)
+            { return false; }
+            const auto specEnd = element.find_last_not_of(" \t") + 1;
+            const auto dash = element.find('-', specStart);
+            if ((dash == std::string::npos) ||
+                (element.find_first_not_of("0123456789", specStart) != dash) ||
+                (element.find_first_not_of("0123456789", dash + 1) < specEnd) ||
+                ((dash == specStart) && (dash + 1 == specEnd)))
+            { return false; }
+            ByteRange byteRange;
+            if (dash == specStart)
+            {
+                // Suffix range: the last bytes of the file.
+                const auto suffixLength = strtoull(element.c_str() + dash + 1, NULL, 10);
+                if ((suffixLength == 0) || (size == 0))
+                { continue; }
+                byteRange.first = (suffixLength >= size) ? 0 : (size_t)(size - suffixLength);
+                byteRange.last = size - 1;
+            } else
+            {
+                const auto first = strtoull(element.c_str() + specStart, NULL, 10);
+                auto last = (unsigned long long)size - 1;
+                if (dash + 1 < specEnd)
+                { last = strtoull(element.c_str() + dash + 1, NULL, 10); }
+                if ((dash + 1 < specEnd) && (last < first))
+                { return false; }
+                if (first >= size)
+                { continue; }
+                byteRange.first = (size_t)first;
+                byteRange.last = (last >= size) ? (size - 1) : (size_t)last;
+            }
+            ranges.push_back(byteRange);
+        }
+        MergeRanges(ranges);
+        return (numRanges > 0);
+    }
+
+    /**
+     * This function determines whether or not the "Range" header
+     * of the given request applies to the current representation
+     * of the requested file, according to its "If-Range" header.
+     *
+     * @param[in] request
+     *      This is the request for the file.
+     *
+     * @param[in] etag
+     *      This is the entity tag of the representation requested.
+     *
+     * @param[in] lastModified
+     *      This is the time the file was last modified.
+     *
+     * @return
+     *      An indication of whether or not the "Range" header applies
+     *      is returned.
+     */
+    bool IsRangeApplicable(const Http::IServer::Request& request, const std::string& etag,
+                           time_t lastModified) {
+        if (!request.headers.HasHeader("If-Range"))
+        { return true; }
+
+        // If-Range uses the strong comparison function, so weak
+        // entity tags never match.
+        const auto ifRange = request.headers.GetHeaderValue("If-Range");
+        if (!ifRange.empty() && (ifRange[0] == '"'))
+        { return (ifRange == etag); }
+        time_t date;
+        return (ParseHttpDate(ifRange, date) && (date == lastModified));
+    }
+
+    /**
+     * This function fills in the given response with the given ranges
+     * of the given file content, as a "206 Partial Content" response.
+     *
+     * @param[in] ranges
+     *      These are the ranges of the content to serve.
+     *
+     * @param[in] contentType
+     *      This is the media type of the content.
+     *
+     * @param[in] etag
+     *      This is the entity tag of the content.
+     *
+     * @param[in] data
+     *      This is the content from which to serve the ranges.
+     *
+     * @param[in] size
+     *      This is the number of bytes of content.
+     *
+     * @param[in, out] response
+     *      This is the response to fill in.
+     */
+    void RespondWithRanges(const std::vector<ByteRange>& ranges, const std::string& contentType,
+                           const std::string& etag, const char* data, size_t size,
+                           Http::Client::Response& response) {
+        response.statusCode = 206;
+        response.status = "Partial Content";
+        if (ranges.size() == 1)
+        {
+            const auto& range = ranges[0];
+            response.headers.AddHeader("Content-Type", contentType);
+            response.headers.AddHeader(
+                "Content-Range", StringUtils::sprintf("bytes %zu-%zu/%zu", range.first, range.last,
+                                                      size));
+            response.body.assign(data + range.first, range.last - range.first + 1);
+            return;
+        }
+        const auto boundary = "byteranges-" + etag.substr(1, etag.length() - 2);
+        response.headers.AddHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+        for (const auto& range : ranges)
+        {
+            response.body += StringUtils::sprintf(
+                "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n\r\n",
+                boundary.c_str(), contentType.c_str(), range.first, range.last, size);
+            response.body.append(data + range.first, range.last - range.first + 1);
+        }
+        response.body += "\r\n--" + boundary + "--\r\n";
+    }
+
+    /**
+     * This function fills in the given response with
+     * the given file content.
+     *
+     * @param[in] request
+     *      This is the request for the file.
+     *
+     * @param[in] entry
+     *      This holds the media type and entity tag of the file.
+     *
+     * @param[in] variant
+     *      This is the precompressed representation of the file to serve,
+     *      or nullptr if the file is served as is.
+     *
+     * @param[in] data
+     *      This is the content to serve. It may be nullptr if the
+     *      client is known to already hold the representation.
+     *
+     * @param[in] size
+     *      This is the number of bytes of content to serve.
+     *
+     * @param[in, out] response
+     *      This is the response to fill in.
+     *
+     * @param[in, out] content
+     *      If not nullptr, this holds the content to serve, which data
+     *      points to, and which may be moved into the body of the response
+     *      rather than copied.
+     */
+    void Respond(const Http::IServer::Request& request, const ContentCache::Entry& entry,
+                 const ContentCache::Entry::Variant* variant, const char* data, size_t size,
+                 Http::Client::Response& response, std::string* content = nullptr) {
+        const auto& etag = (variant == nullptr) ? entry.etag : variant->etag;
+        std::vector<ByteRange> ranges;
+        if (IsNotModified(request, etag, entry.lastModified))
+        {
+            response.statusCode = 304;
+            response.status = "Not Modified";
+            response.headers.AddHeader("Content-Type", entry.contentType);
+        } else if (
+            request.headers.HasHeader("Range") &&
+            IsRangeApplicable(request, etag, entry.lastModified) &&
+            ParseRanges(request.headers.GetHeaderValue("Range"), size, ranges))
+        {
+            if (ranges.empty())
+            {
+                response.statusCode = 416;
+                response.status = "Range Not Satisfiable";
+                response.headers.AddHeader("Content-Range",
+                                           StringUtils::sprintf("bytes */%zu", size));
+            } else
+            { RespondWithRanges(ranges, entry.contentType, etag, data, size, response); }
+        } else
+        {
+            response.statusCode = 200;
+            response.status = "OK";
+            response.headers.AddHeader("Content-Type", entry.contentType);
+            if (content == nullptr)
+            {
+                response.body.assign(data, size);
+            } else
+            { response.body = std::move(*content); }
+        }
+        response.headers.AddHeader("Accept-Ranges", "bytes");
+        if (variant != nullptr)
+        { response.headers.SetHeader("Content-Encoding", variant->encoding); }
+        if (!entry.variants.empty())
+        { response.headers.AddHeader("Vary", "Accept-Encoding"); }
+        response.headers.AddHeader("Etag", etag);
+        response.headers.AddHeader("Last-Modified", FormatHttpDate(entry.lastModified));
+    }
+
+    /**
+     * This function looks for precompressed representations of the file
+     * at the given path, stored next to it with the extension of their
+     * content coding. Any which is older than the file itself is ignored.
+     *
+     * @param[in] path
+     *      This is the path of the file.
+     *
+     * @param[in] version
+     *      This is the version of the file.
+     *
+     * @param[out] variants
+     *      This is where to store the precompressed representations found,
+     *      without their content.
+     *
+     * @param[out] variantVersions
+     *      This is where to store the version of the file holding
+     *      each precompressed representation found.
+     */
+    void FindVariants(const std::string& path, const FileVersion& version,
+                      std::vector<ContentCache::Entry::Variant>& variants,
+                      std::vector<FileVersion>& variantVersions) {
+        for (const auto& sidecar : SIDECARS)
+        {
+            FileVersion variantVersion;
+            if (variantVersion.Read(path + sidecar.extension) && !variantVersion.isDirectory &&
+                (variantVersion.lastModified >= version.lastModified))
+            {
+                ContentCache::Entry::Variant variant;
+                variant.encoding = sidecar.encoding;
+                variants.push_back(std::move(variant));
+                variantVersions.push_back(variantVersion);
+            }
+        }
+    }
+
+    /**
+     * This function returns the entity tag of the given version of the
+     * given file content, computing it only if this version of the file
+     * has not been seen before.
+     *
+     * @param[in, out] etags
+     *      This holds the entity tags already computed.
+     *
+     * @param[in] path
+     *      This is the path of the file.
+     *
+     * @param[in] version
+     *      This is the version of the file.
+     *
+     * @param[in] content
+     *      This is the content of the file.
+     *
+     * @return
+     *      The entity tag of the file content is returned.
+     */
+    std::string GetEntityTag(EntityTagTable& etags, const std::string& path,
+                             const FileVersion& version, const std::string& content) {
+        auto etag = etags.Find(path, version);
+        if (etag.empty())
+        {
+            etag = ComputeEntityTag(content.data(), content.length());
+            etags.Remember(path, version, etag);
+        }
+        return etag;
+    }
+
+    /**
+     * This function reads the whole content of the given version
+     * of the file at the given path.
+     *
+     * @param[in] path
+     *      This is the path of the file to read.
+     *
+     * @param[in] version
+     *      This is the version of the file expected.
+     *
+     * @param[out] content
+     *      This is where to store the content of the file.
+     *
+     * @return
+     *      An indication of whether or not the file was read whole
+     *      is returned. It isn't if it got shorter while being read.
+     */
+    bool ReadFile(const std::string& path, const FileVersion& version, std::string& content) {
+        SystemUtils::File file(path);
+        if (!file.OpenReadOnly())
+        { return false; }
+        content.resize((size_t)version.size);
+        return (content.empty() || (file.Read(&content[0], content.length()) == content.length()));
+    }
+
+    /**
+     * This function returns the extension of the files holding content
+     * precompressed with the given content coding.
+     *
+     * @param[in] encoding
+     *      This is the content coding whose extension to return.
+     *
+     * @return
+     *      The extension of files with the given content coding is returned.
+     */
+    std::string GetSidecarExtension(const std::string& encoding) {
+        for (const auto& sidecar : SIDECARS)
+        {
+            if (encoding == sidecar.encoding)
+            { return sidecar.extension; }
+        }
+        return "";
+    }
+
+    /**
+     * This function remembers that the file at the given path doesn't
+     * exist, until the nearest existing directory in which it would
+     * appear changes, so that further requests for it don't touch
+     * the file system.
+     *
+     * @param[in] spaceMapping
+     *      This is the resource space in which the file was requested.
+     *
+     * @param[in] path
+     *      This is the path of the missing file.
+     */
+    void RememberMissing(const SpaceMapping& spaceMapping, const std::string& path) {
+        auto directory = path;
+        while (directory.length() > spaceMapping.root.length())
+        {
+            directory = directory.substr(0, directory.find_last_of('/'));
+            if (!spaceMapping.cache->Watch(directory))
+            { continue; }
+
+            // Look for the file again now that the directory is watched,
+            // since it may have been created before the watch started.
+            const auto generation = spaceMapping.cache->GetGeneration();
+            FileVersion version;
+            if (!version.Read(path) || version.isDirectory)
+            { (void)spaceMapping.cache->InsertMissing(path, directory, generation); }
+            return;
+        }
+    }
+
+    /**
+     * This function handles a request for a file which is not cached,
+     * adding it to the cache if it fits within the cache budget.
+     *
+     * The file is read straight into the cache entry, or, if it can't be
+     * cached, into a buffer which then becomes the body of the response,
+     * so that its content is held only once, and only in the representation
+     * the client asked for. The body still holds the whole representation,
+     * since the server API has no way to send a response body in pieces.
+     *
+     * @param[in] spaceMapping
+     *      This is the resource space from which the file is served.
+     *
+     * @param[in] path
+     *      This is the path of the requested file.
+     *
+     * @param[in] request
+     *      This is the request for the file.
+     *
+     * @param[in, out] response
+     *      This is the response to fill in.
+     */
+    void ServeFile(const SpaceMapping& spaceMapping, const std::string& path,
+                   const Http::IServer::Request& request, Http::Client::Response& response) {
+        // Start watching the directory before looking at the file, and
+        // only then sample the generation, so that a change made while
+        // the file is being read is not missed.
+        const auto directory = path.substr(0, path.find_last_of('/'));
+        const auto watched = spaceMapping.cache->Watch(directory);
+        const auto generation = spaceMapping.cache->GetGeneration();
+        FileVersion version;
+        if (!version.Read(path) || version.isDirectory)
+        {
+            RememberMissing(spaceMapping, path);
+            Fail(response, 404, "Not Found", NOT_FOUND_BODY);
+            return;
+        }
+        const auto cacheable = watched && (version.size <= spaceMapping.cache->GetBudget());
+        const auto entry = std::make_shared<ContentCache::Entry>();
+        entry->contentType = GetContentType(path, entry->compressible);
+        entry->lastModified = version.lastModified;
+        std::vector<FileVersion> variantVersions;
+        if (entry->compressible)
+        { FindVariants(path, version, entry->variants, variantVersions); }
+
+        // Answer without reading the file if the client already holds the
+        // representation it asks for, going by the entity tag remembered
+        // for this version of it.
+        const auto variant = SelectVariant(request, entry->variants);
+        ContentCache::Entry::Variant selectedVariant;
+        auto variantPath = path;
+        auto variantVersion = version;
+        if (variant != nullptr)
+        {
+            selectedVariant.encoding = variant->encoding;
+            variantPath += GetSidecarExtension(variant->encoding);
+            variantVersion = variantVersions[variant - entry->variants.data()];
+        }
+        auto etag = spaceMapping.etags->Find(variantPath, variantVersion);
+        const auto notModified =
+            !etag.empty() &&
+            IsNotModified(request,
+                          (variant == nullptr)
+                              ? etag
+                              : GetVariantEntityTag(etag, selectedVariant.encoding),
+                          entry->lastModified);
+        if (!cacheable || notModified)
+        {
+            // Only read the representation the client asked for.
+            std::string content;
+            if (!notModified)
+            {
+                if (!ReadFile(variantPath, variantVersion, content))
+                {
+                    Fail(response, 500, "Unable to read the file",
+                         StringUtils::sprintf("Error reading the file '%s'",
+                                              variantPath.c_str()));
+                    return;
+                }
+                etag = GetEntityTag(*spaceMapping.etags, variantPath, variantVersion, content);
+            }
+            if (variant == nullptr)
+            {
+                entry->etag = etag;
+            } else
+            { selectedVariant.etag = GetVariantEntityTag(etag, selectedVariant.encoding); }
+            Respond(request, *entry, (variant == nullptr) ? nullptr : &selectedVariant,
+                    content.data(), content.length(), response, &content);
+            return;
+        }
+        if (!ReadFile(path, version, entry->body))
+        {
+            Fail(response, 500, "Unable to read the file",
+                 StringUtils::sprintf("Error reading the file '%s'", path.c_str()));
+            return;
+        }
+        entry->etag = GetEntityTag(*spaceMapping.etags, path, version, entry->body);
+        for (size_t i = 0; i < entry->variants.size();)
+        {
+            auto& variant = entry->variants[i];
+            const auto variantPath = path + GetSidecarExtension(variant.encoding);
+            if (ReadFile(variantPath, variantVersions[i], variant.body))
+            {
+                variant.etag = GetVariantEntityTag(GetEntityTag(*spaceMapping.etags, variantPath,
+                                                                variantVersions[i], variant.body),
+                                                   variant.encoding);
+                ++i;
+            } else
+            {
+                (void)entry->variants.erase(entry->variants.begin() + i);
+                (void)variantVersions.erase(variantVersions.begin() + i);
+            }
+        }
+        (void)spaceMapping.cache->Insert(path, directory, entry, generation);
+
+        // Select again, since representations which vanished were dropped.
+        const auto cachedVariant = SelectVariant(request, entry->variants);
+        const auto& body = (cachedVariant == nullptr) ? entry->body : cachedVariant->body;
+        Respond(request, *entry, cachedVariant, body.data(), body.length(), response);
+    }
+
+    /**
+     * This function determines whether or not the given file name carries
+     * a fingerprint of the file content, such as "app.3f9a1c.js" or
+     * "app-3f9a1c.js", as produced by asset build tools. A fingerprint
+     * mixes decimal digits and hexadecimal letters, so that names
+     * carrying a date or a serial number, such as "report-20240101.pdf",
+     * or a word, such as "facade.png", are not mistaken for one.
+     *
+     * @param[in] fileName
+     *      This is the name of the file to check.
+     *
+     * @return
+     *      An indication of whether or not the file name
+     *      carries a fingerprint is returned.
+     */
+    bool IsFingerprinted(const std::string& fileName) {
+        const auto extension = fileName.find_last_of('.');
+        if ((extension == std::string::npos) || (extension == 0))
+        { return false; }
+        size_t partEnd = extension;
+        while (partEnd > 0)
+        {
+            auto partStart = fileName.find_last_of(".-", partEnd - 1);
+            if (partStart == std::string::npos)
+            { return false; }
+            ++partStart;
+            const auto part = fileName.substr(partStart, partEnd - partStart);
+            if ((part.length() >= MIN_FINGERPRINT_LENGTH) &&
+                (part.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos) &&
+                (part.find_first_of("0123456789") != std::string::npos) &&
+                (part.find_first_of("abcdefABCDEF") != std::string::npos))
+            { return true; }
+            partEnd = partStart - 1;
+        }
+        return false;
+    }
+
+    /**
+     * This function returns the "Cache-Control" header value to give
+     * the file with the given name, according to the given policy.
+     *
+     * @param[in] cachePolicy
+     *      This describes how clients may cache the files served.
+     *
+     * @param[in] fileName
+     *      This is the name of the file served.
+     *
+     * @return
+     *      The "Cache-Control" header value to give the file is returned,
+     *      or an empty string if no such header should be given.
+     */
+    std::string GetCacheControl(const CachePolicy& cachePolicy, const std::string& fileName) {
+        if (std::find(cachePolicy.noCache.begin(), cachePolicy.noCache.end(), fileName) !=
+            cachePolicy.noCache.end())
+        { return "no-cache"; }
+        if (cachePolicy.immutable && IsFingerprinted(fileName))
+        { return StringUtils::sprintf("public, max-age=%d, immutable", IMMUTABLE_MAX_AGE); }
+        if (cachePolicy.maxAge >= 0)
+        { return StringUtils::sprintf("public, max-age=%d", cachePolicy.maxAge); }
+        return "";
+    }
+
+    /**
+     * This function adds the headers common to all responses
+     * given for resources of the given space.
+     *
+     * @param[in] spaceMapping
+     *      This is the resource space in which the resource was requested.
+     *
+     * @param[in] request
+     *      This is the request for the resource.
+     *
+     * @param[in, out] response
+     *      This is the response to complete.
+     *
+     * @return
+     *      The completed response is returned.
+     */
+    std::shared_ptr<Http::Client::Response> FinishResponse(
+        const SpaceMapping& spaceMapping, const Http::IServer::Request& request,
+        const std::shared_ptr<Http::Client::Response>& response) {
+        if (response->statusCode < 400)
+        {
+            const auto& target = request.target.GetPath();
+            const auto cacheControl = GetCacheControl(spaceMapping.cachePolicy,
+                                                      target.empty() ? "" : target.back());
+            if (!cacheControl.empty())
+            { response->headers.AddHeader("Cache-Control", cacheControl); }
+        }
+        response->headers.AddHeader("Content-Length",
+                                    StringUtils::sprintf("%zu", response->body.length()));
+        return response;
+    }
+
+    /**
+     * This function handles a request for a file of a resource space
+     * served from an asset pack.
+     *
+     * @param[in] spaceMapping
+     *      This is the resource space in which the file is requested.
+     *
+     * @param[in] path
+     *      This is the path of the file requested, or nullptr if the
+     *      requested resource can't designate a file.
+     *
+     * @param[in] request
+     *      This is the request for the file.
+     *
+     * @param[in, out] response
+     *      This is the response to fill in.
+     */
+    void ServePackedFile(const SpaceMapping& spaceMapping,
+                         const std::shared_ptr<const std::string>& path,
+                         const Http::IServer::Request& request, Http::Client::Response& response) {
+        // Hold on to this version of the pack until the response is
+        // complete, even if the pack is replaced in the meantime.
+        const auto pack = spaceMapping.pack->Get();
+        const auto file = ((pack == nullptr) || (path == nullptr)) ? nullptr : pack->Find(*path);
+        if (file == nullptr)
+        {
+            Fail(response, 404, "Not Found", NOT_FOUND_BODY);
+            return;
+        }
+        const auto variant = SelectVariant(request, file->entry.variants);
+        const auto& content = (variant == nullptr)
+                                  ? file->content
+                                  : file->variantContents[variant - file->entry.variants.data()];
+        Respond(request, file->entry, variant, content.data, content.size, response);
+    }
+
+    /**
+     * This function handles a request for a resource in the given space.
+     *
+     * @param[in] spaceMapping
+     *      This is the resource space in which the resource is requested.
+     *
+     * @param[in] request
+     *      This is the request to handle.
+     *
+     * @return
+     *      The response to be returned to the client is returned.
+     */
+    std::shared_ptr<Http::Client::Response> ServeResource(
+        const SpaceMapping& spaceMapping, const std::shared_ptr<Http::IServer::Request>& request) {
+        auto response = std::make_shared<Http::Client::Response>();
+        const auto path = spaceMapping.resolver->Resolve(request->target.GetPath());
+        if (spaceMapping.pack != nullptr)
+        {
+            ServePackedFile(spaceMapping, path, *request, *response);
+            return FinishResponse(spaceMapping, *request, response);
+        }
+        const auto entry = (path == nullptr) ? nullptr : spaceMapping.cache->Find(*path);
+        if ((path == nullptr) || ((entry == nullptr) && spaceMapping.cache->IsMissing(*path)))
+        {
+            Fail(*response, 404, "Not Found", NOT_FOUND_BODY);
+        } else if (entry == nullptr)
+        {
+            ServeFile(spaceMapping, *path, *request, *response);
+        } else
+        {
+            const auto variant = SelectVariant(*request, entry->variants);
+            const auto& body = (variant == nullptr) ? entry->body : variant->body;
+            Respond(*request, *entry, variant, body.data(), body.length(), *response);
+        }
+        return FinishResponse(spaceMapping, *request, response);
+    }
 }  // namespace
 
 /**
@@ -144,107 +1263,47 @@ extern "C" API void LoadPlugin(
 
     for (auto& spaceMapping : spaceMappings)
     {
-        auto root = spaceMapping.root;
+        if (spaceMapping.pack != nullptr)
+        {
+            const auto watching = spaceMapping.pack->Start();
+            if (!watching)
+            {
+                diagnosticMessageDelegate(
+                    "", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                    StringUtils::sprintf("unable to monitor pack '%s'; it will not be reloaded",
+                                         spaceMapping.root.c_str()));
+            }
+            if (spaceMapping.pack->Get() == nullptr)
+            {
+                diagnosticMessageDelegate(
+                    "", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                    StringUtils::sprintf("unable to open pack '%s'%s", spaceMapping.root.c_str(),
+                                         watching ? "; it will be served once valid" : ""));
+            }
+        } else if ((spaceMapping.cache->GetBudget() > 0) &&
+                   !spaceMapping.cache->Watch(spaceMapping.root))
+        {
+            diagnosticMessageDelegate(
+                "", SystemUtils::DiagnosticsSender::Levels::WARNING,
+                StringUtils::sprintf("unable to monitor '%s'; content will not be cached",
+                                     spaceMapping.root.c_str()));
+        }
         spaceMapping.unregisterationDelegate = server->RegisterResource(
             spaceMapping.space,
-            [root](const std::shared_ptr<Http::IServer::Request> request,
-                   std::shared_ptr<Http::Connection> connection, const std::string& trailer)
-            {
-                const auto path = StringUtils::Join(
-                    {root, StringUtils::Join(request->target.GetPath(), "/")}, "/");
-
-                SystemUtils::File file(path);
-                auto response = std::make_shared<Http::Client::Response>();
-                if (file.IsExisting() && !file.IsDirectory())
-                {
-                    if (file.OpenReadOnly())
-                    {
-                        SystemUtils::File::Buffer buffer(file.GetSize());
-                        if (file.Read(buffer) == buffer.size())
-                        {
-                            // TODO replace it with something that gives
-                            // a strong entity tag -- this one is weak
-                            uint32_t sum = 0;
-                            for (auto b : buffer)
-                            { sum += b; }
-                            const auto etag = StringUtils::sprintf("%" PRIu32, sum);
-                            if (request->headers.HasHeader("If-None-Match") &&
-                                (request->headers.GetHeaderValue("If-None-Match") == etag))
-                            {
-                                response->statusCode = 304;
-                                response->status = "Not Modified";
-                            } else
-                            {
-                                response->statusCode = 200;
-                                response->status = "OK";
-                                response->body.assign(buffer.begin(), buffer.end());
-                            }
-                            bool isGzipped = false;
-                            if ((path.length() >= 5) && (path.substr(path.length() - 5) == ".html"))
-                            {
-                                response->headers.AddHeader("Content-Type", "text/html");
-                                isGzipped = true;
-                            } else if ((path.length() >= 3) &&
-                                       (path.substr(path.length() - 3) == ".js"))
-                            {
-                                response->headers.AddHeader("Content-Type",
-                                                            "application/javascript");
-                                isGzipped = true;
-                            } else if ((path.length() >= 4) &&
-                                       (path.substr(path.length() - 4) == ".css"))
-                            {
-                                response->headers.AddHeader("Content-Type", "text/css");
-                                isGzipped = true;
-                            } else if ((path.length() >= 4) &&
-                                       (path.substr(path.length() - 4) == ".txt"))
-                            {
-                                response->headers.AddHeader("Content-Type", "text/plain");
-                                isGzipped = true;
-                            } else if ((path.length() >= 4) &&
-                                       (path.substr(path.length() - 4) == ".ico"))
-                            {
-                                response->headers.AddHeader("Content-Type", "image/x-icon");
-                            } else
-                            { response->headers.AddHeader("Content-Type", "text/plain"); }
-                            if ((request->headers.HasHeaderToken("Accept-Encoding", "gzip")) &&
-                                isGzipped)
-                            {
-                                response->headers.SetHeader("Content-Encoding", "gzip");
-                                StringUtils::Join({etag, "-gzip"}, ",");
-                            }
-                            response->headers.AddHeader("Etag", etag);
-                        } else
-                        {
-                            response->statusCode = 500;
-                            response->status = "Unable to read the file";
-                            response->headers.AddHeader("Content-Type", "text/plain");
-                            response->body =
-                                StringUtils::sprintf("Error reading file '%s'", path.c_str());
-                        };
-                    } else
-                    {
-                        response->statusCode = 500;
-                        response->status = "Unable to open the file";
-                        response->headers.AddHeader("Content-Type", "text/plain");
-                        response->body =
-                            StringUtils::sprintf("Error opening the file '%s'", path.c_str());
-                    }
-                } else
-                {
-                    response->statusCode = 404;
-                    response->status = "Not Found";
-                    response->headers.AddHeader("Content-Type", "text/plain");
-                    response->body = StringUtils::sprintf("File '%s' not found.", path.c_str());
-                }
-                response->headers.AddHeader("Content-Length",
-                                            StringUtils::sprintf("%zu", response->body.length()));
-                return response;
-            });
+            [spaceMapping](const std::shared_ptr<Http::IServer::Request> request,
+                           std::shared_ptr<Http::Connection> connection,
+                           const std::string& trailer)
+            { return ServeResource(spaceMapping, request); });
     }
     unloadDelegate = [spaceMappings]
     {
         for (const auto& spaceMapping : spaceMappings)
-        { spaceMapping.unregisterationDelegate(); }
+        {
+            spaceMapping.unregisterationDelegate();
+            spaceMapping.cache->Stop();
+            if (spaceMapping.pack != nullptr)
+            { spaceMapping.pack->Stop(); }
+        }
     };
 }
 
@@ -10,8 +10,12 @@
 #include <gtest/gtest.h>
 #include <SystemUtils/File.hpp>
 #include <WebServer/PluginEntryPoint.hpp>
+#include <chrono>
 #include <functional>
 #include <map>
+#include <string>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #    define API __declspec(dllimport)
@@ -23,6 +27,88 @@ extern "C" API void LoadPlugin(
     SystemUtils::DiagnosticsSender::DiagnosticMessageDelegate diagnosticMessagedelegate,
     std::function<void()>& unloadDelegate);
 
+namespace
+{
+    /**
+     * This holds one file to store in an asset pack.
+     */
+    struct PackedFile
+    {
+        /**
+         * This is the path of the file, relative to the pack.
+         */
+        std::string path;
+
+        /**
+         * This is the media type of the file.
+         */
+        std::string contentType;
+
+        /**
+         * This is the content of the file, which is also
+         * used, quoted, as its entity tag.
+         */
+        std::string content;
+    };
+
+    /**
+     * This appends a 64-bit little-endian number to the given data.
+     *
+     * @param[in, out] data
+     *      This is the data to which to append the number.
+     *
+     * @param[in] value
+     *      This is the number to append.
+     */
+    void AppendNumber(std::string& data, uint64_t value) {
+        for (int i = 0; i < 8; ++i)
+        {
+            data.push_back((char)(value & 0xFF));
+            value >>= 8;
+        }
+    }
+
+    /**
+     * This writes an asset pack holding the given files,
+     * without any precompressed representations.
+     *
+     * @param[in] path
+     *      This is the path of the pack to write.
+     *
+     * @param[in] files
+     *      These are the files to store in the pack.
+     */
+    void WritePack(const std::string& path, const std::vector<PackedFile>& files) {
+        std::string tables("ASSETPK1");
+        AppendNumber(tables, files.size());
+        AppendNumber(tables, 0);
+        std::string blobs;
+        const auto tablesSize = tables.length() + files.size() * 11 * 8;
+        const auto addBlob = [&](const std::string& blob)
+        {
+            AppendNumber(tables, tablesSize + blobs.length());
+            AppendNumber(tables, blob.length());
+            blobs += blob;
+        };
+        for (const auto& file : files)
+        {
+            addBlob(file.path);
+            addBlob(file.contentType);
+            addBlob("\"" + file.content + "\"");
+            addBlob(file.content);
+            AppendNumber(tables, 0);
+            AppendNumber(tables, 0);
+            AppendNumber(tables, 0);
+        }
+        const auto pack = tables + blobs;
+        SystemUtils::File packFile(path);
+        (void)packFile.OpenReadWrite();
+        (void)packFile.SetSize(0);
+        (void)packFile.Write(pack.data(), pack.length());
+        packFile.Close();
+    }
+}  // namespace
+
 struct MockServer : public Http::IServer
 {
     // Properties
@@ -184,4 +270,468 @@ TEST_F(StaticContentPluginTests, ServeMultipleResourcesSpaces) {
     request->target.SetPath({"hello.txt"});
     response = server.registredResourceDelegates["second"](request, nullptr, "");
     EXPECT_EQ("Hello, World!", response->body);
-}
\ No newline at end of file
+}
+TEST_F(StaticContentPluginTests, ServeCachedContentUntilFileChanges) {
+    MockServer server;
+    SystemUtils::File testFile(testAreaPath + "/cached.txt");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("Hello", 5);
+    (void)testFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    configuration.Set("cache-budget", 1024);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"cached.txt"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ("Hello", response->body);
+
+    // Change the file and expect the new content to be served
+    // once the change has been noticed.
+    (void)testFile.OpenReadWrite();
+    testFile.Write("World", 5);
+    (void)testFile.Close();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while ((response->body != "World") && (std::chrono::steady_clock::now() < deadline))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        response = server.registredResourceDelegate(request, nullptr, "");
+    }
+    EXPECT_EQ("World", response->body);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, DropCachedContentOfDirectoriesNoLongerWatched) {
+    MockServer server;
+    ASSERT_TRUE(SystemUtils::File::CreateDirectory(testAreaPath + "/one"));
+    ASSERT_TRUE(SystemUtils::File::CreateDirectory(testAreaPath + "/two"));
+    SystemUtils::File firstFile(testAreaPath + "/one/first.txt");
+    (void)firstFile.OpenReadWrite();
+    firstFile.Write("Hello", 5);
+    (void)firstFile.Close();
+    SystemUtils::File secondFile(testAreaPath + "/two/second.txt");
+    (void)secondFile.OpenReadWrite();
+    secondFile.Write("Other", 5);
+    (void)secondFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    configuration.Set("cache-budget", 1024);
+    configuration.Set("watch-limit", 1);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"one", "first.txt"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ("Hello", response->body);
+
+    // Watching the second directory stops watching the first one,
+    // so what was cached from it is dropped, and a change to it
+    // is visible right away, even though it went unnoticed.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"two", "second.txt"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ("Other", response->body);
+    (void)firstFile.OpenReadWrite();
+    firstFile.Write("World", 5);
+    (void)firstFile.Close();
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"one", "first.txt"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ("World", response->body);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, ServeLargeFilesWithoutCachingThem) {
+    MockServer server;
+    SystemUtils::File testFile(testAreaPath + "/large.txt");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("Hello", 5);
+    (void)testFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    configuration.Set("cache-budget", 4);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"large.txt"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(200, response->statusCode);
+    ASSERT_EQ("Hello", response->body);
+    EXPECT_EQ("5", response->headers.GetHeaderValue("Content-Length"));
+
+    // Files larger than the cache budget are never cached,
+    // so a change is visible right away.
+    (void)testFile.OpenReadWrite();
+    testFile.Write("World", 5);
+    (void)testFile.Close();
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ("World", response->body);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, ServePrecompressedVariantWhenAccepted) {
+    MockServer server;
+    SystemUtils::File testFile(testAreaPath + "/app.js");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("Hello", 5);
+    (void)testFile.Close();
+    SystemUtils::File gzipFile(testAreaPath + "/app.js.gz");
+    (void)gzipFile.OpenReadWrite();
+    gzipFile.Write("GZIP", 4);
+    (void)gzipFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+
+    // A client accepting gzip gets the precompressed file.
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"app.js"});
+    request->headers.SetHeader("Accept-Encoding", "br;q=0, gzip, deflate");
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(200, response->statusCode);
+    EXPECT_EQ("GZIP", response->body);
+    EXPECT_EQ("gzip", response->headers.GetHeaderValue("Content-Encoding"));
+    EXPECT_EQ("Accept-Encoding", response->headers.GetHeaderValue("Vary"));
+    const auto gzipEtag = response->headers.GetHeaderValue("ETag");
+
+    // A client not accepting any content coding gets the file as is,
+    // with a different entity tag.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"app.js"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(200, response->statusCode);
+    EXPECT_EQ("Hello", response->body);
+    EXPECT_FALSE(response->headers.HasHeader("Content-Encoding"));
+    EXPECT_EQ("Accept-Encoding", response->headers.GetHeaderValue("Vary"));
+    EXPECT_NE(gzipEtag, response->headers.GetHeaderValue("ETag"));
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, AnswerConditionalRequestsOnLastModified) {
+    MockServer server;
+    SystemUtils::File testFile(testAreaPath + "/exemple.txt");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("Hello", 5);
+    (void)testFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+
+    // The entity tag is strong and the modification time is given.
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"exemple.txt"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(200, response->statusCode);
+    const auto etag = response->headers.GetHeaderValue("ETag");
+    ASSERT_FALSE(etag.empty());
+    EXPECT_EQ('"', etag.front());
+    EXPECT_EQ('"', etag.back());
+    ASSERT_TRUE(response->headers.HasHeader("Last-Modified"));
+    const auto lastModified = response->headers.GetHeaderValue("Last-Modified");
+
+    // A client holding the file since its last modification gets 304.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"exemple.txt"});
+    request->headers.SetHeader("If-Modified-Since", lastModified);
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(304, response->statusCode);
+    EXPECT_TRUE(response->body.empty());
+
+    // A client holding an older copy gets the file.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"exemple.txt"});
+    request->headers.SetHeader("If-Modified-Since", "Thu, 01 Jan 1970 00:00:00 GMT");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(200, response->statusCode);
+    EXPECT_EQ("Hello", response->body);
+
+    // If-None-Match takes precedence over If-Modified-Since, and
+    // a list of entity tags matches if any of them does.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"exemple.txt"});
+    request->headers.SetHeader("If-None-Match", "\"other\", " + etag);
+    request->headers.SetHeader("If-Modified-Since", "Thu, 01 Jan 1970 00:00:00 GMT");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(304, response->statusCode);
+
+    // Empty elements of the list are skipped.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"exemple.txt"});
+    request->headers.SetHeader("If-None-Match", "\"other\", , ");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(200, response->statusCode);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, ServeRangesOfFiles) {
+    MockServer server;
+    SystemUtils::File testFile(testAreaPath + "/bundle.bin");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("0123456789", 10);
+    (void)testFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(200, response->statusCode);
+    EXPECT_EQ("bytes", response->headers.GetHeaderValue("Accept-Ranges"));
+    const auto etag = response->headers.GetHeaderValue("ETag");
+
+    // Single range, resuming an interrupted download.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    request->headers.SetHeader("Range", "bytes=7-");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(206, response->statusCode);
+    EXPECT_EQ("789", response->body);
+    EXPECT_EQ("bytes 7-9/10", response->headers.GetHeaderValue("Content-Range"));
+    EXPECT_EQ("3", response->headers.GetHeaderValue("Content-Length"));
+
+    // Multiple ranges.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    request->headers.SetHeader("Range", "bytes=0-1, -2");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(206, response->statusCode);
+    const auto contentType = response->headers.GetHeaderValue("Content-Type");
+    ASSERT_EQ(0, contentType.find("multipart/byteranges; boundary="));
+    const auto boundary = contentType.substr(contentType.find('=') + 1);
+    EXPECT_EQ(("\r\n--" + boundary +
+               "\r\nContent-Type: text/plain\r\n"
+               "Content-Range: bytes 0-1/10\r\n\r\n01"
+               "\r\n--" +
+               boundary +
+               "\r\nContent-Type: text/plain\r\n"
+               "Content-Range: bytes 8-9/10\r\n\r\n89"
+               "\r\n--" +
+               boundary + "--\r\n"),
+              response->body);
+
+    // Ranges which overlap or are adjacent are served once, merged.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    request->headers.SetHeader("Range", "bytes=4-6, 0-3, 2-5, 0-3");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(206, response->statusCode);
+    EXPECT_EQ("0123456", response->body);
+    EXPECT_EQ("bytes 0-6/10", response->headers.GetHeaderValue("Content-Range"));
+
+    // Unsatisfiable range.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    request->headers.SetHeader("Range", "bytes=10-");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(416, response->statusCode);
+    EXPECT_EQ("bytes */10", response->headers.GetHeaderValue("Content-Range"));
+
+    // Ranges of a representation the client no longer holds are ignored.
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    request->headers.SetHeader("Range", "bytes=7-");
+    request->headers.SetHeader("If-Range", "\"stale\"");
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(200, response->statusCode);
+    EXPECT_EQ("0123456789", response->body);
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"bundle.bin"});
+    request->headers.SetHeader("Range", "bytes=7-");
+    request->headers.SetHeader("If-Range", etag);
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(206, response->statusCode);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, ServeFilesWithCachePolicy) {
+    MockServer server;
+    for (const auto fileName : {"app.3f9a1c.js", "index.html", "logo.png", "report-20240101.pdf"})
+    {
+        SystemUtils::File testFile(testAreaPath + "/" + fileName);
+        (void)testFile.OpenReadWrite();
+        testFile.Write("Hello", 5);
+        (void)testFile.Close();
+    }
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    Json::Value cacheControl(Json::Value::Type::Object);
+    cacheControl.Set("max-age", 300);
+    cacheControl.Set("immutable", true);
+    configuration.Set("cache-control", cacheControl);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    const auto getCacheControl = [&server](const std::string& fileName)
+    {
+        auto request = std::make_shared<Http::IServer::Request>();
+        request->target.SetPath({fileName});
+        const auto response = server.registredResourceDelegate(request, nullptr, "");
+        EXPECT_EQ(200, response->statusCode);
+        return response->headers.GetHeaderValue("Cache-Control");
+    };
+    EXPECT_EQ("public, max-age=31536000, immutable", getCacheControl("app.3f9a1c.js"));
+    EXPECT_EQ("no-cache", getCacheControl("index.html"));
+    EXPECT_EQ("public, max-age=300", getCacheControl("logo.png"));
+    EXPECT_EQ("public, max-age=300", getCacheControl("report-20240101.pdf"));
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, ServeMissingFilesOnceCreated) {
+    MockServer server;
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", testAreaPath);
+    configuration.Set("cache-budget", 1024);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"late.txt"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(404, response->statusCode);
+
+    // Create the file and expect it to be served
+    // once its creation has been noticed.
+    SystemUtils::File testFile(testAreaPath + "/late.txt");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("Hello", 5);
+    (void)testFile.Close();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while ((response->statusCode != 200) && (std::chrono::steady_clock::now() < deadline))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        response = server.registredResourceDelegate(request, nullptr, "");
+    }
+    EXPECT_EQ(200, response->statusCode);
+    EXPECT_EQ("Hello", response->body);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, DoNotServeFilesOutsideOfRoot) {
+    MockServer server;
+    const auto rootPath = testAreaPath + "/root";
+    ASSERT_TRUE(SystemUtils::File::CreateDirectory(rootPath));
+    SystemUtils::File secretFile(testAreaPath + "/secret.txt");
+    (void)secretFile.OpenReadWrite();
+    secretFile.Write("Secret", 6);
+    (void)secretFile.Close();
+    SystemUtils::File testFile(rootPath + "/exemple.txt");
+    (void)testFile.OpenReadWrite();
+    testFile.Write("Hello", 5);
+    (void)testFile.Close();
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("root", rootPath);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"..", "secret.txt"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(404, response->statusCode);
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"..", "root", ".", "exemple.txt"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(404, response->statusCode);
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"sub", "..", ".", "exemple.txt"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(200, response->statusCode);
+    EXPECT_EQ("Hello", response->body);
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"../secret.txt"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(404, response->statusCode);
+    unloadDelegate();
+}
+
+TEST_F(StaticContentPluginTests, ServeFilesFromAssetPack) {
+    MockServer server;
+    const auto packPath = testAreaPath + "/ui.pack";
+    WritePack(packPath, {{"index.html", "text/html", "Version 1"},
+                         {"js/app.js", "application/javascript", "App 1"}});
+    std::function<void()> unloadDelegate;
+    Json::Value configuration(Json::Value::Type::Object);
+    configuration.Set("space", "/");
+    configuration.Set("pack", packPath);
+    LoadPlugin(
+        &server, configuration,
+        [](std::string senderName, size_t level, std::string message)
+        { printf("[%s:%zu] %s\n", senderName.c_str(), level, message.c_str()); },
+        unloadDelegate);
+    auto request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"js", "app.js"});
+    auto response = server.registredResourceDelegate(request, nullptr, "");
+    ASSERT_EQ(200, response->statusCode);
+    EXPECT_EQ("App 1", response->body);
+    EXPECT_EQ("application/javascript", response->headers.GetHeaderValue("Content-Type"));
+    EXPECT_EQ("\"App 1\"", response->headers.GetHeaderValue("ETag"));
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"missing.js"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(404, response->statusCode);
+
+    // Replace the pack and expect the new version to be served
+    // once the replacement has been noticed.
+    WritePack(packPath + ".new", {{"index.html", "text/html", "Version 2"}});
+    SystemUtils::File newPack(packPath + ".new");
+    ASSERT_TRUE(newPack.Move(packPath));
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"index.html"});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    do
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        response = server.registredResourceDelegate(request, nullptr, "");
+    } while ((response->body != "Version 2") && (std::chrono::steady_clock::now() < deadline));
+    EXPECT_EQ("Version 2", response->body);
+    request = std::make_shared<Http::IServer::Request>();
+    request->target.SetPath({"js", "app.js"});
+    response = server.registredResourceDelegate(request, nullptr, "");
+    EXPECT_EQ(404, response->statusCode);
+    unloadDelegate();
+}